@@ -1,9 +1,9 @@
 #pragma once
 
 // lib
+#include <chrono>
 #include <cstdint>
 #include <memory>
-#include <list>
 #include <vector>
 
 namespace ob
@@ -12,13 +12,19 @@ namespace ob
 	using Quantity = std::uint32_t;
 	using OrderId = std::uint64_t;
 	using OrderIds = std::vector<OrderId>;
+	// Who an order belongs to (a session, a trader, ...), for cancelling all of someone's orders at once. Zero means nobody in particular.
+	using OwnerId = std::uint32_t;
+	// Wall-clock time, e.g. when a GoodTillTime order expires. A default constructed Timestamp (the epoch) means "none".
+	using Timestamp = std::chrono::system_clock::time_point;
 
 	struct LevelInfo;
 	using LevelInfos = std::vector<LevelInfo>;
 
 	class Order;
 	using OrderPointer = std::shared_ptr<Order>;
-	using OrderPointers = std::list<OrderPointer>;
+	class RestingOrder;
+	// Orders resting in a book live in its OrderPool, this handle stays valid for as long as the order rests.
+	using OrderHandle = RestingOrder*;
 
 	class Trade;
 	using Trades = std::vector<Trade>;
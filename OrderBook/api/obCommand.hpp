@@ -0,0 +1,131 @@
+#pragma once
+
+#include "api/obAliases.hpp"
+#include "api/obSide.hpp"
+#include "api/obOrderType.hpp"
+#include "api/obOrder.hpp"
+#include "api/obOrderModify.hpp"
+
+//lib
+#include <cstdint>
+
+namespace ob
+{
+	enum class CommandType : std::uint8_t
+	{
+		Add,
+		Cancel,
+		Modify,
+		CancelGoodForDay,
+		Expire,
+		// mass cancels, new types go last as journals and order flows store the value
+		CancelSide,
+		CancelRange,
+		CancelOwner
+	};
+
+	/* One request to an OrderBook, as a plain value that can be copied through a ring buffer.
+	*  Only the fields that make sense for type_ are meaningful (e.g. a Cancel only uses orderId_).
+	*  time_ is the order's expiry for an Add, and the current time for an Expire.
+	*  owner_ is the order's owner for an Add, and whose orders go for a CancelOwner.
+	*/
+	struct Command
+	{
+		CommandType type_{ CommandType::Add };
+		OrderType orderType_{ OrderType::GoodTillCancel };
+		Side side_{ Side::Buy };
+		OrderId orderId_{};
+		Price price_{};
+		Quantity quantity_{};
+		Timestamp time_{};
+		OwnerId owner_{};
+		// A CancelRange cancels the orders of side_ priced from price_ to highPrice_, both included.
+		Price highPrice_{};
+
+		static Command Add(const Order& order)
+		{
+			return Command{ CommandType::Add, order.GetOrderType(), order.GetSide(), order.GetOrderId(), order.GetPrice(), order.GetRemainingQuantity(),
+				order.GetExpiry(), order.GetOwner() };
+		}
+
+		static Command Cancel(OrderId orderId)
+		{
+			Command command{};
+			command.type_ = CommandType::Cancel;
+			command.orderId_ = orderId;
+			return command;
+		}
+
+		static Command Modify(const OrderModify& modify)
+		{
+			return Command{ CommandType::Modify, OrderType::GoodTillCancel, modify.GetSide(), modify.GetOrderId(), modify.GetPrice(), modify.GetQuantity() };
+		}
+
+		static Command CancelGoodForDay()
+		{
+			Command command{};
+			command.type_ = CommandType::CancelGoodForDay;
+			return command;
+		}
+
+		// Removes orders whose expiry is at or before 'now', at most OrderBookOptions::expiryChunk_ of them per command.
+		static Command Expire(Timestamp now)
+		{
+			Command command{};
+			command.type_ = CommandType::Expire;
+			command.time_ = now;
+			return command;
+		}
+
+		static Command CancelSide(Side side)
+		{
+			Command command{};
+			command.type_ = CommandType::CancelSide;
+			command.side_ = side;
+			return command;
+		}
+
+		static Command CancelRange(Side side, Price lowPrice, Price highPrice)
+		{
+			Command command{};
+			command.type_ = CommandType::CancelRange;
+			command.side_ = side;
+			command.price_ = lowPrice;
+			command.highPrice_ = highPrice;
+			return command;
+		}
+
+		static Command CancelOwner(OwnerId owner)
+		{
+			Command command{};
+			command.type_ = CommandType::CancelOwner;
+			command.owner_ = owner;
+			return command;
+		}
+
+		Order ToOrder() const { return Order{ orderType_, orderId_, side_, price_, quantity_, time_, owner_ }; }
+		OrderModify ToOrderModify() const { return OrderModify{ orderId_, side_, price_, quantity_ }; }
+	};
+
+	// How the book dealt with a Command, see OrderBook::Apply.
+	enum class CommandStatus : std::uint8_t
+	{
+		/* Done: an order rests or filled completely, a modify took effect, a cancel found its order.
+		*  Mass cancels, expiries and CancelGoodForDay are always Accepted, whether they found anything or not. */
+		Accepted,
+		/* Refused, the book is as it was: a duplicate order id, an order type the book doesn't take, a price its levels can't hold,
+		*  a FillOrKill that can't fill completely, a FillAndKill or market order with nothing to trade against, or a cancel or modify of an order that isn't there. */
+		Rejected,
+		/* What was left of the order after it traded was cancelled instead of resting: FillAndKill and market orders, or self-trade prevention.
+		*  Also a modify that took the order out, when the order it was to become got rejected. */
+		Cancelled
+	};
+
+	struct CommandResult
+	{
+		CommandStatus status_{ CommandStatus::Accepted };
+		/* What was left of the order when the book was done with it: resting if Accepted, cancelled if Cancelled, all of it if Rejected.
+		*  For a cancel, what the cancelled order had left. Zero for the commands that don't name an order. */
+		Quantity remaining_{};
+	};
+}
@@ -0,0 +1,257 @@
+#include "api/obDepthAnalytics.hpp"
+
+// lib
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+
+// The AVX2 kernels are only built for x86-64. Define OB_NO_AVX2 to leave them out there too (e.g. to compare against the scalar ones).
+#if (defined(__x86_64__) || defined(_M_X64)) && !defined(OB_NO_AVX2)
+#define OB_DEPTH_AVX2 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+// MSVC lets any function use the intrinsics, GCC and Clang need them enabled per function (the rest of the build stays baseline x86-64).
+#define OB_TARGET_AVX2
+#else
+#define OB_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace ob
+{
+	/*******************************************************************
+	*							Private API							   *
+	********************************************************************/
+	namespace
+	{
+		// Where a running total of quantities first reaches a target, see FindCumulativeQuantity.
+		struct Cumulative
+		{
+			// first level that takes the total to the target, or the level count if the levels don't add up to it
+			std::size_t index_{};
+			// total of the levels before index_
+			std::uint64_t before_{};
+		};
+
+		/***** Scalar kernels *****/
+
+		std::uint64_t SumQuantitiesScalar(const Quantity* quantities, std::size_t count)
+		{
+			std::uint64_t total = 0;
+			for (std::size_t i = 0; i < count; ++i)
+				total += quantities[i];
+
+			return total;
+		}
+
+		// Sum of price * quantity. Kept in unsigned (wrapping) arithmetic, like the vector version, and read back as signed.
+		std::int64_t SumNotionalScalar(const Price* prices, const Quantity* quantities, std::size_t count)
+		{
+			std::uint64_t total = 0;
+			for (std::size_t i = 0; i < count; ++i)
+				total += static_cast<std::uint64_t>(static_cast<std::int64_t>(prices[i]) * quantities[i]);
+
+			return static_cast<std::int64_t>(total);
+		}
+
+		Cumulative FindCumulativeQuantityScalar(const Quantity* quantities, std::size_t count, std::uint64_t target, std::size_t from = 0, std::uint64_t before = 0)
+		{
+			for (std::size_t i = from; i < count; ++i)
+			{
+				if (before + quantities[i] >= target)
+					return { i, before };
+
+				before += quantities[i];
+			}
+
+			return { count, before };
+		}
+
+#ifdef OB_DEPTH_AVX2
+		/***** AVX2 kernels *****/
+		// Quantities are 32 bits but their sums aren't, so every block of 8 is widened into two vectors of 4 64 bit lanes.
+
+		OB_TARGET_AVX2 std::uint64_t HorizontalSum(__m256i lanes)
+		{
+			const __m128i half = _mm_add_epi64(_mm256_castsi256_si128(lanes), _mm256_extracti128_si256(lanes, 1));
+			return static_cast<std::uint64_t>(_mm_cvtsi128_si64(half)) + static_cast<std::uint64_t>(_mm_extract_epi64(half, 1));
+		}
+
+		// The 8 quantities at 'quantities', widened and added pairwise into 4 lanes.
+		OB_TARGET_AVX2 __m256i SumBlock(const Quantity* quantities)
+		{
+			const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(quantities));
+			return _mm256_add_epi64(_mm256_cvtepu32_epi64(_mm256_castsi256_si128(block)), _mm256_cvtepu32_epi64(_mm256_extracti128_si256(block, 1)));
+		}
+
+		OB_TARGET_AVX2 std::uint64_t SumQuantitiesAvx2(const Quantity* quantities, std::size_t count)
+		{
+			__m256i total = _mm256_setzero_si256();
+
+			std::size_t i = 0;
+			for (; i + 8 <= count; i += 8)
+				total = _mm256_add_epi64(total, SumBlock(quantities + i));
+
+			return HorizontalSum(total) + SumQuantitiesScalar(quantities + i, count - i);
+		}
+
+		/* AVX2 only has an unsigned 32 x 32 -> 64 bit multiply, so prices are biased into unsigned first (flipping the sign bit adds 2^31)
+		*  and 2^31 * the total quantity is taken back off at the end. Exact, everything is modulo 2^64 like the scalar sum. */
+		OB_TARGET_AVX2 std::int64_t SumNotionalAvx2(const Price* prices, const Quantity* quantities, std::size_t count)
+		{
+			const __m256i bias = _mm256_set1_epi32(INT32_MIN);
+			__m256i notional = _mm256_setzero_si256();
+			__m256i total = _mm256_setzero_si256();
+
+			std::size_t i = 0;
+			for (; i + 8 <= count; i += 8)
+			{
+				const __m256i priceBlock = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(prices + i)), bias);
+				const __m256i quantityBlock = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(quantities + i));
+
+				const __m256i lowQuantities = _mm256_cvtepu32_epi64(_mm256_castsi256_si128(quantityBlock));
+				const __m256i highQuantities = _mm256_cvtepu32_epi64(_mm256_extracti128_si256(quantityBlock, 1));
+
+				// _mm256_mul_epu32 reads the low 32 bits of every 64 bit lane, which is where the widening put them
+				notional = _mm256_add_epi64(notional, _mm256_mul_epu32(_mm256_cvtepu32_epi64(_mm256_castsi256_si128(priceBlock)), lowQuantities));
+				notional = _mm256_add_epi64(notional, _mm256_mul_epu32(_mm256_cvtepu32_epi64(_mm256_extracti128_si256(priceBlock, 1)), highQuantities));
+				total = _mm256_add_epi64(total, _mm256_add_epi64(lowQuantities, highQuantities));
+			}
+
+			const std::uint64_t blocks = HorizontalSum(notional) - (HorizontalSum(total) << 31);
+			return static_cast<std::int64_t>(blocks + static_cast<std::uint64_t>(SumNotionalScalar(prices + i, quantities + i, count - i)));
+		}
+
+		// A whole block of 8 at a time until the block that reaches the target, then level by level inside it.
+		OB_TARGET_AVX2 Cumulative FindCumulativeQuantityAvx2(const Quantity* quantities, std::size_t count, std::uint64_t target)
+		{
+			std::uint64_t before = 0;
+
+			std::size_t i = 0;
+			for (; i + 8 <= count; i += 8)
+			{
+				const std::uint64_t block = HorizontalSum(SumBlock(quantities + i));
+				if (before + block >= target)
+					break;
+
+				before += block;
+			}
+
+			return FindCumulativeQuantityScalar(quantities, count, target, i, before);
+		}
+
+		bool HasAvx2()
+		{
+#ifdef _MSC_VER
+			int registers[4]{};
+			__cpuid(registers, 0);
+			if (registers[0] < 7)
+				return false;
+
+			// the CPU has AVX (ecx bit 28) and the OS saves the ymm registers (OSXSAVE, ecx bit 27, and XCR0 bits 1 and 2)
+			__cpuid(registers, 1);
+			const int avx = (1 << 27) | (1 << 28);
+			if ((registers[2] & avx) != avx or (_xgetbv(0) & 6) != 6)
+				return false;
+
+			__cpuidex(registers, 7, 0);
+			return (registers[1] & (1 << 5)) != 0;
+#else
+			return __builtin_cpu_supports("avx2");
+#endif
+		}
+#endif
+
+		/***** Dispatch *****/
+
+		// Cleared by SetDepthAnalyticsVectorized(false).
+		std::atomic<bool> vectorizedEnabled{ true };
+
+		bool UseAvx2()
+		{
+#ifdef OB_DEPTH_AVX2
+			static const bool avx2 = HasAvx2();
+			return avx2 and vectorizedEnabled.load(std::memory_order_relaxed);
+#else
+			return false;
+#endif
+		}
+
+		std::uint64_t SumQuantities(const Quantity* quantities, std::size_t count)
+		{
+#ifdef OB_DEPTH_AVX2
+			if (UseAvx2())
+				return SumQuantitiesAvx2(quantities, count);
+#endif
+			return SumQuantitiesScalar(quantities, count);
+		}
+
+		std::int64_t SumNotional(const Price* prices, const Quantity* quantities, std::size_t count)
+		{
+#ifdef OB_DEPTH_AVX2
+			if (UseAvx2())
+				return SumNotionalAvx2(prices, quantities, count);
+#endif
+			return SumNotionalScalar(prices, quantities, count);
+		}
+
+		Cumulative FindCumulativeQuantity(const Quantity* quantities, std::size_t count, std::uint64_t target)
+		{
+#ifdef OB_DEPTH_AVX2
+			if (UseAvx2())
+				return FindCumulativeQuantityAvx2(quantities, count, target);
+#endif
+			return FindCumulativeQuantityScalar(quantities, count, target);
+		}
+	}
+
+	/*******************************************************************
+	*							Public API							   *
+	********************************************************************/
+	std::uint64_t GetTotalQuantity(const LevelArrays& levels, std::size_t depth)
+	{
+		return SumQuantities(levels.quantities_.data(), std::min(depth, levels.Size()));
+	}
+
+	std::uint64_t GetQuantityWithin(const LevelArrays& levels, Price distance)
+	{
+		if (levels.Size() == 0 or distance < 0)
+			return 0;
+
+		// Best first, so the distance from the best only grows: the levels within it are a prefix, found by binary search.
+		const std::int64_t best = levels.prices_.front();
+		const auto end = std::partition_point(levels.prices_.begin(), levels.prices_.end(),
+			[best, distance](Price price) { return std::llabs(price - best) <= distance; });
+
+		return SumQuantities(levels.quantities_.data(), static_cast<std::size_t>(end - levels.prices_.begin()));
+	}
+
+	Vwap GetVwap(const LevelArrays& levels, std::uint64_t quantity)
+	{
+		if (quantity == 0)
+			return {};
+
+		const Cumulative cumulative = FindCumulativeQuantity(levels.quantities_.data(), levels.Size(), quantity);
+
+		Vwap vwap{ cumulative.before_, SumNotional(levels.prices_.data(), levels.quantities_.data(), cumulative.index_) };
+		if (cumulative.index_ == levels.Size())
+			return vwap;
+
+		// the rest comes out of the level that reaches the quantity
+		const std::uint64_t rest = quantity - cumulative.before_;
+		vwap.quantity_ += rest;
+		vwap.notional_ += static_cast<std::int64_t>(levels.prices_[cumulative.index_]) * static_cast<std::int64_t>(rest);
+		return vwap;
+	}
+
+	bool IsDepthAnalyticsVectorized()
+	{
+		return UseAvx2();
+	}
+
+	void SetDepthAnalyticsVectorized(bool vectorized)
+	{
+		vectorizedEnabled.store(vectorized, std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "api/obAliases.hpp"
+#include "api/obLevelInfo.hpp"
+
+//lib
+#include <cstddef>
+#include <cstdint>
+
+namespace ob
+{
+	/* Aggregates over one side's depth, as filled by OrderBook::GetDepth(Side, LevelArrays&).
+	*  They work on a copy, so the book's lock is long gone by the time they run and a strategy can ask as many questions as it likes of one fill.
+	*  The sums run 8 levels at a time with AVX2 when the CPU has it (checked once, at run time), one level at a time otherwise. Same results either way.
+	*/
+
+	// Quantity and notional (sum of price * quantity) of a sweep, see GetVwap.
+	struct Vwap
+	{
+		std::uint64_t quantity_{};
+		std::int64_t notional_{};
+
+		// Average price of the sweep, 0 if nothing was taken.
+		double GetPrice() const { return quantity_ == 0 ? 0.0 : static_cast<double>(notional_) / static_cast<double>(quantity_); }
+	};
+
+	// Quantity of the best 'depth' levels, all of them by default.
+	std::uint64_t GetTotalQuantity(const LevelArrays& levels, std::size_t depth = SIZE_MAX);
+	/* Quantity of the levels priced no more than 'distance' away from the best one, best included.
+	*  For "within N ticks" pass N * tickSize, the levels themselves don't know the tick. */
+	std::uint64_t GetQuantityWithin(const LevelArrays& levels, Price distance);
+	/* What sweeping the side for 'quantity' would take, best level first, the last level only partially.
+	*  If the side holds less, all of it: check quantity_ before trusting the price. */
+	Vwap GetVwap(const LevelArrays& levels, std::uint64_t quantity);
+
+	// Do the calls above run the AVX2 kernels on this machine?
+	bool IsDepthAnalyticsVectorized();
+	/* Turns the AVX2 kernels off, or back on if the CPU has them, e.g. to check them against the scalar ones on the same input.
+	*  For tests and benchmarks: calls already running on other threads may go either way. */
+	void SetDepthAnalyticsVectorized(bool vectorized);
+}
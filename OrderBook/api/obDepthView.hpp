@@ -0,0 +1,147 @@
+#pragma once
+
+#include "api/obLevelInfo.hpp"
+
+//lib
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+
+namespace ob
+{
+	// What one DepthView::Read copied out.
+	struct DepthViewState
+	{
+		// Which publication the levels came from, 0 before the first one. Consecutive reads with the same version saw the same book.
+		std::uint64_t version_{};
+		// Resting orders in the whole book, not just in the levels published.
+		std::size_t orders_{};
+		// The market-data feed's sequence as of this publication, see OrderBookLevelInfos::GetMarketDataSequence.
+		std::uint64_t marketDataSequence_{};
+		std::size_t bidLevels_{};
+		std::size_t askLevels_{};
+	};
+
+	/* Top-N depth of a book, published by the thread that mutates it and readable by any number of other threads without a lock.
+	*  Two slots, each guarded by its own sequence number (a seqlock): the writer always fills the slot readers are not pointed at,
+	*  then flips version_ to it. So the writer never waits for anyone, and a reader only has to retry if the writer
+	*  publishes twice while it is copying (it laps the reader and rewrites the very slot being read).
+	*  Everything shared is an atomic word accessed relaxed, the sequence numbers and fences give the ordering.
+	*/
+	class DepthView
+	{
+	public:
+		explicit DepthView(std::size_t levels)
+			: levels_{ levels }
+			, slots_{ Slot{ levels }, Slot{ levels } }
+		{ }
+
+		DepthView(const DepthView&) = delete;
+		DepthView& operator=(const DepthView&) = delete;
+
+		std::size_t GetLevels() const { return levels_; }
+		std::uint64_t GetVersion() const { return version_.load(std::memory_order_acquire); }
+
+		// Writer side, one thread at a time (a book publishes under its own lock). Levels past GetLevels() are left out.
+		void Publish(std::span<const LevelInfo> bids, std::span<const LevelInfo> asks, std::size_t orders, std::uint64_t marketDataSequence = 0)
+		{
+			const std::uint64_t version = version_.load(std::memory_order_relaxed) + 1;
+			Slot& slot = slots_[version & 1];
+
+			// odd while being written
+			const std::uint64_t sequence = slot.sequence_.load(std::memory_order_relaxed);
+			slot.sequence_.store(sequence + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+
+			const std::size_t bidLevels = std::min(bids.size(), levels_);
+			const std::size_t askLevels = std::min(asks.size(), levels_);
+			slot.version_.store(version, std::memory_order_relaxed);
+			slot.orders_.store(orders, std::memory_order_relaxed);
+			slot.marketDataSequence_.store(marketDataSequence, std::memory_order_relaxed);
+			slot.bidLevels_.store(bidLevels, std::memory_order_relaxed);
+			slot.askLevels_.store(askLevels, std::memory_order_relaxed);
+			slot.Store(0, bids.first(bidLevels));
+			slot.Store(levels_, asks.first(askLevels));
+
+			slot.sequence_.store(sequence + 2, std::memory_order_release);
+			version_.store(version, std::memory_order_release);
+		}
+
+		/* Reader side, any thread. Copies up to bids.size() / asks.size() levels, best first, all from the same publication.
+		*  Never blocks and never makes the writer wait. */
+		DepthViewState Read(std::span<LevelInfo> bids, std::span<LevelInfo> asks) const
+		{
+			while (true)
+			{
+				const Slot& slot = slots_[version_.load(std::memory_order_acquire) & 1];
+
+				const std::uint64_t sequence = slot.sequence_.load(std::memory_order_acquire);
+				if (sequence & 1)
+					continue;
+
+				DepthViewState state{};
+				state.version_ = slot.version_.load(std::memory_order_relaxed);
+				state.orders_ = slot.orders_.load(std::memory_order_relaxed);
+				state.marketDataSequence_ = slot.marketDataSequence_.load(std::memory_order_relaxed);
+				state.bidLevels_ = std::min(slot.bidLevels_.load(std::memory_order_relaxed), bids.size());
+				state.askLevels_ = std::min(slot.askLevels_.load(std::memory_order_relaxed), asks.size());
+				slot.Load(0, bids.first(state.bidLevels_));
+				slot.Load(levels_, asks.first(state.askLevels_));
+
+				// anything copied above is only good if the slot wasn't touched meanwhile
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (slot.sequence_.load(std::memory_order_relaxed) == sequence)
+					return state;
+			}
+		}
+
+	private:
+		static constexpr std::size_t CacheLine = 64;
+
+		// One published copy of the depth: bids in levels [0, levels_), asks in [levels_, 2 * levels_), three words per level.
+		struct alignas(CacheLine) Slot
+		{
+			explicit Slot(std::size_t levels)
+				: words_{ std::make_unique<std::atomic<std::uint32_t>[]>(levels * 2 * 3) }
+			{ }
+
+			std::atomic<std::uint64_t> sequence_{ 0 };
+			std::atomic<std::uint64_t> version_{ 0 };
+			std::atomic<std::size_t> orders_{ 0 };
+			std::atomic<std::uint64_t> marketDataSequence_{ 0 };
+			std::atomic<std::size_t> bidLevels_{ 0 };
+			std::atomic<std::size_t> askLevels_{ 0 };
+			std::unique_ptr<std::atomic<std::uint32_t>[]> words_;
+
+			void Store(std::size_t level, std::span<const LevelInfo> infos)
+			{
+				for (const auto& info : infos)
+				{
+					std::atomic<std::uint32_t>* words = &words_[level++ * 3];
+					words[0].store(static_cast<std::uint32_t>(info.price_), std::memory_order_relaxed);
+					words[1].store(info.quantity_, std::memory_order_relaxed);
+					words[2].store(info.count_, std::memory_order_relaxed);
+				}
+			}
+
+			void Load(std::size_t level, std::span<LevelInfo> infos) const
+			{
+				for (auto& info : infos)
+				{
+					const std::atomic<std::uint32_t>* words = &words_[level++ * 3];
+					info.price_ = static_cast<Price>(words[0].load(std::memory_order_relaxed));
+					info.quantity_ = words[1].load(std::memory_order_relaxed);
+					info.count_ = words[2].load(std::memory_order_relaxed);
+				}
+			}
+		};
+
+		const std::size_t levels_;
+		// the last slot published is slots_[version_ & 1]
+		alignas(CacheLine) std::atomic<std::uint64_t> version_{ 0 };
+		Slot slots_[2];
+	};
+}
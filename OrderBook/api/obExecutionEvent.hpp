@@ -0,0 +1,55 @@
+#pragma once
+
+#include "api/obAliases.hpp"
+#include "api/obCommand.hpp"
+#include "api/obMarketDataEvent.hpp"
+
+//lib
+#include <cstdint>
+
+namespace ob
+{
+	enum class ExecutionEventType : std::uint8_t
+	{
+		Ack,
+		Trade
+	};
+
+	// The matching thread has processed a command, and this is what became of it (see CommandResult).
+	struct AckEvent
+	{
+		CommandType command_;
+		CommandStatus status_;
+		Quantity remaining_;
+		OrderId orderId_;
+	};
+
+	/* What an OrderBookPipeline publishes back to its clients: one Ack per command, saying whether it was accepted, rejected or cancelled
+	*  and how much of its order was left, preceded by the trades that command produced, in the order they happened.
+	*/
+	struct ExecutionEvent
+	{
+		ExecutionEventType type_;
+		union
+		{
+			AckEvent ack_;
+			TradeEvent trade_;
+		};
+
+		static ExecutionEvent FromTrade(const Trade& trade)
+		{
+			ExecutionEvent event{};
+			event.type_ = ExecutionEventType::Trade;
+			event.trade_ = TradeEvent{ trade.GetBidTrade(), trade.GetAskTrade() };
+			return event;
+		}
+
+		static ExecutionEvent FromCommand(const Command& command, const CommandResult& result)
+		{
+			ExecutionEvent event{};
+			event.type_ = ExecutionEventType::Ack;
+			event.ack_ = AckEvent{ command.type_, result.status_, result.remaining_, command.orderId_ };
+			return event;
+		}
+	};
+}
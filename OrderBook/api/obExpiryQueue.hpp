@@ -0,0 +1,62 @@
+#pragma once
+
+#include "api/obAliases.hpp"
+
+//lib
+#include <algorithm>
+#include <functional>
+#include <memory_resource>
+#include <vector>
+
+namespace ob
+{
+	/* Min-heap of (expiry, OrderId) for the orders of one book that expire on their own (GoodTillTime and GoodForDay).
+	*  Entries are never removed when an order is cancelled or filled early, that would need a position index inside every order.
+	*  Instead the book checks each entry against the order index when it pops it, and drops the dead ones with Compact()
+	*  once they outnumber the live orders, so the heap stays within a constant factor of the book's size.
+	*/
+	class ExpiryQueue
+	{
+	public:
+		struct Entry
+		{
+			Timestamp expiry_{};
+			OrderId orderId_{};
+
+			bool operator>(const Entry& other) const { return expiry_ > other.expiry_; }
+		};
+
+		explicit ExpiryQueue(std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+			: heap_{ memory }
+		{ }
+
+		bool Empty() const { return heap_.empty(); }
+		std::size_t Size() const { return heap_.size(); }
+		// Requires !Empty().
+		const Entry& Top() const { return heap_.front(); }
+		bool HasDue(Timestamp now) const { return !heap_.empty() and heap_.front().expiry_ <= now; }
+
+		void Push(Timestamp expiry, OrderId orderId)
+		{
+			heap_.push_back(Entry{ expiry, orderId });
+			std::push_heap(heap_.begin(), heap_.end(), std::greater<>{});
+		}
+
+		void Pop()
+		{
+			std::pop_heap(heap_.begin(), heap_.end(), std::greater<>{});
+			heap_.pop_back();
+		}
+
+		// Keeps only the entries for which isLive(entry) is true. O(n).
+		template <typename Predicate>
+		void Compact(Predicate isLive)
+		{
+			std::erase_if(heap_, [&isLive](const Entry& entry) { return !isLive(entry); });
+			std::make_heap(heap_.begin(), heap_.end(), std::greater<>{});
+		}
+
+	private:
+		std::pmr::vector<Entry> heap_;
+	};
+}
@@ -0,0 +1,243 @@
+#include "api/obJournal.hpp"
+#include "api/obSessionClock.hpp"
+
+// lib
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <format>
+
+namespace ob
+{
+	namespace
+	{
+		JournalRecord Encode(const Command& command, std::uint64_t sequence)
+		{
+			JournalRecord record{};
+			record.sequence_ = sequence;
+			record.orderId_ = command.orderId_;
+			record.time_ = ToEpochNanoseconds(command.time_);
+			record.price_ = command.price_;
+			record.quantity_ = command.quantity_;
+			record.owner_ = command.owner_;
+			record.highPrice_ = command.highPrice_;
+			record.type_ = static_cast<std::uint8_t>(command.type_);
+			record.orderType_ = static_cast<std::uint8_t>(command.orderType_);
+			record.side_ = static_cast<std::uint8_t>(command.side_);
+			return record;
+		}
+
+		Command Decode(const JournalRecord& record)
+		{
+			Command command{};
+			command.type_ = static_cast<CommandType>(record.type_);
+			command.orderType_ = static_cast<OrderType>(record.orderType_);
+			command.side_ = static_cast<Side>(record.side_);
+			command.orderId_ = record.orderId_;
+			command.time_ = FromEpochNanoseconds(record.time_);
+			command.price_ = record.price_;
+			command.quantity_ = record.quantity_;
+			command.owner_ = record.owner_;
+			command.highPrice_ = record.highPrice_;
+			return command;
+		}
+
+		// The mapping is page aligned and every offset a multiple of 64 (the header and record size), so these casts are always suitably aligned.
+		JournalHeader ReadHeader(const MappedFile& segment, const std::filesystem::path& path)
+		{
+			JournalHeader header{};
+			if (segment.Size() >= sizeof(header))
+				std::memcpy(&header, segment.Data(), sizeof(header));
+
+			if (header.magic_ != JournalHeader::Magic or header.version_ != JournalHeader::CurrentVersion or header.recordSize_ != sizeof(JournalRecord))
+				throw std::runtime_error(std::format("({}) is not a journal segment this version can read.", path.string()));
+
+			return header;
+		}
+	}
+
+	std::filesystem::path GetJournalSegmentPath(const std::filesystem::path& path, std::size_t index)
+	{
+		std::filesystem::path segment{ path };
+		segment += std::format(".{:06}", index);
+		return segment;
+	}
+
+	/*******************************************************************
+	*							Private API							   *
+	********************************************************************/
+	void JournalWriter::OpenSegment(std::size_t index, bool create)
+	{
+		segmentIndex_ = index;
+		segment_ = MappedFile{ GetJournalSegmentPath(path_, index), MappedFile::Mode::ReadWrite, options_.segmentSize_ };
+
+		if (create)
+		{
+			segment_.Prefault();
+
+			JournalHeader header{};
+			header.recordSize_ = sizeof(JournalRecord);
+			header.firstSequence_ = nextSequence_;
+			std::memcpy(segment_.Data(), &header, sizeof(header));
+
+			writeOffset_ = sizeof(JournalHeader);
+			// the header goes out with the first flush
+			flushedOffset_ = 0;
+			syncedOffset_ = 0;
+			return;
+		}
+
+		nextSequence_ = ReadHeader(segment_, GetJournalSegmentPath(path_, index)).firstSequence_;
+
+		// Find the end: the first slot that doesn't hold the next sequence.
+		std::size_t offset = sizeof(JournalHeader);
+		while (offset + sizeof(JournalRecord) <= segment_.Size() and
+			reinterpret_cast<const JournalRecord*>(segment_.Data() + offset)->sequence_ == nextSequence_)
+		{
+			++nextSequence_;
+			offset += sizeof(JournalRecord);
+		}
+
+		/* Anything after the end is either zeros or the remains of records torn by a crash.
+		*  Clear it once, so a stale record can never line up with a sequence number we write later. */
+		std::memset(segment_.Data() + offset, 0, segment_.Size() - offset);
+		segment_.Flush(offset, segment_.Size() - offset);
+
+		writeOffset_ = offset;
+		flushedOffset_ = offset;
+		syncedOffset_ = offset;
+	}
+
+	bool JournalReader::OpenSegment(std::size_t index)
+	{
+		const auto segmentPath = GetJournalSegmentPath(path_, index);
+		if (!std::filesystem::exists(segmentPath))
+			return false;
+
+		MappedFile segment{ segmentPath, MappedFile::Mode::ReadOnly };
+		// a segment that doesn't pick up where the previous one ended is not part of this journal
+		if (ReadHeader(segment, segmentPath).firstSequence_ != nextSequence_)
+			return false;
+
+		segment_ = std::move(segment);
+		segmentIndex_ = index;
+		readOffset_ = sizeof(JournalHeader);
+		return true;
+	}
+
+	/*******************************************************************
+	*							Public API							   *
+	********************************************************************/
+	JournalWriter::JournalWriter(std::filesystem::path path, const JournalOptions& options)
+		: path_{ std::move(path) }
+		, options_{ options }
+	{
+		// room for the header and at least one record, in whole records
+		options_.segmentSize_ = std::max(options_.segmentSize_, 2 * sizeof(JournalRecord)) / sizeof(JournalRecord) * sizeof(JournalRecord);
+
+		if (!std::filesystem::exists(GetJournalSegmentPath(path_, 0)))
+		{
+			OpenSegment(0, true);
+			return;
+		}
+
+		// continue in the last segment
+		std::size_t last = 0;
+		while (std::filesystem::exists(GetJournalSegmentPath(path_, last + 1)))
+			++last;
+
+		OpenSegment(last, false);
+	}
+
+	JournalWriter::~JournalWriter()
+	{
+		Sync();
+	}
+
+	void JournalWriter::Append(const Command& command)
+	{
+		if (writeOffset_ + sizeof(JournalRecord) > segment_.Size())
+		{
+			/* The full segment stays mapped until the next Sync() has waited for it. Unless Sync() wasn't called for a whole segment:
+			*  then the one before goes now, waited for here, but its writes were started a segment ago, there is little if anything left to wait for. */
+			segment_.FlushAsync(flushedOffset_, writeOffset_ - flushedOffset_);
+			if (previous_.IsOpen())
+				previous_.Flush(previousSyncedOffset_, previous_.Size() - previousSyncedOffset_);
+			previous_ = std::move(segment_);
+			previousSyncedOffset_ = syncedOffset_;
+			OpenSegment(segmentIndex_ + 1, true);
+		}
+
+		const JournalRecord record = Encode(command, nextSequence_++);
+		std::memcpy(segment_.Data() + writeOffset_, &record, sizeof(record));
+		writeOffset_ += sizeof(record);
+
+		if (options_.syncEvery_ != 0 and ++unsynced_ >= options_.syncEvery_)
+		{
+			segment_.FlushAsync(flushedOffset_, writeOffset_ - flushedOffset_);
+			flushedOffset_ = writeOffset_;
+			unsynced_ = 0;
+		}
+	}
+
+	void JournalWriter::Sync()
+	{
+		if (previous_.IsOpen())
+		{
+			previous_.Flush(previousSyncedOffset_, previous_.Size() - previousSyncedOffset_);
+			previous_.Close();
+		}
+
+		segment_.Flush(syncedOffset_, writeOffset_ - syncedOffset_);
+		flushedOffset_ = writeOffset_;
+		syncedOffset_ = writeOffset_;
+		unsynced_ = 0;
+	}
+
+	JournalReader::JournalReader(std::filesystem::path path, std::uint64_t fromSequence)
+		: path_{ std::move(path) }
+	{
+		done_ = !OpenSegment(0);
+
+		// Every segment but the last is full, so where each one ends follows from its size alone.
+		while (!done_ and nextSequence_ < fromSequence)
+		{
+			const std::uint64_t segmentEnd = nextSequence_ + (segment_.Size() - readOffset_) / sizeof(JournalRecord);
+			if (fromSequence < segmentEnd)
+			{
+				readOffset_ += (fromSequence - nextSequence_) * sizeof(JournalRecord);
+				nextSequence_ = fromSequence;
+				break;
+			}
+
+			nextSequence_ = segmentEnd;
+			done_ = !OpenSegment(segmentIndex_ + 1);
+		}
+	}
+
+	std::size_t JournalReader::Read(std::span<Command> commands)
+	{
+		std::size_t count = 0;
+		while (!done_ and count < commands.size())
+		{
+			if (readOffset_ + sizeof(JournalRecord) > segment_.Size())
+			{
+				done_ = !OpenSegment(segmentIndex_ + 1);
+				continue;
+			}
+
+			const auto& record = *reinterpret_cast<const JournalRecord*>(segment_.Data() + readOffset_);
+			if (record.sequence_ != nextSequence_)
+			{
+				done_ = true;
+				break;
+			}
+
+			commands[count++] = Decode(record);
+			readOffset_ += sizeof(JournalRecord);
+			++nextSequence_;
+		}
+
+		return count;
+	}
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "api/obCommand.hpp"
+#include "api/obMappedFile.hpp"
+
+//lib
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+namespace ob
+{
+	/* On-disk layout of a journal.
+	*  A journal is a series of fixed size segment files, "<path>.000000", "<path>.000001", ..., each a JournalHeader followed by JournalRecords.
+	*  Everything is little-endian. Records carry a sequence number that runs on across segments starting at 1,
+	*  so the end of the journal is simply the first record whose sequence isn't the next one (a preallocated segment is zero filled).
+	*  Both structs are 64 bytes, so a record never straddles a page and a flushed page holds only whole records.
+	*/
+	static_assert(std::endian::native == std::endian::little, "The journal is written as raw little-endian structs.");
+
+	struct JournalHeader
+	{
+		static constexpr std::uint64_t Magic = 0x4c4e524a424f; // "OBJRNL"
+		static constexpr std::uint32_t CurrentVersion = 3; // 2: records carry a timestamp, and grew to 64 bytes for it. 3: and the owner and a range's high price
+
+		std::uint64_t magic_{ Magic };
+		std::uint32_t version_{ CurrentVersion };
+		std::uint32_t recordSize_{};
+		std::uint64_t firstSequence_{};
+		std::uint64_t reserved_[5]{};
+	};
+
+	struct JournalRecord
+	{
+		std::uint64_t sequence_{};
+		std::uint64_t orderId_{};
+		// Command::time_ in nanoseconds since the epoch.
+		std::int64_t time_{};
+		std::int32_t price_{};
+		std::uint32_t quantity_{};
+		std::uint32_t owner_{};
+		std::int32_t highPrice_{};
+		std::uint8_t type_{};
+		std::uint8_t orderType_{};
+		std::uint8_t side_{};
+		std::uint8_t reserved_[21]{};
+	};
+
+	static_assert(sizeof(JournalHeader) == 64 and sizeof(JournalRecord) == 64);
+
+	struct JournalOptions
+	{
+		/* Bytes per segment file. Allocated on disk and prefaulted when the segment is created, so Append only ever writes to memory that is there:
+		*  the cost of a new segment is paid once, at the Append that rolls over to it, instead of a page fault every 4 KiB. */
+		std::size_t segmentSize_{ 64 << 20 };
+		// Start writing to disk after this many records, without waiting for it. Zero leaves it to segment rollover, Sync() and destruction.
+		std::size_t syncEvery_{ 4096 };
+	};
+
+	/* Append-only write-ahead log of every command a book accepts (see OrderBookOptions::journal_).
+	*  Appending is a copy into the mapped segment. Every syncEvery_ records the OS is told to start writing them out, but Append never waits for the disk,
+	*  since the book calls it under its own lock: Sync() does, for every record appended so far, and so does the destructor.
+	*  The mapped pages belong to the OS, so a process crash loses nothing appended; a power loss, whatever was not on disk yet.
+	*  Opening an existing journal continues after its last valid record. Single writer.
+	*/
+	class JournalWriter
+	{
+	public:
+		explicit JournalWriter(std::filesystem::path path, const JournalOptions& options = {});
+		~JournalWriter();
+
+		JournalWriter(const JournalWriter&) = delete;
+		JournalWriter& operator=(const JournalWriter&) = delete;
+
+		void Append(const Command& command);
+		// Flushes every record appended so far and waits until they are on disk. Not from under the book's lock, it may take milliseconds.
+		void Sync();
+		// Sequence number the next record will get, one more than the number of records in the journal.
+		std::uint64_t GetNextSequence() const { return nextSequence_; }
+
+	private:
+		std::filesystem::path path_;
+		JournalOptions options_;
+		MappedFile segment_{};
+		std::size_t segmentIndex_{ 0 };
+		std::size_t writeOffset_{ 0 };
+		// Written out up to flushedOffset_ (maybe still under way), known to be on disk up to syncedOffset_.
+		std::size_t flushedOffset_{ 0 };
+		std::size_t syncedOffset_{ 0 };
+		std::size_t unsynced_{ 0 };
+		// The segment before segment_ until the next Sync() waits for its end, from previousSyncedOffset_ on.
+		MappedFile previous_{};
+		std::size_t previousSyncedOffset_{ 0 };
+		std::uint64_t nextSequence_{ 1 };
+
+		void OpenSegment(std::size_t index, bool create);
+	};
+
+	/* Reads a journal back in order, for OrderBook::Replay.
+	*  Each segment is mapped read-only and decoded straight from the mapping, there is no other copy of the file.
+	*/
+	class JournalReader
+	{
+	public:
+		// Starts at fromSequence, e.g. the one a snapshot was taken at (see OrderBook::LoadSnapshot). Earlier segments are skipped without being read.
+		explicit JournalReader(std::filesystem::path path, std::uint64_t fromSequence = 1);
+
+		// Decodes up to commands.size() commands and returns how many were written, 0 at the end of the journal.
+		std::size_t Read(std::span<Command> commands);
+		std::uint64_t GetNextSequence() const { return nextSequence_; }
+
+	private:
+		std::filesystem::path path_;
+		MappedFile segment_{};
+		std::size_t segmentIndex_{ 0 };
+		std::size_t readOffset_{ 0 };
+		std::uint64_t nextSequence_{ 1 };
+		bool done_{ false };
+
+		bool OpenSegment(std::size_t index);
+	};
+
+	std::filesystem::path GetJournalSegmentPath(const std::filesystem::path& path, std::size_t index);
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+//lib
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+namespace ob
+{
+	/* Fixed-size, HDR-style latency histogram (values are usually nanoseconds).
+	*  Values below 128 get a bucket each, above that every power of two is split into 64 buckets,
+	*  so any recorded value is reported within 1/64 (about 1.6%) of its true value, from 1ns to hours, in 30KB that never allocates.
+	*/
+	class LatencyHistogram
+	{
+	public:
+		void Record(std::uint64_t value)
+		{
+			++counts_[GetBucket(value)];
+			++count_;
+			sum_ += value;
+			max_ = std::max(max_, value);
+			min_ = std::min(min_, value);
+		}
+
+		void Merge(const LatencyHistogram& other)
+		{
+			for (std::size_t i = 0; i < BucketCount; ++i)
+				counts_[i] += other.counts_[i];
+
+			count_ += other.count_;
+			sum_ += other.sum_;
+			max_ = std::max(max_, other.max_);
+			min_ = std::min(min_, other.min_);
+		}
+
+		void Reset() { *this = LatencyHistogram{}; }
+
+		std::uint64_t GetCount() const { return count_; }
+		std::uint64_t GetMax() const { return max_; }
+		std::uint64_t GetMin() const { return count_ ? min_ : 0; }
+		double GetMean() const { return count_ ? static_cast<double>(sum_) / static_cast<double>(count_) : 0.0; }
+
+		// Smallest value that at least 'percentile' percent of the recorded values are less than or equal to (within a bucket's precision).
+		std::uint64_t GetPercentile(double percentile) const
+		{
+			if (count_ == 0)
+				return 0;
+
+			const double clamped = std::clamp(percentile, 0.0, 100.0);
+			const auto rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(clamped / 100.0 * static_cast<double>(count_) + 0.5));
+
+			std::uint64_t seen = 0;
+			for (std::size_t i = 0; i < BucketCount; ++i)
+			{
+				seen += counts_[i];
+				if (seen >= rank)
+					return std::min(GetBucketTop(i), max_);
+			}
+
+			return max_;
+		}
+
+	private:
+		static constexpr int SubBucketBits = 7;
+		static constexpr std::uint64_t SubBuckets = std::uint64_t{ 1 } << SubBucketBits;	// 128
+		static constexpr std::uint64_t HalfSubBuckets = SubBuckets / 2;						// 64
+		static constexpr std::size_t BucketCount = (64 - SubBucketBits + 1) * HalfSubBuckets + HalfSubBuckets;
+
+		static std::size_t GetBucket(std::uint64_t value)
+		{
+			if (value < SubBuckets)
+				return static_cast<std::size_t>(value);
+
+			// keep the top 7 bits of the value, the shift says which power of two it was in
+			const int shift = std::bit_width(value) - SubBucketBits;
+			return static_cast<std::size_t>(shift * HalfSubBuckets + (value >> shift));
+		}
+
+		static std::uint64_t GetBucketTop(std::size_t bucket)
+		{
+			if (bucket < SubBuckets)
+				return bucket;
+
+			const std::size_t shift = bucket / HalfSubBuckets - 1;
+			const std::uint64_t top = bucket - shift * HalfSubBuckets;
+			return ((top + 1) << shift) - 1;
+		}
+
+		std::array<std::uint64_t, BucketCount> counts_{};
+		std::uint64_t count_{ 0 };
+		std::uint64_t sum_{ 0 };
+		std::uint64_t max_{ 0 };
+		std::uint64_t min_{ UINT64_MAX };
+	};
+}
@@ -11,6 +11,41 @@ namespace ob
 	{
 		Price price_;
 		Quantity quantity_;
+		Quantity count_{};	// number of orders resting at this level
+	};
+
+	/* One side's levels, best first, as parallel arrays (structure of arrays) rather than a vector of LevelInfo.
+	*  An aggregate over many levels then reads only the fields it needs, contiguously, which is what lets obDepthAnalytics.hpp vectorize it.
+	*  Meant to be kept and refilled (see OrderBook::GetDepth): clearing keeps the capacity, so refilling doesn't allocate once it has grown.
+	*/
+	struct LevelArrays
+	{
+		std::vector<Price> prices_{};
+		std::vector<Quantity> quantities_{};
+		std::vector<Quantity> counts_{};
+
+		std::size_t Size() const { return prices_.size(); }
+
+		void Clear()
+		{
+			prices_.clear();
+			quantities_.clear();
+			counts_.clear();
+		}
+
+		void Reserve(std::size_t levels)
+		{
+			prices_.reserve(levels);
+			quantities_.reserve(levels);
+			counts_.reserve(levels);
+		}
+
+		void Append(Price price, Quantity quantity, Quantity count)
+		{
+			prices_.push_back(price);
+			quantities_.push_back(quantity);
+			counts_.push_back(count);
+		}
 	};
 
 	//using LevelInfos = std::vector<LevelInfo>;
@@ -0,0 +1,209 @@
+#include "api/obMappedFile.hpp"
+
+// lib
+#include <stdexcept>
+#include <format>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ob
+{
+	/*******************************************************************
+	*							Public API							   *
+	********************************************************************/
+#ifdef _WIN32
+	MappedFile::MappedFile(const std::filesystem::path& path, Mode mode, std::size_t size)
+	{
+		const bool write = mode == Mode::ReadWrite;
+
+		file_ = CreateFileW(path.c_str(), write ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ, FILE_SHARE_READ, nullptr,
+			write ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file_ == INVALID_HANDLE_VALUE)
+		{
+			file_ = nullptr;
+			throw std::runtime_error(std::format("Cannot open ({}).", path.string()));
+		}
+
+		LARGE_INTEGER fileSize{};
+		GetFileSizeEx(file_, &fileSize);
+		size_ = static_cast<std::size_t>(fileSize.QuadPart);
+
+		/* SetEndOfFile allocates the clusters. SetFileValidData would also skip NTFS zero filling them on first write,
+		*  but it leaves whatever was on the disk in the file, and the journal finds its end by the zeros after it. */
+		if (write and size_ < size)
+		{
+			LARGE_INTEGER newSize{};
+			newSize.QuadPart = static_cast<LONGLONG>(size);
+			if (!SetFilePointerEx(file_, newSize, nullptr, FILE_BEGIN) or !SetEndOfFile(file_))
+			{
+				Close();
+				throw std::runtime_error(std::format("Cannot grow ({}) to {} bytes.", path.string(), size));
+			}
+			size_ = size;
+		}
+
+		// an empty file can't be mapped, it is simply open with no data
+		if (size_ == 0)
+			return;
+
+		mapping_ = CreateFileMappingW(file_, nullptr, write ? PAGE_READWRITE : PAGE_READONLY, 0, 0, nullptr);
+		if (mapping_)
+			data_ = static_cast<std::byte*>(MapViewOfFile(mapping_, write ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0));
+
+		if (!data_)
+		{
+			Close();
+			throw std::runtime_error(std::format("Cannot map ({}).", path.string()));
+		}
+	}
+
+	void MappedFile::Flush(std::size_t offset, std::size_t length)
+	{
+		if (!data_ or length == 0)
+			return;
+
+		// FlushViewOfFile only hands the pages to the OS, FlushFileBuffers is what waits for the disk.
+		FlushViewOfFile(data_ + offset, length);
+		FlushFileBuffers(file_);
+	}
+
+	void MappedFile::FlushAsync(std::size_t offset, std::size_t length)
+	{
+		if (!data_ or length == 0)
+			return;
+
+		FlushViewOfFile(data_ + offset, length);
+	}
+
+	void MappedFile::Close()
+	{
+		if (data_)
+			UnmapViewOfFile(data_);
+		if (mapping_)
+			CloseHandle(mapping_);
+		if (file_)
+			CloseHandle(file_);
+
+		data_ = nullptr;
+		mapping_ = nullptr;
+		file_ = nullptr;
+		size_ = 0;
+	}
+#else
+	MappedFile::MappedFile(const std::filesystem::path& path, Mode mode, std::size_t size)
+	{
+		const bool write = mode == Mode::ReadWrite;
+
+		file_ = ::open(path.c_str(), write ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+		if (file_ < 0)
+			throw std::runtime_error(std::format("Cannot open ({}).", path.string()));
+
+		struct stat status{};
+		::fstat(file_, &status);
+		size_ = static_cast<std::size_t>(status.st_size);
+
+		// Allocated now, so writing to it later never has to find blocks (ftruncate would leave a sparse file), and zero filled.
+		if (write and size_ < size)
+		{
+			if (::posix_fallocate(file_, static_cast<off_t>(size_), static_cast<off_t>(size - size_)) != 0)
+			{
+				Close();
+				throw std::runtime_error(std::format("Cannot grow ({}) to {} bytes.", path.string(), size));
+			}
+			size_ = size;
+		}
+
+		// an empty file can't be mapped, it is simply open with no data
+		if (size_ == 0)
+			return;
+
+		void* data = ::mmap(nullptr, size_, write ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, file_, 0);
+		if (data == MAP_FAILED)
+		{
+			Close();
+			throw std::runtime_error(std::format("Cannot map ({}).", path.string()));
+		}
+
+		data_ = static_cast<std::byte*>(data);
+	}
+
+	void MappedFile::Flush(std::size_t offset, std::size_t length)
+	{
+		if (!data_ or length == 0)
+			return;
+
+		// msync wants a page aligned start
+		const std::size_t page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+		const std::size_t start = offset / page * page;
+		::msync(data_ + start, offset + length - start, MS_SYNC);
+	}
+
+	void MappedFile::FlushAsync(std::size_t offset, std::size_t length)
+	{
+		if (!data_ or length == 0)
+			return;
+
+		const std::size_t page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+		const std::size_t start = offset / page * page;
+		::msync(data_ + start, offset + length - start, MS_ASYNC);
+	}
+
+	void MappedFile::Close()
+	{
+		if (data_)
+			::munmap(data_, size_);
+		if (file_ >= 0)
+			::close(file_);
+
+		data_ = nullptr;
+		file_ = -1;
+		size_ = 0;
+	}
+#endif
+
+	MappedFile::~MappedFile()
+	{
+		Close();
+	}
+
+	void MappedFile::Prefault()
+	{
+		// Every 4 KiB, the smallest page there is. Each byte is written back as it was, the content doesn't change, but the page is now present and writable.
+		for (std::size_t offset = 0; offset < size_; offset += 4096)
+		{
+			volatile std::byte* byte = data_ + offset;
+			*byte = *byte;
+		}
+	}
+
+	MappedFile::MappedFile(MappedFile&& other) noexcept
+	{
+		*this = std::move(other);
+	}
+
+	MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+	{
+		if (this != &other)
+		{
+			Close();
+			std::swap(data_, other.data_);
+			std::swap(size_, other.size_);
+			std::swap(file_, other.file_);
+#ifdef _WIN32
+			std::swap(mapping_, other.mapping_);
+#endif
+		}
+
+		return *this;
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+//lib
+#include <cstddef>
+#include <filesystem>
+
+namespace ob
+{
+	/* A whole file mapped into memory, the building block of the journal and of snapshots.
+	*  Reads and writes are plain memory accesses, the OS pages the file in and out on its own, and FlushAsync() is the only system call on the hot path.
+	*  Throws std::runtime_error if the file can't be opened or mapped.
+	*/
+	class MappedFile
+	{
+	public:
+		enum class Mode
+		{
+			ReadOnly,	// maps the file as it is, size is ignored
+			ReadWrite	// creates the file if needed and grows it to at least size bytes before mapping, allocating the disk blocks (not a sparse file)
+		};
+
+		MappedFile() = default;
+		MappedFile(const std::filesystem::path& path, Mode mode, std::size_t size = 0);
+		~MappedFile();
+
+		MappedFile(MappedFile&& other) noexcept;
+		MappedFile& operator=(MappedFile&& other) noexcept;
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		bool IsOpen() const { return data_ != nullptr; }
+		std::byte* Data() { return data_; }
+		const std::byte* Data() const { return data_; }
+		std::size_t Size() const { return size_; }
+
+		// Touches every page of a ReadWrite mapping, so the page faults are taken now rather than by the first write to each page.
+		void Prefault();
+		// Writes [offset, offset + length) back to the file and waits until it is on disk.
+		void Flush(std::size_t offset, std::size_t length);
+		// Has the OS start writing [offset, offset + length) back to the file, without waiting for it.
+		void FlushAsync(std::size_t offset, std::size_t length);
+		void Close();
+
+	private:
+		std::byte* data_{ nullptr };
+		std::size_t size_{ 0 };
+#ifdef _WIN32
+		void* file_{ nullptr };
+		void* mapping_{ nullptr };
+#else
+		int file_{ -1 };
+#endif
+	};
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "api/obAliases.hpp"
+#include "api/obSide.hpp"
+#include "api/obTrade.hpp"
+
+//lib
+#include <cstdint>
+
+namespace ob
+{
+	enum class MarketDataEventType : std::uint8_t
+	{
+		LevelUpdate,
+		Trade,
+		LevelTrade	// instead of Trade with TradeReporting::PerLevel
+	};
+
+	/* New aggregate state of one price level. A quantity_ (and count_) of zero means the level is gone. */
+	struct LevelUpdateEvent
+	{
+		Side side_;
+		Price price_;
+		Quantity quantity_;
+		Quantity count_;
+	};
+
+	struct TradeEvent
+	{
+		TradeInfo bidTrade_;
+		TradeInfo askTrade_;
+	};
+
+	/* Everything one incoming order traded at one price level of the other side, summed up: 'fills_' trades for 'quantity_' in total at 'price_'.
+	*  side_ is the incoming order's side. The resting orders it traded against aren't named, the LevelUpdate that follows has what is left of the level. */
+	struct LevelTradeEvent
+	{
+		OrderId orderId_;
+		Side side_;
+		Price price_;
+		Quantity quantity_;
+		Quantity fills_;
+	};
+
+	/* One entry of the market-data delta feed (see OrderBook::DrainMarketData).
+	*  sequence_ increases by one for every event the book produces, so a consumer can tell when events were dropped because it fell behind.
+	*/
+	struct MarketDataEvent
+	{
+		std::uint64_t sequence_;
+		MarketDataEventType type_;
+		union
+		{
+			LevelUpdateEvent level_;
+			TradeEvent trade_;
+			LevelTradeEvent levelTrade_;
+		};
+	};
+}
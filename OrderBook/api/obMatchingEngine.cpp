@@ -0,0 +1,247 @@
+#include "api/obMatchingEngine.hpp"
+#include "api/obThreadAffinity.hpp"
+
+// lib
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <format>
+
+namespace ob
+{
+	/*******************************************************************
+	*							Private API							   *
+	********************************************************************/
+	void MatchingEngine::RunShard(Shard& shard)
+	{
+		std::array<RoutedCommand, 64> batch{};
+		// reused for every command of every book on this shard
+		Trades trades{};
+
+		while (true)
+		{
+			/* Read both before popping: once running_ is false Submit refuses new commands, and with none halfway through
+			*  everything accepted is guaranteed to be in this pop or an earlier one. */
+			const bool stopping = !running_.load() and submitting_.load() == 0;
+
+			const std::size_t count = shard.ingress_.PopBatch(batch);
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				const auto& [instrument, command, scheduled, requeued] = batch[i];
+				auto& book = *books_[instrument];
+
+				const CommandResult result = book.Apply(command, trades);
+				for (const auto& trade : trades)
+					Publish(shard, EngineEvent{ instrument, ExecutionEvent::FromTrade(trade) });
+
+				if (!scheduled and !requeued)
+					Publish(shard, EngineEvent{ instrument, ExecutionEvent::FromCommand(command, result) });
+
+				// One expiry chunk per command, the rest goes to the back of the queue so the commands already waiting get matched in between.
+				//  If the ring is full the scheduler's next tick picks up where this one left off.
+				if (command.type_ == CommandType::Expire and book.HasExpiredOrders(command.time_) and shard.ingress_.TryPush(RoutedCommand{ instrument, command, scheduled, true }))
+					continue;
+
+				if (scheduled)
+					expiryQueued_[instrument].store(false, std::memory_order_release);
+			}
+
+			if (count == 0)
+			{
+				if (stopping)
+					return;
+
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	/* One thread for every book's time based expiry, instead of one sleeping prune thread per book.
+	*  It never touches a book itself, it only reads when each is next due and queues commands for the shards that own the ones that are. */
+	void MatchingEngine::RunScheduler()
+	{
+		using namespace std::chrono;
+
+		std::unique_lock<std::mutex> schedulerLock{ schedulerMutex_ };
+		auto next = steady_clock::now();
+
+		while (true)
+		{
+			next += options_.expiryInterval_;
+
+			if (schedulerConditionVariable_.wait_until(schedulerLock, next, [this]() { return !running_.load(std::memory_order_acquire); }))
+				return;
+
+			// Stop() needs the mutex to wake us, don't hold it while going through every book.
+			schedulerLock.unlock();
+
+			const Timestamp now = system_clock::now();
+			const Command expire = Command::Expire(now);
+			for (InstrumentId instrument = 0; instrument < books_.size(); ++instrument)
+			{
+				if (books_[instrument]->GetNextExpiry() > now or expiryQueued_[instrument].load(std::memory_order_acquire))
+					continue;
+
+				// A full ring is left to the next tick rather than waited on, the orders are still due then and the producers need the room more.
+				expiryQueued_[instrument].store(true, std::memory_order_relaxed);
+				if (!shards_[GetShard(instrument)]->ingress_.TryPush(RoutedCommand{ instrument, expire, true }))
+					expiryQueued_[instrument].store(false, std::memory_order_relaxed);
+			}
+
+			schedulerLock.lock();
+
+			// fell behind (e.g. thousands of books with orders due), skip the missed ticks rather than firing them back to back
+			next = std::max(next, steady_clock::now());
+		}
+	}
+
+	void MatchingEngine::Publish(Shard& shard, const EngineEvent& event)
+	{
+		/* Trades can't be dropped, so wait for the consumer. Once stopping, nobody may be draining anymore: rather than hang,
+		*  the event goes to the shard's overflow_ for Drain to hand out after Stop(), and so does everything after it, to keep the order. */
+		while (shard.overflow_.empty())
+		{
+			if (shard.egress_.TryPush(event))
+				return;
+
+			if (!running_.load(std::memory_order_relaxed))
+				break;
+
+			std::this_thread::yield();
+		}
+
+		shard.overflow_.push_back(event);
+	}
+
+	/*******************************************************************
+	*							Public API							   *
+	********************************************************************/
+	MatchingEngine::MatchingEngine(const EngineOptions& options)
+		: options_{ options }
+	{
+		const std::size_t shards = options.shards_ == 0 ? 1 : options.shards_;
+		for (std::size_t i = 0; i < shards; ++i)
+			shards_.push_back(std::make_unique<Shard>(options.ingressCapacity_, options.egressCapacity_));
+	}
+
+	MatchingEngine::~MatchingEngine()
+	{
+		Stop();
+	}
+
+	InstrumentId MatchingEngine::AddInstrument(std::string symbol)
+	{
+		return AddInstrument(std::move(symbol), options_.bookOptions_);
+	}
+
+	InstrumentId MatchingEngine::AddInstrument(std::string symbol, const OrderBookOptions& options)
+	{
+		if (running_.load(std::memory_order_acquire))
+			throw std::logic_error(std::format("Instrument ({}) cannot be added while the engine is running.", symbol));
+
+		if (symbols_.contains(symbol))
+			throw std::logic_error(std::format("Instrument ({}) is already registered.", symbol));
+
+		if (options.journal_ and journals_.contains(options.journal_))
+			throw std::logic_error(std::format("Instrument ({}) cannot share a journal with another instrument.", symbol));
+
+		const auto instrument = static_cast<InstrumentId>(books_.size());
+		books_.push_back(std::make_unique<SingleWriterOrderBook>(options));
+		symbols_.emplace(std::move(symbol), instrument);
+		if (options.journal_)
+			journals_.insert(options.journal_);
+		return instrument;
+	}
+
+	std::optional<InstrumentId> MatchingEngine::FindInstrument(std::string_view symbol) const
+	{
+		const auto it = symbols_.find(symbol);
+		if (it == symbols_.end())
+			return std::nullopt;
+
+		return it->second;
+	}
+
+	void MatchingEngine::Start()
+	{
+		// an engine is started once, after Stop() its overflow may still be draining
+		if (stopped_.load(std::memory_order_acquire) or running_.exchange(true, std::memory_order_acq_rel))
+			return;
+
+		// all clear, nothing has been queued yet
+		expiryQueued_ = std::make_unique<std::atomic<bool>[]>(books_.size());
+
+		for (std::size_t i = 0; i < shards_.size(); ++i)
+		{
+			Shard& shard = *shards_[i];
+			shard.thread_ = std::thread{ [this, &shard]() { RunShard(shard); } };
+			if (i < options_.cores_.size())
+				PinThread(shard.thread_, options_.cores_[i]);
+		}
+
+		if (options_.expireOrders_)
+			schedulerThread_ = std::thread{ [this]() { RunScheduler(); } };
+	}
+
+	void MatchingEngine::Stop()
+	{
+		closed_.store(true);
+		{
+			// under the scheduler's mutex, so the scheduler can't miss the notification between checking running_ and waiting
+			std::scoped_lock<std::mutex> schedulerLock{ schedulerMutex_ };
+			running_.store(false, std::memory_order_release);
+		}
+		schedulerConditionVariable_.notify_one();
+
+		if (schedulerThread_.joinable())
+			schedulerThread_.join();
+
+		for (auto& shard : shards_)
+			if (shard->thread_.joinable())
+				shard->thread_.join();
+
+		stopped_.store(true, std::memory_order_release);
+	}
+
+	bool MatchingEngine::Submit(InstrumentId instrument, const Command& command)
+	{
+		if (instrument >= books_.size())
+			return false;
+
+		// As in OrderBookPipeline::Submit. Stop() sets closed_ before running_, so a Submit a shard missed sees closed_ and backs out.
+		submitting_.fetch_add(1);
+		const bool pushed = !closed_.load() and shards_[GetShard(instrument)]->ingress_.TryPush(RoutedCommand{ instrument, command });
+		submitting_.fetch_sub(1);
+		return pushed;
+	}
+
+	bool MatchingEngine::Submit(std::string_view symbol, const Command& command)
+	{
+		const auto instrument = FindInstrument(symbol);
+		return instrument and Submit(*instrument, command);
+	}
+
+	std::size_t MatchingEngine::Drain(std::span<EngineEvent> events)
+	{
+		// Read before popping: once stopped, the rings get nothing more, so whatever a pop leaves behind can only be in that shard's overflow_.
+		const bool stopped = stopped_.load(std::memory_order_acquire);
+
+		// Round robin over the shards, starting after the one that went first last time, so a busy shard can't starve the others.
+		std::size_t count = 0;
+		for (std::size_t i = 0; i < shards_.size() and count < events.size(); ++i)
+		{
+			Shard& shard = *shards_[(nextDrainShard_ + i) % shards_.size()];
+			count += shard.egress_.PopBatch(events.subspan(count));
+			if (!stopped or count == events.size())
+				continue;
+
+			const std::size_t overflow = std::min(events.size() - count, shard.overflow_.size() - shard.overflowDrained_);
+			std::copy_n(shard.overflow_.begin() + shard.overflowDrained_, overflow, events.begin() + count);
+			shard.overflowDrained_ += overflow;
+			count += overflow;
+		}
+
+		nextDrainShard_ = (nextDrainShard_ + 1) % shards_.size();
+		return count;
+	}
+}
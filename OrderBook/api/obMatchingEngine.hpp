@@ -0,0 +1,161 @@
+#pragma once
+
+#include "api/obOrderBook.hpp"
+#include "api/obCommand.hpp"
+#include "api/obExecutionEvent.hpp"
+#include "api/obMpscRing.hpp"
+#include "api/obSpscRing.hpp"
+
+//lib
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace ob
+{
+	using InstrumentId = std::uint32_t;
+
+	struct EngineOptions
+	{
+		// Number of matching threads, instruments are spread over them by InstrumentId.
+		std::size_t shards_{ 1 };
+		// Core to pin each shard's thread to (cores_[shard]), shards without an entry are left unpinned.
+		std::vector<int> cores_{};
+		std::size_t ingressCapacity_{ 1 << 16 };
+		std::size_t egressCapacity_{ 1 << 16 };
+		// Used by AddInstrument when no options are given. Smaller than a standalone book's, since there are thousands of these.
+		OrderBookOptions bookOptions_{ .orderCapacity_ = 256 };
+		// Let the engine's scheduler expire GoodForDay and GoodTillTime orders.
+		bool expireOrders_{ true };
+		// How often the scheduler looks for instruments with orders due and sends them a Command::Expire, i.e. how late an order may expire at worst.
+		std::chrono::milliseconds expiryInterval_{ 100 };
+	};
+
+	struct EngineEvent
+	{
+		InstrumentId instrument_;
+		ExecutionEvent event_;
+	};
+
+	/* Owns many books and matches them on a fixed number of threads.
+	*  Each shard is one matching thread with its own ingress ring, and it is the single writer of every book assigned to it,
+	*  so books are SingleWriterOrderBooks with no mutex and no prune thread of their own.
+	*  A single scheduler thread replaces those prune threads: every expiryInterval_ it queues a Command::Expire for every instrument that has an order due
+	*  (see OrderBook::GetNextExpiry), which its shard then runs like any other command, one bounded chunk at a time (see OrderBook::ExpireOrders).
+	*  Those are the engine's own, they are not acked to the consumer. An Expire submitted by a client is requeued the same way and acked once.
+	*
+	*  Instruments are registered with AddInstrument before Start(), commands are routed by InstrumentId (or by symbol, one extra hash lookup),
+	*  and results from every shard are collected by a single consumer through Drain().
+	*
+	*  Shutdown works as in OrderBookPipeline: Stop() lets every shard work through the commands already queued, and results that no longer fit
+	*  in a shard's outbound ring are kept aside for Drain to hand out, after that shard's ring and in order, once Stop() has returned.
+	*/
+	class MatchingEngine
+	{
+	public:
+		explicit MatchingEngine(const EngineOptions& options = {});
+		~MatchingEngine();
+
+		MatchingEngine(const MatchingEngine&) = delete;
+		MatchingEngine& operator=(const MatchingEngine&) = delete;
+
+		/* Only before Start(). Throws std::logic_error if the symbol is already registered, the engine is running,
+		*  or the options name a journal another instrument already writes to (journal records don't say which instrument they are for,
+		*  and each book writes from its own shard's thread). Leave OrderBookOptions::journal_ unset in EngineOptions::bookOptions_ for that reason. */
+		InstrumentId AddInstrument(std::string symbol);
+		InstrumentId AddInstrument(std::string symbol, const OrderBookOptions& options);
+		std::optional<InstrumentId> FindInstrument(std::string_view symbol) const;
+		std::size_t GetInstrumentCount() const { return books_.size(); }
+		std::size_t GetShard(InstrumentId instrument) const { return instrument % shards_.size(); }
+
+		// Starts the shards and the scheduler. Does nothing if the engine is running already or has been stopped.
+		void Start();
+		// Processes every command submitted so far, then stops all threads. Nothing is lost, see the shutdown note above. Called by the destructor.
+		void Stop();
+
+		/* Any thread. Returns false if the instrument is unknown, its shard's ingress ring is full or Stop() has been called.
+		*  A command it returns true for is processed and acked, even if Stop() runs at the same time. Commands submitted before Start() wait in the ring until it is called. */
+		bool Submit(InstrumentId instrument, const Command& command);
+		bool Submit(std::string_view symbol, const Command& command);
+
+		/* One consumer thread only. Collects up to events.size() events from all shards and returns how many were written.
+		*  Events of one instrument are in order, events of instruments on different shards are not ordered relative to each other. */
+		std::size_t Drain(std::span<EngineEvent> events);
+
+		/* Depth view of one instrument's book (see OrderBook::GetDepthView), readable from any thread while the engine runs.
+		*  Null if the instrument is unknown or its options left the view disabled. */
+		const DepthView* GetDepthView(InstrumentId instrument) const
+		{
+			return instrument < books_.size() ? books_[instrument]->GetDepthView() : nullptr;
+		}
+
+	private:
+		struct RoutedCommand
+		{
+			InstrumentId instrument_{};
+			Command command_{};
+			// Queued by the scheduler, see expiryQueued_.
+			bool scheduled_{ false };
+			// An Expire the shard put back for its next chunk, it was acked (unless scheduled_) the first time round.
+			bool requeued_{ false };
+		};
+
+		struct Shard
+		{
+			Shard(std::size_t ingressCapacity, std::size_t egressCapacity)
+				: ingress_{ ingressCapacity }
+				, egress_{ egressCapacity }
+			{ }
+
+			MpscRing<RoutedCommand> ingress_;
+			SpscRing<EngineEvent> egress_;
+			/* Events published while stopping that egress_ had no room for, and every one after them so they stay in order.
+			*  Only the shard's thread touches it until it is joined, then only Drain, once stopped_ says so. */
+			std::vector<EngineEvent> overflow_{};
+			std::size_t overflowDrained_{ 0 };
+			std::thread thread_{};
+		};
+
+		struct SymbolHash
+		{
+			using is_transparent = void;
+			std::size_t operator()(std::string_view symbol) const { return std::hash<std::string_view>{}(symbol); }
+		};
+
+		EngineOptions options_;
+		std::vector<std::unique_ptr<SingleWriterOrderBook>> books_{};
+		std::unordered_map<std::string, InstrumentId, SymbolHash, std::equal_to<>> symbols_{};
+		std::unordered_set<const JournalWriter*> journals_{};
+		/* Per instrument, set by the scheduler when it queues an Expire and cleared by the shard once that is done (requeues included),
+		*  so a book working through a backlog of expiries never has more than one of them in its shard's ring. */
+		std::unique_ptr<std::atomic<bool>[]> expiryQueued_{};
+		std::vector<std::unique_ptr<Shard>> shards_{};
+		std::size_t nextDrainShard_{ 0 };
+
+		std::atomic<bool> running_{ false };
+		// Set first thing in Stop(), before running_ goes false. Submit refuses commands from then on.
+		std::atomic<bool> closed_{ false };
+		// Submit calls between checking closed_ and pushing. A shard only exits once running_ is false, none are left and its ring is empty.
+		std::atomic<std::size_t> submitting_{ 0 };
+		// Set once Stop() has joined every shard, from then on Drain may read their overflow_.
+		std::atomic<bool> stopped_{ false };
+		std::thread schedulerThread_{};
+		std::mutex schedulerMutex_{};
+		std::condition_variable schedulerConditionVariable_{};
+
+		void RunShard(Shard& shard);
+		void RunScheduler();
+		void Publish(Shard& shard, const EngineEvent& event);
+	};
+}
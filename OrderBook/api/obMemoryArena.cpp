@@ -0,0 +1,251 @@
+#include "api/obMemoryArena.hpp"
+
+// lib
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace ob
+{
+	/*******************************************************************
+	*							Private API							   *
+	********************************************************************/
+	namespace
+	{
+		std::size_t RoundUp(std::size_t size, std::size_t multiple)
+		{
+			return (size + multiple - 1) / multiple * multiple;
+		}
+
+#ifndef _WIN32
+		// mbind(2) through syscall, <numaif.h> comes with libnuma which we'd rather not depend on for one call.
+		bool BindToNode(void* data, std::size_t size, int node)
+		{
+			constexpr int BindPolicy = 2; // MPOL_BIND
+			constexpr std::size_t MaxNodes = 1024;
+			if (static_cast<std::size_t>(node) >= MaxNodes)
+				return false;
+
+			unsigned long nodes[MaxNodes / (8 * sizeof(unsigned long))]{};
+			nodes[node / (8 * sizeof(unsigned long))] |= 1ul << (node % (8 * sizeof(unsigned long)));
+			return syscall(SYS_mbind, data, size, BindPolicy, nodes, MaxNodes, 0) == 0;
+		}
+#else
+		// Where the pages went, one page of every 2MB. Only resident pages have a node.
+		bool IsOnNode(std::byte* data, std::size_t size, int node)
+		{
+			std::vector<PSAPI_WORKING_SET_EX_INFORMATION> pages(size / MemoryArena::HugePageSize);
+			for (std::size_t page = 0; page < pages.size(); ++page)
+				pages[page].VirtualAddress = data + page * MemoryArena::HugePageSize;
+
+			if (!QueryWorkingSetEx(GetCurrentProcess(), pages.data(), static_cast<DWORD>(pages.size() * sizeof(PSAPI_WORKING_SET_EX_INFORMATION))))
+				return false;
+			return std::ranges::all_of(pages, [node](const PSAPI_WORKING_SET_EX_INFORMATION& page)
+				{
+					return page.VirtualAttributes.Valid and page.VirtualAttributes.Node == static_cast<ULONG_PTR>(node);
+				});
+		}
+#endif
+	}
+
+	void MemoryArena::Map(std::size_t size)
+	{
+		size = RoundUp(std::max<std::size_t>(size, 1), HugePageSize);
+		Chunk chunk{};
+
+#ifdef _WIN32
+		// Windows binds by preference: the pages come from that node as long as it has any free.
+		const DWORD node = options_.numaNode_ >= 0 ? static_cast<DWORD>(options_.numaNode_) : NUMA_NO_PREFERRED_NODE;
+
+		// Large pages need the "Lock pages in memory" privilege. They are never paged out, so they come prefaulted.
+		if (const std::size_t largePage = GetLargePageMinimum(); options_.hugePages_ and largePage != 0)
+		{
+			const std::size_t largeSize = RoundUp(size, largePage);
+			chunk.data_ = static_cast<std::byte*>(VirtualAllocExNuma(GetCurrentProcess(), nullptr, largeSize,
+				MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE, node));
+			if (chunk.data_)
+			{
+				size = largeSize;
+				chunk.hugePages_ = true;
+			}
+		}
+
+		if (!chunk.data_)
+			chunk.data_ = static_cast<std::byte*>(VirtualAllocExNuma(GetCurrentProcess(), nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE, node));
+
+		if (!chunk.data_)
+			throw std::bad_alloc{};
+#else
+		// Explicit huge pages first, they only exist if the administrator reserved some (vm.nr_hugepages).
+		if (options_.hugePages_)
+		{
+			void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+			if (data != MAP_FAILED)
+			{
+				chunk.data_ = static_cast<std::byte*>(data);
+				chunk.hugePages_ = true;
+			}
+		}
+
+		if (!chunk.data_)
+		{
+			// Normal pages, mapped one huge page too many and trimmed, so the chunk starts on a 2MB boundary and transparent huge pages can cover all of it.
+			void* data = mmap(nullptr, size + HugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (data == MAP_FAILED)
+				throw std::bad_alloc{};
+
+			auto* mapped = static_cast<std::byte*>(data);
+			auto* aligned = reinterpret_cast<std::byte*>(RoundUp(reinterpret_cast<std::uintptr_t>(mapped), HugePageSize));
+			if (aligned != mapped)
+				munmap(mapped, static_cast<std::size_t>(aligned - mapped));
+			if (const std::size_t tail = static_cast<std::size_t>(mapped + size + HugePageSize - (aligned + size)); tail != 0)
+				munmap(aligned + size, tail);
+
+			chunk.data_ = aligned;
+			chunk.hugePages_ = options_.hugePages_ and madvise(chunk.data_, size, MADV_HUGEPAGE) == 0;
+		}
+
+		// Bound before the first touch, the pages are only placed once they fault in. If mbind refuses, the chunk is left to the default policy.
+		if (options_.numaNode_ >= 0)
+			numaBound_ = BindToNode(chunk.data_, size, options_.numaNode_) and numaBound_;
+#endif
+
+		chunk.size_ = size;
+		if (options_.prefault_)
+			std::memset(chunk.data_, 0, size);
+
+#ifdef _WIN32
+		// The node was only a preference, see where the pages actually are now that they are in.
+		if (options_.numaNode_ >= 0)
+			numaBound_ = IsOnNode(chunk.data_, size, options_.numaNode_) and numaBound_;
+#endif
+
+		chunks_.push_back(chunk);
+		next_ = chunk.data_;
+		end_ = chunk.data_ + size;
+	}
+
+	std::byte* MemoryArena::TakeFree(std::size_t bytes, std::size_t alignment)
+	{
+		for (auto it = free_.begin(); it != free_.end(); ++it)
+		{
+			std::byte* const begin = it->first;
+			std::byte* const end = begin + it->second;
+			auto* aligned = reinterpret_cast<std::byte*>(RoundUp(reinterpret_cast<std::uintptr_t>(begin), alignment));
+			if (aligned > end or static_cast<std::size_t>(end - aligned) < bytes)
+				continue;
+
+			free_.erase(it);
+			if (aligned != begin)
+				free_.emplace(begin, static_cast<std::size_t>(aligned - begin));
+			if (aligned + bytes != end)
+				free_.emplace(aligned + bytes, static_cast<std::size_t>(end - (aligned + bytes)));
+
+			return aligned;
+		}
+
+		return nullptr;
+	}
+
+	void* MemoryArena::do_allocate(std::size_t bytes, std::size_t alignment)
+	{
+		if (!free_.empty())
+		{
+			if (std::byte* block = TakeFree(bytes, alignment))
+			{
+				used_ += bytes;
+				return block;
+			}
+		}
+
+		auto aligned = reinterpret_cast<std::byte*>(RoundUp(reinterpret_cast<std::uintptr_t>(next_), alignment));
+		if (aligned > end_ or static_cast<std::size_t>(end_ - aligned) < bytes)
+		{
+			// Outgrown: another chunk as big as the first one, or bigger if this allocation needs it. What is left of the current chunk is wasted.
+			Map(std::max(options_.size_, bytes + alignment));
+			aligned = reinterpret_cast<std::byte*>(RoundUp(reinterpret_cast<std::uintptr_t>(next_), alignment));
+		}
+
+		next_ = aligned + bytes;
+		used_ += bytes;
+		return aligned;
+	}
+
+	void MemoryArena::do_deallocate(void* data, std::size_t bytes, std::size_t)
+	{
+		auto* begin = static_cast<std::byte*>(data);
+		auto* end = begin + bytes;
+		used_ -= bytes;
+
+		// Merged with the free blocks right after and right before it, so a buffer that keeps doubling can reuse the ones it outgrew.
+		if (const auto next = free_.find(end); next != free_.end())
+		{
+			end += next->second;
+			free_.erase(next);
+		}
+
+		if (auto previous = free_.lower_bound(begin); previous != free_.begin())
+		{
+			--previous;
+			if (previous->first + previous->second == begin)
+			{
+				begin = previous->first;
+				free_.erase(previous);
+			}
+		}
+
+		// Right below the bump pointer it simply goes back to the chunk.
+		if (end == next_)
+			next_ = begin;
+		else
+			free_.emplace(begin, static_cast<std::size_t>(end - begin));
+	}
+
+	/*******************************************************************
+	*							Public API							   *
+	********************************************************************/
+	MemoryArena::MemoryArena(const ArenaOptions& options)
+		: options_{ options }
+	{
+		Map(options.size_);
+	}
+
+	MemoryArena::~MemoryArena()
+	{
+		for (const auto& chunk : chunks_)
+		{
+#ifdef _WIN32
+			VirtualFree(chunk.data_, 0, MEM_RELEASE);
+#else
+			munmap(chunk.data_, chunk.size_);
+#endif
+		}
+	}
+
+	MemoryStats MemoryArena::GetStats() const
+	{
+		MemoryStats stats{};
+		for (const auto& chunk : chunks_)
+		{
+			stats.reserved_ += chunk.size_;
+			if (chunk.hugePages_)
+				stats.hugePageBytes_ += chunk.size_;
+		}
+
+		stats.used_ = used_;
+		stats.chunks_ = chunks_.size();
+		stats.numaBound_ = numaBound_ and options_.numaNode_ >= 0;
+		return stats;
+	}
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+//lib
+#include <cstddef>
+#include <map>
+#include <memory_resource>
+#include <vector>
+
+namespace ob
+{
+	// How a book's MemoryArena is set up (see OrderBookOptions::arena_).
+	struct ArenaOptions
+	{
+		// Bytes mapped up front, rounded up to whole huge pages. Zero means no arena, the book allocates from the heap as it always has.
+		std::size_t size_{ 0 };
+		// Back the arena with 2MB pages. Falls back to normal pages (advised for transparent huge pages) when the system has none to give.
+		bool hugePages_{ true };
+		/* NUMA node to bind the memory to, normally the node of the core the book's matching thread is pinned to. -1 leaves placement to the OS.
+		*  Binding can fail (a node that doesn't exist, a kernel without NUMA), the arena then still works with its memory wherever the OS put it,
+		*  and MemoryStats::numaBound_ says so. */
+		int numaNode_{ -1 };
+		// Touch every page while constructing, so that no page fault is ever taken on the matching path.
+		bool prefault_{ true };
+	};
+
+	struct MemoryStats
+	{
+		// Bytes mapped, and how many of them have been handed out.
+		std::size_t reserved_{};
+		std::size_t used_{};
+		// Of reserved_, the bytes on huge pages (explicit ones, or transparent ones the kernel was asked for).
+		std::size_t hugePageBytes_{};
+		// Mappings made. More than one means the book outgrew ArenaOptions::size_ and the arena had to map more.
+		std::size_t chunks_{};
+		/* Every chunk is on ArenaOptions::numaNode_. On Linux, mbind accepted every chunk. On Windows the node is only a preference,
+		*  so this is what the pages were found on afterwards; pages not faulted in yet aren't on any node, so without prefault_ it is false. */
+		bool numaBound_{ false };
+	};
+
+	/* Big, page aligned mappings that a book's containers allocate from, instead of the general heap.
+	*  The point is locality: the order pool, the id index and the levels sit together on a few huge pages (few TLB entries)
+	*  on the matching thread's NUMA node, rather than on 4KB pages scattered over the heap and the machine.
+	*  Allocation is a pointer bump, memory only goes back to the OS with the arena.
+	*  Containers that free and reallocate small blocks a lot go through a pool resource on top of it (see OrderBook), which recycles them.
+	*  The pool hands large blocks (a re-centered ladder's arrays, a rehashed index) straight through to the arena though,
+	*  so blocks given back go on a free list, merged with their free neighbours, and later allocations are carved out of it before bumping.
+	*  Not thread safe, like everything else a book owns it is only touched under the book's lock (or by its single writer).
+	*/
+	class MemoryArena : public std::pmr::memory_resource
+	{
+	public:
+		static constexpr std::size_t HugePageSize = std::size_t{ 2 } << 20;
+
+		// Maps ArenaOptions::size_ bytes right away. Throws std::bad_alloc if not even normal pages can be mapped.
+		explicit MemoryArena(const ArenaOptions& options);
+		~MemoryArena() override;
+
+		MemoryArena(const MemoryArena&) = delete;
+		MemoryArena& operator=(const MemoryArena&) = delete;
+
+		MemoryStats GetStats() const;
+
+	private:
+		struct Chunk
+		{
+			std::byte* data_{ nullptr };
+			std::size_t size_{ 0 };
+			bool hugePages_{ false };
+		};
+
+		const ArenaOptions options_;
+		std::vector<Chunk> chunks_{};
+		// free space of the last chunk
+		std::byte* next_{ nullptr };
+		std::byte* end_{ nullptr };
+		std::size_t used_{ 0 };
+		bool numaBound_{ true };
+		// Blocks given back, by address. Rarely more than a few: only large, rarely replaced buffers come back while the book runs.
+		std::map<std::byte*, std::size_t> free_{};
+
+		void Map(std::size_t size);
+		// First free block 'bytes' fit in once aligned, or null. What is left of the block on either side stays free.
+		std::byte* TakeFree(std::size_t bytes, std::size_t alignment);
+
+		void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+		void do_deallocate(void* data, std::size_t bytes, std::size_t alignment) override;
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+	};
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+//lib
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <span>
+
+namespace ob
+{
+	/* Bounded, lock-free ring buffer for any number of producer threads and a single consumer thread.
+	*  Every cell carries a sequence number that says whose turn it is: producers claim a cell with a CAS on tail_,
+	*  write it, then publish it by bumping its sequence; the consumer only reads cells whose sequence says they are published.
+	*  (This is Dmitry Vyukov's bounded queue, with the consumer side simplified since there is only one.)
+	*/
+	template <typename T>
+	class MpscRing
+	{
+	public:
+		explicit MpscRing(std::size_t capacity)
+			: capacity_{ std::bit_ceil(capacity < 2 ? std::size_t{ 2 } : capacity) }
+			, mask_{ capacity_ - 1 }
+			, cells_{ std::make_unique<Cell[]>(capacity_) }
+		{
+			for (std::size_t i = 0; i < capacity_; ++i)
+				cells_[i].sequence_.store(i, std::memory_order_relaxed);
+		}
+
+		MpscRing(const MpscRing&) = delete;
+		MpscRing& operator=(const MpscRing&) = delete;
+
+		std::size_t Capacity() const { return capacity_; }
+
+		// Producer side, any thread. Returns false if the ring is full.
+		bool TryPush(const T& item)
+		{
+			std::size_t tail = tail_.load(std::memory_order_relaxed);
+			while (true)
+			{
+				Cell& cell = cells_[tail & mask_];
+				const std::size_t sequence = cell.sequence_.load(std::memory_order_acquire);
+				const auto difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(tail);
+
+				if (difference == 0)
+				{
+					// the cell is free for this lap, try to claim it
+					if (tail_.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed))
+					{
+						cell.item_ = item;
+						cell.sequence_.store(tail + 1, std::memory_order_release);
+						return true;
+					}
+				}
+				else if (difference < 0)
+				{
+					// the consumer hasn't freed this cell yet, the ring is full
+					return false;
+				}
+				else
+				{
+					// another producer got here first
+					tail = tail_.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		// Consumer side. Pops up to items.size() items and returns how many were popped.
+		std::size_t PopBatch(std::span<T> items)
+		{
+			std::size_t count = 0;
+			for (; count < items.size(); ++count)
+			{
+				Cell& cell = cells_[head_ & mask_];
+				if (cell.sequence_.load(std::memory_order_acquire) != head_ + 1)
+					break;
+
+				items[count] = cell.item_;
+				// hand the cell back to the producers for the next lap
+				cell.sequence_.store(head_ + capacity_, std::memory_order_release);
+				++head_;
+			}
+
+			return count;
+		}
+
+	private:
+		static constexpr std::size_t CacheLine = 64;
+
+		struct Cell
+		{
+			std::atomic<std::size_t> sequence_{ 0 };
+			T item_{};
+		};
+
+		const std::size_t capacity_;
+		const std::size_t mask_;
+		std::unique_ptr<Cell[]> cells_;
+
+		alignas(CacheLine) std::atomic<std::size_t> tail_{ 0 };
+		// only the consumer touches head_, no atomic needed
+		alignas(CacheLine) std::size_t head_{ 0 };
+	};
+}
@@ -0,0 +1,12 @@
+#include "api/obOrder.hpp"
+
+namespace ob
+{
+	/*******************************************************************
+	*							Public API							   *
+	********************************************************************/
+	void ThrowQuantityError(OrderId orderId, const char* action)
+	{
+		throw std::logic_error(std::format("Order ({}) cannot be {} more than its remaining quantity.", orderId, action));
+	}
+}
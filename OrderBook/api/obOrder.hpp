@@ -11,21 +11,29 @@
 
 namespace ob
 {
+	// Thrown by Fill and friends when asked for more than the order has. Out of line, so the message is only ever built (and compiled) in one place.
+	[[noreturn]] void ThrowQuantityError(OrderId orderId, const char* action);
+
+	/* An order as it is sent to a book: a plain value, the book copies what it needs when the order rests (see obRestingOrder.hpp).
+	*  Widest fields first, the enums are a byte each, 40 bytes in all.
+	*/
 	class Order
 	{
 	public:
-		Order(OrderType orderType, OrderId orderId, Side side, Price price, Quantity quantity)
-			: orderType_{ orderType }
-			, orderId_{ orderId }
-			, side_{ side }
+		Order(OrderType orderType, OrderId orderId, Side side, Price price, Quantity quantity, Timestamp expiry = {}, OwnerId owner = {})
+			: orderId_{ orderId }
+			, expiry_{ expiry }
 			, price_{ price }
 			, initialQuantity_{ quantity }
 			, remainingQuantity_{ quantity }
+			, owner_{ owner }
+			, orderType_{ orderType }
+			, side_{ side }
 		{ }
 
 		/**** Constructor for Market Orders ********/
-		Order(OrderId orderId, Side side, Quantity quantity)
-			: Order(OrderType::Market, orderId, side, Constants::InvalidPrice, quantity)
+		Order(OrderId orderId, Side side, Quantity quantity, OwnerId owner = {})
+			: Order(OrderType::Market, orderId, side, Constants::InvalidPrice, quantity, {}, owner)
 		{ }
 
 	// Getters
@@ -36,17 +44,32 @@ namespace ob
 		Quantity GetInitialQuantity() const { return initialQuantity_; }
 		Quantity GetRemainingQuantity() const { return remainingQuantity_; }
 		Quantity GetFilledQuantity() const { return GetInitialQuantity() - GetRemainingQuantity(); }
-		
+		OwnerId GetOwner() const { return owner_; }
+		/* When the order leaves the book on its own. Set by the caller for GoodTillTime orders,
+		*  and by the book for GoodForDay orders (the next session close). The epoch for every other type. */
+		Timestamp GetExpiry() const { return expiry_; }
+		bool Expires() const { return orderType_ == OrderType::GoodTillTime or orderType_ == OrderType::GoodForDay; }
+
 		bool IsFilled() const { return GetRemainingQuantity() == 0; }
 
 		void Fill(Quantity quantity)
 		{
-			if (quantity > GetRemainingQuantity())
-				throw std::logic_error(std::format("Order ({}) cannot be filled for more than its remaining quantity.", GetOrderId()));
+			if (quantity > GetRemainingQuantity()) [[unlikely]]
+				ThrowQuantityError(GetOrderId(), "filled for");
 
 			remainingQuantity_ -= quantity;
 		}
 
+		// Takes 'quantity' off without it counting as filled, the initial quantity shrinks by as much (see SelfTradePrevention::DecrementAndCancel).
+		void Decrement(Quantity quantity)
+		{
+			if (quantity > GetRemainingQuantity()) [[unlikely]]
+				ThrowQuantityError(GetOrderId(), "decremented by");
+
+			initialQuantity_ -= quantity;
+			remainingQuantity_ -= quantity;
+		}
+
 		void ToGoodTillCancel(Price price)
 		{
 			if (GetOrderType() != OrderType::Market)
@@ -57,11 +80,13 @@ namespace ob
 		}
 
 	private:
-		OrderType orderType_;
 		OrderId orderId_;
-		Side side_;
+		Timestamp expiry_;
 		Price price_;
 		Quantity initialQuantity_;
 		Quantity remainingQuantity_;
+		OwnerId owner_;
+		OrderType orderType_;
+		Side side_;
 	};
-}
\ No newline at end of file
+}
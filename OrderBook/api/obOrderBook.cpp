@@ -1,427 +1,1395 @@
 #include "api/obOrderBook.hpp"
+#include "api/obPriceLadder.hpp"
+#include "api/obSessionClock.hpp"
+#include "api/obJournal.hpp"
+#include "api/obSnapshot.hpp"
 
 // lib
-#include <numeric>
 #include <chrono>
+#include <cstring>
 
 
 namespace ob
 {
+#ifdef OB_ENABLE_STATS
+	namespace
+	{
+		std::uint64_t NanosecondsSince(std::chrono::steady_clock::time_point start)
+		{
+			return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+		}
+	}
+#endif
+
 	/*******************************************************************
 	*							Private API							   *
 	********************************************************************/
-	void OrderBook::PruneGoodForDayOrders()
+	template <typename Policies>
+	void BasicOrderBook<Policies>::PruneExpiredOrders()
 	{
 		using namespace std::chrono;
-		const auto end = hours(16); // 4pm (military time)
 
-		// Thread is looping
-		while (true)
+		std::unique_lock<std::mutex> ordersLock{ ordersMutex_ };
+
+		// Thread is looping until the book shuts down (shutdown_ is set under ordersMutex_, so this check can't miss the notification)
+		while (!shutdown_.load(std::memory_order_acquire))
 		{
-			// time_point value
 			const auto now = system_clock::now();
-			// converts time_point value to std::time_t
-			const auto now_c = system_clock::to_time_t(now);
-			std::tm now_parts{};
-			// converts time_t value pointed by now_parts into a calendar time and stores it in now_c.
-			localtime_s(&now_parts, &now_c); // TODO: might need to swap these variables
 
-			if (now_parts.tm_hour >= end.count()) //end.count() returns number of ticks for duration 'end'
-				now_parts.tm_mday += 1;
+			if (!replaying_ and expiry_.HasDue(now))
+			{
+				// One chunk per lock, anyone waiting for the book gets it in between.
+				ordersLock.unlock();
+				while (PruneChunk(now) and !shutdown_.load(std::memory_order_acquire))
+					;
+				ordersLock.lock();
+				continue;
+			}
 
-			now_parts.tm_hour = end.count();
-			now_parts.tm_min = 0;
-			now_parts.tm_sec = 0;
+			/* Sleep until the earliest expiry. Capped, so that a change of the system clock can't leave us asleep for long.
+			*  During a replay until the book goes live, which wakes us. */
+			nextExpiryWake_ = replaying_ ? now + minutes(1) : std::min(expiry_.Empty() ? Timestamp::max() : expiry_.Top().expiry_, now + minutes(1));
+			expiryConditionVariable_.wait_until(ordersLock, nextExpiryWake_);
+		}
+	}
 
-			auto next = system_clock::from_time_t(mktime(&now_parts));
-			auto till = next - now + milliseconds(100);
+	template <typename Policies>
+	bool BasicOrderBook<Policies>::PruneChunk(Timestamp now)
+	{
+		auto ordersLock = LockOrders();
 
-			{
-				// It might be more appropriate to use a lock_guard here?  less overhead and the lock's use is pretty simple
-				std::unique_lock<std::mutex> ordersLock{ ordersMutex_ };
+		// checked under the lock, a Replay may have started since the prune thread last looked
+		if (replaying_)
+			return false;
 
-				if (shutdown_.load(std::memory_order_acquire) or // if atomic variable shutdown has been signaled to true to stop the application
-					shutdownConditionVariable_.wait_for(ordersLock, till) == std::cv_status::no_timeout) // or if condition variable  was awakened by notify_all, notify_one or spuriously
-					return;  // return and do nothing, app is terminating.
+		Trades none{};
+		ApplyInternal(Command::Expire(now), none);
+		PublishDepthView();
+		return expiry_.HasDue(now);
+	}
 
-				// lock is released at the end of this scope by destructor
-			}
+	template <typename Policies>
+	std::unique_lock<std::mutex> BasicOrderBook<Policies>::LockOrders() const
+	{
+		if constexpr (!Locking::Enabled)
+			return std::unique_lock<std::mutex>{};
+
+		if (singleWriter_)
+			return std::unique_lock<std::mutex>{};
+
+#ifdef OB_ENABLE_STATS
+		const auto start = std::chrono::steady_clock::now();
+		std::unique_lock<std::mutex> ordersLock{ ordersMutex_ };
+
+		// recorded once the lock is ours, so the counters still have a single writer
+		const std::uint64_t wait = NanosecondsSince(start);
+		stats_.lockAcquisitions_.Add();
+		stats_.lockWaitTime_.Add(wait);
+		stats_.lockWaitMax_.Max(wait);
+		return ordersLock;
+#else
+		return std::unique_lock<std::mutex>{ ordersMutex_ };
+#endif
+	}
+
+	template <typename Policies>
+	template <Side side>
+	bool BasicOrderBook<Policies>::CanFullyFill(Price price, Quantity quantity, OwnerId owner) const
+	{
+		if (!CanMatch<side>(price))
+			return false;
 
-			OrderIds orderIds;
+		/* With self-trade prevention the owner's own orders are in the way, unless it has none resting.
+		*  DecrementAndCancel is the exception: its self matches take quantity off the order instead of filling it, so they still count towards all of it being done. */
+		if (owner != OwnerId{} and selfTradePrevention_ != SelfTradePrevention::None and selfTradePrevention_ != SelfTradePrevention::DecrementAndCancel
+			and owners_.Front(owner)) [[unlikely]]
+			return CanFullyFillAroundOwner<side>(price, quantity, owner);
+
+		/* Everything the order can reach on the opposite side is the quantity resting at its limit price or better
+		*  (asks at or below a buy's price, bids at or above a sell's price).
+		*  A ladder answers that from its cumulative aggregates in O(log levels), a map walks from the touch and stops as soon as the order is covered. */
+		return GetLevels<SideTraits<side>::Opposite>().GetQuantityAtOrBetter(price, quantity) >= quantity;
+	}
+
+	/* Walks the opposite side in the order Sweep would, one order at a time, so only ever for owners with orders resting.
+	*  CancelOldest takes the owner's orders out of the way as it meets them, the quantity past them is still reachable.
+	*  CancelNewest and CancelBoth stop the order at the first one, so it has to be covered before that. */
+	template <typename Policies>
+	template <Side side>
+	bool BasicOrderBook<Policies>::CanFullyFillAroundOwner(Price price, Quantity quantity, OwnerId owner) const
+	{
+		std::uint64_t reachable = 0;
+
+		GetLevels<SideTraits<side>::Opposite>().ForEachLevel([this, price, quantity, owner, &reachable](Price levelPrice, const OrderList& orders)
 			{
-				std::scoped_lock<std::mutex> ordersLock{ ordersMutex_ };
+				if (!SideTraits<side>::Crosses(price, levelPrice))
+					return false;
 
-				// <OrderId, OrderEntry>
-				for (const auto& [_, entry] : orders_)
+				for (const auto& resting : orders)
 				{
-					// <OrderPointer, OrderPointers::iterator>
-					const auto& [order, _] = entry;
+					if (OrderPool::GetDetails(resting).GetOwner() == owner)
+					{
+						if (selfTradePrevention_ == SelfTradePrevention::CancelOldest)
+							continue;
+
+						return false;
+					}
 
-					if (order->GetOrderType() != OrderType::GoodForDay)
+					reachable += resting.GetRemainingQuantity();
+					if (reachable >= quantity)
+						return false;
+				}
+
+				return true;
+			});
+
+		return reachable >= quantity;
+	}
+
+	template <typename Policies>
+	template <Side side>
+	bool BasicOrderBook<Policies>::CanMatch(Price price) const
+	{
+		const auto& opposite = GetLevels<SideTraits<side>::Opposite>();
+		if (opposite.Empty())
+			return false;
+
+		// The opposite side holds price levels whose values are of type 'OrderList', which is an intrusive list of
+		//   the 'Order' objects resting at that price [complex, I know!]
+		//  Its best price (the lowest ask for a buy, the highest bid for a sell) comes first,
+		//  with the map storage this is the first element of the map, with the ladder storage it is a cursor, either way no searching is needed.
+		return SideTraits<side>::Crosses(price, opposite.GetBestPrice());
+	}
+
+	/* The opposite side's levels are taken best first, each level as a whole: its orders are filled front to back in one tight loop,
+	*  then the level's aggregates and market data are updated once, however many orders it took. The incoming order is never in the book meanwhile,
+	*  it only gets there afterwards if something is left and its type rests (see AddOrderToSide). */
+	template <typename Policies>
+	template <Side side>
+	bool BasicOrderBook<Policies>::Sweep(Order& order, Trades& trades)
+	{
+		constexpr Side opposite = SideTraits<side>::Opposite;
+		auto& levels = GetLevels<opposite>();
+
+		/* Zero unless self-trade prevention is on and the order has an owner. A book (or an order) without it pays one compare against zero per fill,
+		*  the resting order's owner (in its OrderDetails, off the hot path) is only read when both have an owner to compare. */
+		const OwnerId owner = selfTradePrevention_ == SelfTradePrevention::None ? OwnerId{} : order.GetOwner();
+		bool live = true;
+
+		while (!order.IsFilled() and !levels.Empty())
+		{
+			const Price price = levels.GetBestPrice();
+			if (!SideTraits<side>::Crosses(order.GetPrice(), price))
+				break;
+
+			OB_STATS(stats_.levelsSwept_.Add());
+
+			auto& resting = levels.GetBestLevel();
+			BeforeLevelChange(opposite, price, resting);
+			const Quantity levelQuantity = resting.GetQuantity();
+			Quantity swept = 0;
+			Quantity fills = 0;
+
+			while (!resting.empty() and !order.IsFilled())
+			{
+				auto& match = resting.front();
+
+				if (owner != OwnerId{} and match.HasOwner() and OrderPool::GetDetails(match).GetOwner() == owner) [[unlikely]]
+				{
+					if (PreventSelfTrade(order, resting, match))
 						continue;
 
-					orderIds.push_back(order->GetOrderId());
+					live = false;
+					break;
 				}
 
-				// lock is unlocked at end of this scope by destructor
+				// The quantity that can be filled is the minimum between both orders, as we cannot "overfill" an order.
+				const Quantity quantity = std::min(order.GetRemainingQuantity(), match.GetRemainingQuantity());
+				order.Fill(quantity);
+				resting.Fill(match, quantity);
+				swept += quantity;
+				++fills;
+
+				const auto& trade = side == Side::Buy
+					? trades.emplace_back(TradeInfo{ order.GetOrderId(), order.GetPrice(), quantity }, TradeInfo{ match.GetOrderId(), match.GetPrice(), quantity })
+					: trades.emplace_back(TradeInfo{ match.GetOrderId(), match.GetPrice(), quantity }, TradeInfo{ order.GetOrderId(), order.GetPrice(), quantity });
+
+				if (tradeReporting_ == TradeReporting::PerFill)
+					OnOrderMatched(trade);
+				OB_STATS(stats_.trades_.Add());
+				OB_STATS(stats_.fills_[ToIndex(match.GetOrderType())].Add());
+
+				// Filled orders leave the book, and their slot goes back to the pool (which is why this happens last).
+				if (match.IsFilled())
+					RemoveFront(resting);
 			}
 
-			CancelOrders(orderIds);
+			if (tradeReporting_ == TradeReporting::PerLevel and fills != 0)
+				OnLevelTraded<side>(order, price, swept, fills);
+
+			// One update per level, however many fills (or self-trade cancels) happened at it. None if the order was cancelled before touching it.
+			if (resting.GetQuantity() != levelQuantity)
+				OnLevelChanged<opposite>(price, resting);
+
+			if (resting.empty())
+			{
+				levels.EraseLevel(price);
+				OB_STATS(stats_.levelsDestroyed_.Add());
+			}
+
+			if (!live)
+				return false;
 		}
+
+		return true;
 	}
 
-	bool OrderBook::CanFullyFill(Side side, Price price, Quantity quantity) const
+	template <typename Policies>
+	bool BasicOrderBook<Policies>::PreventSelfTrade(Order& order, OrderList& level, RestingOrder& match)
 	{
-		if (!CanMatch(side, price))
+		OB_STATS(stats_.selfTradesPrevented_.Add());
+
+		switch (selfTradePrevention_)
+		{
+		case SelfTradePrevention::CancelOldest:
+			OB_STATS(stats_.cancels_[ToIndex(match.GetOrderType())].Add());
+			RemoveFront(level);
+			return true;
+		case SelfTradePrevention::CancelBoth:
+			OB_STATS(stats_.cancels_[ToIndex(match.GetOrderType())].Add());
+			RemoveFront(level);
 			return false;
+		case SelfTradePrevention::DecrementAndCancel:
+		{
+			// Neither side counts it as a fill, both just get smaller. The resting order keeps its place in the queue if anything is left of it.
+			const Quantity quantity = std::min(order.GetRemainingQuantity(), match.GetRemainingQuantity());
+			order.Decrement(quantity);
+
+			if (quantity == match.GetRemainingQuantity())
+			{
+				OB_STATS(stats_.cancels_[ToIndex(match.GetOrderType())].Add());
+				RemoveFront(level);
+			}
+			else
+			{
+				OrderPool::GetDetails(match).Reduce(quantity);
+				level.Reduce(match, match.GetRemainingQuantity() - quantity);
+			}
 
-		std::optional<Price> threshold{};
+			return order.GetRemainingQuantity() != 0;
+		}
+		default:
+			// CancelNewest, the resting order is left alone.
+			return false;
+		}
+	}
+
+	template <typename Policies>
+	void BasicOrderBook<Policies>::RemoveFront(OrderList& level)
+	{
+		RestingOrder& order = level.front();
+		level.pop_front();
+		orders_.Erase(order.GetOrderId());
+		owners_.Erase(order);
+		pool_.Release(&order);
+	}
+
+	template <typename Policies>
+	CommandResult BasicOrderBook<Policies>::AddOrderInternal(Order order, Trades& trades)
+	{
+		// the only place an add looks at the side, everything below it is compiled once per side
+		if (order.GetSide() == Side::Buy)
+			return AddOrderToSide<Side::Buy>(order, trades);
+		else
+			return AddOrderToSide<Side::Sell>(order, trades);
+	}
+
+	template <typename Policies>
+	template <Side side>
+	CommandResult BasicOrderBook<Policies>::AddOrderToSide(Order order, Trades& trades)
+	{
+		// by the type it arrived with, before a market order becomes GoodTillCancel
+		OB_STATS(const std::size_t type = ToIndex(order.GetOrderType()));
+		OB_STATS(stats_.adds_[type].Add());
+
+		/* Exit condition */
+		if (!Types::Supports(order.GetOrderType()) or orders_.Contains(order.GetOrderId()))
+		{
+			OB_STATS(stats_.rejects_[type].Add());
+			return CommandResult{ CommandStatus::Rejected, order.GetRemainingQuantity() };
+		}
 		
-		// If order is a buy, you want to set threshold to the LOWEST sell price
-		if (side == Side::Buy)
+		/* FillAndKill and Market orders never rest, whatever the sweep leaves of them is cancelled.
+		*  FillOrKill orders are checked to be filled completely before they sweep (self-trade prevention included), so nothing is ever left of them to rest. */
+		const bool market = order.GetOrderType() == OrderType::Market;
+		const bool rests = order.GetOrderType() != OrderType::FillAndKill and order.GetOrderType() != OrderType::FillOrKill and !market;
+
+		/********* Market Orders **********/
+		// A market order sweeps like a GoodTillCancel order priced at the far end of the other side, i.e. it can reach every level there.
+		if constexpr (Types::Supports(OrderType::Market))
 		{
-			const auto [askPrice, _] = *asks_.begin();
-			threshold = askPrice;
+			if (order.GetOrderType() == OrderType::Market)
+			{
+				const auto& opposite = GetLevels<SideTraits<side>::Opposite>();
+				if (opposite.Empty())
+				{
+					OB_STATS(stats_.rejects_[type].Add());
+					return CommandResult{ CommandStatus::Rejected, order.GetRemainingQuantity() };
+				}
+
+				order.ToGoodTillCancel(opposite.GetWorstPrice());
+			}
 		}
-		// If order is a sell, you want to set threshold to the HIGHEST buy price
-		else
+
+		/********* FillAndKill orders **********/
+		if constexpr (Types::Supports(OrderType::FillAndKill))
 		{
-			const auto [bidPrice, _] = *bids_.begin();
-			threshold = bidPrice;
+			if (order.GetOrderType() == OrderType::FillAndKill and !CanMatch<side>(order.GetPrice()))
+			{
+				OB_STATS(stats_.rejects_[type].Add());
+				return CommandResult{ CommandStatus::Rejected, order.GetRemainingQuantity() };
+			}
 		}
 
-		for (const auto& [levelPrice, levelData] : data_)
+		/********* FillOrKill orders **********/
+		if constexpr (Types::Supports(OrderType::FillOrKill))
 		{
-			// This if statement doesn't make sense to me yet, and I suspect he will change them in part three
-			// e.g. for a buy order, the lowest sell price being greater than the current price level of the bookkeeping container should not be an issue,
-			//   i.e, the current bookkeeping price level is a price that is CHEAPER, which is good for a buy order.
-			if (threshold.has_value() and
-				(side == Side::Buy and threshold.value() > levelPrice) or
-				(side == Side::Sell and threshold.value() < levelPrice))
-				continue;
+			if (order.GetOrderType() == OrderType::FillOrKill and !CanFullyFill<side>(order.GetPrice(), order.GetInitialQuantity(), order.GetOwner()))
+			{
+				OB_STATS(stats_.rejects_[type].Add());
+				return CommandResult{ CommandStatus::Rejected, order.GetRemainingQuantity() };
+			}
+		}
 
-			/* If the order is a buy order and the current price level in the bookkeeping is greater than the price of interest of the order (because you don't want to buy more expensive)
-			*    OR
-			*  If the order is a sell order and the current price level in the bookkeeping is less than the price of interest of the order (because you don't want to sell more cheap)
-			* Then we do not care about this price level and we continue looping onto the next.
-			*/
-			if((side == Side::Buy and levelPrice > price) or
-				(side == Side::Sell and levelPrice < price))
-				continue;
+		/********* GoodTillTime orders need to know when **********/
+		if constexpr (Types::Supports(OrderType::GoodTillTime))
+		{
+			if (order.GetOrderType() == OrderType::GoodTillTime and order.GetExpiry() == Timestamp{})
+			{
+				OB_STATS(stats_.rejects_[type].Add());
+				return CommandResult{ CommandStatus::Rejected, order.GetRemainingQuantity() };
+			}
+		}
 
-			if (quantity <= levelData.quantity_)
-				return true;
+		auto& levels = GetLevels<side>();
+
+		/********* Prices the level storage cannot hold (off-tick prices on a ladder) **********/
+		/* Checked even for orders that won't rest, so an order is rejected up front, never after it traded. Except market orders,
+		*  whose price was just taken from the other side's levels and is only there for the sweep. It is only the tick:
+		*  a ladder holds a price however far from its other levels (see OrderBookOptions::ladderMaxLevels_), so what is left after the sweep can always rest. */
+		if (!market and !levels.IsValidPrice(order.GetPrice()))
+		{
+			OB_STATS(stats_.rejects_[type].Add());
+			return CommandResult{ CommandStatus::Rejected, order.GetRemainingQuantity() };
+		}
+
+		// Whatever crosses trades first, straight against the other side. Only what's left of the order can reach the book.
+		if (CanMatch<side>(order.GetPrice()))
+		{
+			const bool live = Sweep<side>(order, trades);
+			OB_STATS(if (order.GetFilledQuantity() != 0) stats_.fills_[type].Add());
+
+			if (!live)
+			{
+				OB_STATS(stats_.cancels_[type].Add());
+				return CommandResult{ CommandStatus::Cancelled, order.GetRemainingQuantity() };
+			}
+		}
+
+		if (order.IsFilled())
+			return CommandResult{ CommandStatus::Accepted, 0 };
 
-			quantity -= levelData.quantity_;
+		if (!rests)
+		{
+			OB_STATS(stats_.cancels_[type].Add());
+			return CommandResult{ CommandStatus::Cancelled, order.GetRemainingQuantity() };
 		}
 
-		return false;
+		// From here on the book works with its own copy of the order, which lives in the pool until the order leaves the book.
+		OrderHandle resting = pool_.Create(order);
+
+		// remember, this returns an 'OrderList' object, to which we then append the order below.
+		//  notice that orders is a reference, because we need to be able to mutate the list that is contained at the price level indicated by order.GetPrice().
+		auto& orders = levels.GetOrCreateLevel(order.GetPrice());
+		BeforeLevelChange(side, order.GetPrice(), orders);
+		orders.push_back(*resting);
+		OB_STATS(if (orders.size() == 1) stats_.levelsCreated_.Add());
+
+		orders_.Insert(order.GetOrderId(), resting); // mutating internal map/state here.
+		owners_.Insert(*resting);
+
+		OnOrderAdded<side>(*resting, orders);
+
+		if constexpr (Types::Expiring)
+			if (order.Expires())
+				ScheduleExpiry(order);
+
+		return CommandResult{ CommandStatus::Accepted, order.GetRemainingQuantity() };
 	}
 
-	
-	bool OrderBook::CanMatch(Side side, Price price) const 
+	/*
+	* We refactor our previous CancelOrder function into a private CancelOrderInternal for the sake of avoiding
+	*	owning and releasing locks multiple times, which leads to cache incoherence/inefficiency.
+	*/
+	template <typename Policies>
+	CommandResult BasicOrderBook<Policies>::CancelOrderInternal(OrderId orderId)
 	{
-		if (side == Side::Buy)
-		{
-			if (asks_.empty())
-				return false;
+		/* One probe finds the order and takes its id out of the index, 'handle' is the order in the pool (See orders_ in the header).
+		*  The order itself still lives in the pool until the cancel below releases it. */
+		const OrderHandle handle = orders_.Extract(orderId);
+		if (!handle)
+			return CommandResult{ CommandStatus::Rejected, 0 };
 
-			// 'asks_' is a map that contains keys of type 'Price' and values of type 'OrderPointers', which is a list of 
-			//   OrderPointer objects (or shared pointers that point to 'Order') [complex, I know!]
-			//  'asks_.begin()' returns an iterator to the first element in this map, which is an iterator/pointer to the first element.
-			//  Deferencing this iterator returns a pair of type 'pair<Price, OrderPointers>' [simplified]
-			//  I then assign this pair to two variables, 'bestAsk' (the key) and '_' (the list of orders at the price level).
-			//  Because 'asks_' is sorted in ascending order, the first element will be the best (or lowest) selling price.
-			const auto& [bestAsk, _] = *asks_.begin();
-			return price >= bestAsk;
-		}
+		// read before the cancel hands the slot back to the pool
+		const Quantity remaining = handle->GetRemainingQuantity();
+
+		if (handle->GetSide() == Side::Sell)
+			CancelOrderFromSide<Side::Sell>(*handle);
 		else
+			CancelOrderFromSide<Side::Buy>(*handle);
+
+		return CommandResult{ CommandStatus::Accepted, remaining };
+	}
+
+	// Takes the order off its level and hands its slot back to the pool. The caller has already erased it from orders_.
+	template <typename Policies>
+	template <Side side>
+	void BasicOrderBook<Policies>::CancelOrderFromSide(RestingOrder& order)
+	{
+		OB_STATS(stats_.cancels_[ToIndex(order.GetOrderType())].Add());
+
+		auto& levels = GetLevels<side>();
+		const auto price = order.GetPrice();
+		auto& orders = levels.GetLevel(price);
+		BeforeLevelChange(side, price, orders);
+		/*
+		*  This is why the intrusive links inside RestingOrder are so important, because they allow to easily
+		*    erase orders from the *list* of orders at any price level when calling this CancelOrder method.
+		*/
+		orders.erase(order);
+		OnOrderCancelled<side>(order, orders);
+		if (orders.empty())
 		{
-			if (bids_.empty())
-				return false;
+			levels.EraseLevel(price); // if no orders in this particular price level, remove it from the internal dictionary.
+			OB_STATS(stats_.levelsDestroyed_.Add());
+		}
+
+		owners_.Erase(order);
+		pool_.Release(&order);
+	}
+
+	template <typename Policies>
+	template <Side side>
+	void BasicOrderBook<Policies>::CancelLevel(Price price)
+	{
+		auto& levels = GetLevels<side>();
+		auto& orders = levels.GetLevel(price);
+		BeforeLevelChange(side, price, orders);
+
+		orders.clear_and_dispose([this](RestingOrder& order)
+			{
+				OB_STATS(stats_.cancels_[ToIndex(order.GetOrderType())].Add());
+				orders_.Erase(order.GetOrderId());
+				owners_.Erase(order);
+				pool_.Release(&order);
+			});
+
+		OnLevelChanged<side>(price, orders);
+		levels.EraseLevel(price);
+		OB_STATS(stats_.levelsDestroyed_.Add());
+	}
 
-			const auto& [bestBid, _] = *bids_.begin();
-			return price <= bestBid;
+	template <typename Policies>
+	template <Side side>
+	void BasicOrderBook<Policies>::CancelSideInternal()
+	{
+		auto& levels = GetLevels<side>();
+		while (!levels.Empty())
+			CancelLevel<side>(levels.GetBestPrice());
+	}
+
+	template <typename Policies>
+	template <Side side>
+	void BasicOrderBook<Policies>::CancelRangeInternal(Price lowPrice, Price highPrice)
+	{
+		// Levels come best first, so the walk stops at the first one past the far end of the range (the low end for bids, the high end for asks).
+		cancelPrices_.clear();
+		GetLevels<side>().ForEachLevel([this, lowPrice, highPrice](Price price, const OrderList&)
+			{
+				if (side == Side::Buy ? price < lowPrice : price > highPrice)
+					return false;
+
+				if (price >= lowPrice and price <= highPrice)
+					cancelPrices_.push_back(price);
+				return true;
+			});
+
+		for (const Price price : cancelPrices_)
+			CancelLevel<side>(price);
+	}
+
+	template <typename Policies>
+	void BasicOrderBook<Policies>::CancelOwnerInternal(OwnerId owner)
+	{
+		// Every cancel unlinks the owner's oldest order, so the next one moves up to the front.
+		while (const OrderHandle order = owners_.Front(owner))
+		{
+			orders_.Erase(order->GetOrderId());
+
+			if (order->GetSide() == Side::Buy)
+				CancelOrderFromSide<Side::Buy>(*order);
+			else
+				CancelOrderFromSide<Side::Sell>(*order);
 		}
 	}
 
-	Trades OrderBook::MatchOrders()
+	/* Modify Order method
+	*   can be thought of as a combination of cancel order and add order method, done under the caller's single lock,
+	*   so no other thread can slip in between the cancel and the add. A modify that only takes quantity off is done in place instead.	*/
+	template <typename Policies>
+	CommandResult BasicOrderBook<Policies>::MatchOrderInternal(OrderModify order, Trades& trades)
 	{
-		Trades trades{};
-		trades.reserve(orders_.size());
+		OB_STATS(stats_.modifies_.Add());
+
+		const OrderHandle existingOrder = orders_.Find(order.GetOrderId());
+		if (!existingOrder)
+			return CommandResult{ CommandStatus::Rejected, order.GetQuantity() };
 
-		while (true)
+		/* Same side, same price and no bigger: the order just shrinks where it is and keeps its time priority.
+		*  It can't trade either, it was resting at that price already. What quote adjusting market makers send most. */
+		if (order.GetSide() == existingOrder->GetSide() and order.GetPrice() == existingOrder->GetPrice()
+			and order.GetQuantity() != 0 and order.GetQuantity() <= existingOrder->GetRemainingQuantity())
 		{
-			if (bids_.empty() or asks_.empty())
-				break;
+			if (order.GetSide() == Side::Buy)
+				ReduceOrder<Side::Buy>(*existingOrder, order.GetQuantity());
+			else
+				ReduceOrder<Side::Sell>(*existingOrder, order.GetQuantity());
+			return CommandResult{ CommandStatus::Accepted, order.GetQuantity() };
+		}
 
-			auto& [bidPrice, bids] = *bids_.begin(); // returns price level of buy orders with highest price, as well as a list of those buy orders
-			auto& [askPrice, asks] = *asks_.begin(); // returns price level of sell orders with lowest price, as well as a list of those sell orders
+		// read the type and expiry before cancelling, the cancel hands the existing order's slot back to the pool
+		const OrderDetails& details = OrderPool::GetDetails(*existingOrder);
+		const OrderType orderType = existingOrder->GetOrderType();
+		const Timestamp expiry = details.GetExpiry();
+		const OwnerId owner = details.GetOwner();
+		CancelOrderInternal(order.GetOrderId());
+		const CommandResult result = AddOrderInternal(order.ToOrder(orderType, expiry, owner), trades);
 
-			// If the highest buy offer is less than the smallest sell offer, we can't match anything (think of how the orders are organized, see comments above in "CanMatch" method)
-			if (bidPrice < askPrice)
-				break;
+		// The original order is gone by now, so the modify did change the book even if its replacement was turned away.
+		if (result.status_ == CommandStatus::Rejected)
+			return CommandResult{ CommandStatus::Cancelled, result.remaining_ };
+
+		return result;
+	}
+
+	template <typename Policies>
+	template <Side side>
+	void BasicOrderBook<Policies>::ReduceOrder(RestingOrder& order, Quantity quantity)
+	{
+		if (quantity == order.GetRemainingQuantity())
+			return;
+
+		OB_STATS(stats_.reductions_.Add());
+
+		auto& orders = GetLevels<side>().GetLevel(order.GetPrice());
+		BeforeLevelChange(side, order.GetPrice(), orders);
+		OrderPool::GetDetails(order).Reduce(order.GetRemainingQuantity() - quantity);
+		orders.Reduce(order, quantity);
+		OnLevelChanged<side>(order.GetPrice(), orders);
+	}
 
-			while (bids.size() and asks.size())
+	template <typename Policies>
+	void BasicOrderBook<Policies>::CancelGoodForDayOrdersInternal()
+	{
+		OB_STATS(const auto start = std::chrono::steady_clock::now());
+
+		// collect first, cancelling while walking the index would change it under our feet
+		OrderIds orderIds;
+		orders_.ForEach([&orderIds](const RestingOrder* order)
 			{
-				auto& bid = bids.front();
-				auto& ask = asks.front();
+				if (order->GetOrderType() == OrderType::GoodForDay)
+					orderIds.push_back(order->GetOrderId());
+			});
 
-				// The quantity that can be filled is the minimum between both orders, as we cannot "overfill" an order.
-				Quantity quantity = std::min(bid->GetRemainingQuantity(), ask->GetRemainingQuantity());
+		for (const auto& orderId : orderIds)
+			CancelOrderInternal(orderId);
 
-				bid->Fill(quantity);
-				ask->Fill(quantity);
+		// all of it under the caller's lock, which is exactly the stall this measures
+		OB_STATS(const std::uint64_t held = NanosecondsSince(start));
+		OB_STATS(stats_.expiryRuns_.Add());
+		OB_STATS(stats_.expiryLockTime_.Add(held));
+		OB_STATS(stats_.expiryLockMax_.Max(held));
+	}
 
-				if (bid->IsFilled())
-				{
-					bids.pop_front();
-					orders_.erase(bid->GetOrderId());
-				}
+	template <typename Policies>
+	std::size_t BasicOrderBook<Policies>::ExpireOrdersInternal(Timestamp now)
+	{
+		OB_STATS(const auto start = std::chrono::steady_clock::now());
 
-				if (ask->IsFilled())
-				{
-					asks.pop_front();
-					orders_.erase(ask->GetOrderId());
-				}
+		// Dead entries count towards the chunk too, so one pass is bounded whatever the queue holds.
+		std::size_t popped = 0;
+		std::size_t expired = 0;
+		while (popped < expiryChunk_ and expiry_.HasDue(now))
+		{
+			const ExpiryQueue::Entry entry = expiry_.Top();
+			expiry_.Pop();
+			++popped;
 
-				trades.push_back(Trade{
-					TradeInfo{ bid->GetOrderId(), bid->GetPrice(), quantity },
-					TradeInfo{ ask->GetOrderId(), ask->GetPrice(), quantity }
-					});
+			if (!IsLiveExpiry(entry))
+				continue;
 
-				OnOrderMatched(bid->GetPrice(), quantity, bid->IsFilled());
-				OnOrderMatched(ask->GetPrice(), quantity, ask->IsFilled());
-			}
+			CancelOrderInternal(entry.orderId_);
+			++expired;
+		}
 
-			if (bids.empty())
-				bids_.erase(bidPrice);
+		PublishNextExpiry();
 
-			if (asks.empty())
-				asks_.erase(askPrice);
+		OB_STATS(const std::uint64_t held = NanosecondsSince(start));
+		OB_STATS(stats_.expiryRuns_.Add());
+		OB_STATS(stats_.expiryLockTime_.Add(held));
+		OB_STATS(stats_.expiryLockMax_.Max(held));
+		return expired;
+	}
+
+	template <typename Policies>
+	void BasicOrderBook<Policies>::ScheduleExpiry(const Order& order)
+	{
+		// Dead entries are only dropped in bulk, once there are clearly more of them than live orders.
+		if (expiry_.Size() > 2 * orders_.Size() + 1024)
+			expiry_.Compact([this](const ExpiryQueue::Entry& entry) { return IsLiveExpiry(entry); });
+
+		expiry_.Push(order.GetExpiry(), order.GetOrderId());
+		PublishNextExpiry();
+
+		// the prune thread is asleep until a later expiry, it has to look again
+		if (Locking::Enabled and !singleWriter_ and order.GetExpiry() < nextExpiryWake_)
+			expiryConditionVariable_.notify_one();
+	}
+
+	template <typename Policies>
+	void BasicOrderBook<Policies>::PublishNextExpiry()
+	{
+		nextExpiry_.store(expiry_.Empty() ? Timestamp::max() : expiry_.Top().expiry_, std::memory_order_relaxed);
+	}
+
+	template <typename Policies>
+	bool BasicOrderBook<Policies>::IsLiveExpiry(const ExpiryQueue::Entry& entry) const
+	{
+		const OrderHandle order = orders_.Find(entry.orderId_);
+		if (!order)
+			return false;
+
+		return order->Expires() and OrderPool::GetDetails(*order).GetExpiry() == entry.expiry_;
+	}
+
+	template <typename Policies>
+	Timestamp BasicOrderBook<Policies>::GetSessionClose(Timestamp now)
+	{
+		// The next close is the same for every 'now' between the time it was worked out and the close itself, which saves a calendar conversion per order.
+		if (now < sessionCloseFrom_ or now >= sessionCloseCache_)
+		{
+			sessionCloseFrom_ = now;
+			sessionCloseCache_ = NextSessionClose(now, sessionClose_);
 		}
 
-		// Don't forget to handle FillAndKill orders
-		if (!bids_.empty())
+		return sessionCloseCache_;
+	}
+
+	template <typename Policies>
+	CommandResult BasicOrderBook<Policies>::ApplyInternal(const Command& command, Trades& trades)
+	{
+		/* A GoodForDay order lives until the next session close after it arrived. It is worked out here, before journaling,
+		*  so the journal holds the actual expiry and a replay on another day expires the order exactly as it did the first time. */
+		if (Types::Supports(OrderType::GoodForDay) and
+			command.type_ == CommandType::Add and command.orderType_ == OrderType::GoodForDay and command.time_ == Timestamp{})
 		{
-			auto& [_, bids] = *bids_.begin();
-			auto& order = bids.front();
-			if (order->GetOrderType() == OrderType::FillAndKill)
-				CancelOrder(order->GetOrderId());
+			Command stamped{ command };
+			stamped.time_ = GetSessionClose(std::chrono::system_clock::now());
+			return ApplyInternal(stamped, trades);
 		}
 
-		if (!asks_.empty())
+		// The book is live again, the prune thread can catch up on whatever expired meanwhile.
+		if (replaying_) [[unlikely]]
 		{
-			auto& [_, asks] = *asks_.begin();
-			auto& order = asks.front();
-			if (order->GetOrderType() == OrderType::FillAndKill)
-				CancelOrder(order->GetOrderId());
+			replaying_ = false;
+			if (Locking::Enabled and !singleWriter_)
+				expiryConditionVariable_.notify_one();
 		}
 
-		return trades;
+		// Write-ahead: logged even if the book then rejects it, replaying it rejects it again the same way.
+		if (journal_)
+			journal_->Append(command);
+
+		return ExecuteInternal(command, trades);
 	}
 
-	void OrderBook::CancelOrders(OrderIds orderIds)
+	template <typename Policies>
+	CommandResult BasicOrderBook<Policies>::ExecuteInternal(const Command& command, Trades& trades)
 	{
-		// why scoped_lock here?
-		// mutex is only acquired once, regardless of the number of orders in orderIds
-		std::scoped_lock<std::mutex> ordersLock{ ordersMutex_ };
+		switch (command.type_)
+		{
+		case CommandType::Add:
+			return AddOrderInternal(command.ToOrder(), trades);
+		case CommandType::Cancel:
+			return CancelOrderInternal(command.orderId_);
+		case CommandType::Modify:
+			return MatchOrderInternal(command.ToOrderModify(), trades);
+		case CommandType::CancelGoodForDay:
+			CancelGoodForDayOrdersInternal();
+			break;
+		case CommandType::Expire:
+			ExpireOrdersInternal(command.time_);
+			break;
+		case CommandType::CancelSide:
+			if (command.side_ == Side::Buy)
+				CancelSideInternal<Side::Buy>();
+			else
+				CancelSideInternal<Side::Sell>();
+			break;
+		case CommandType::CancelRange:
+			if (command.side_ == Side::Buy)
+				CancelRangeInternal<Side::Buy>(command.price_, command.highPrice_);
+			else
+				CancelRangeInternal<Side::Sell>(command.price_, command.highPrice_);
+			break;
+		case CommandType::CancelOwner:
+			CancelOwnerInternal(command.owner_);
+			break;
+		}
 
-		for (const auto& orderId : orderIds)
-			CancelOrderInternal(orderId);
+		return CommandResult{};
 	}
 
-	/*
-	* We refactor our previous CancelOrder function into a private CancelOrderInternal for the sake of avoiding
-	*	owning and releasing locks multiple times, which leads to cache incoherence/inefficiency.
-	*/
-	void OrderBook::CancelOrderInternal(OrderId orderId)
+	template <typename Policies>
+	void BasicOrderBook<Policies>::PreserveLevel(Side side, Price price, const OrderList& level)
 	{
-		if (!orders_.contains(orderId))
+		if (!capture_.Claim(side, price) or level.empty())
 			return;
 
-		// 'order' is an OrderPointer object, 'it' is an OrderPointers::iterator object (See OrderEntry struct above, order_ and location_ fields respectively).
-		const auto [order, it] = orders_.at(orderId); //O(1) access here, since orders_ is a dictionary/map =]
-		// This statement merely removes this orderId entry from the dictionary, but remember that the values stored at this key are pointers,
-		//  and this pointers are not yet "destroyed" (since they are shared pointers, they are destroyed automatically once no more owners to the underlying object exist).
-		orders_.erase(orderId);
+		auto records = capture_.AddPreserved(side, ToSnapshotLevel(price, level));
+		std::size_t i = 0;
+		for (const auto& order : level)
+			records[i++] = ToSnapshotOrder(order);
+	}
+
+	template <typename Policies>
+	bool BasicOrderBook<Policies>::CaptureChunk() const
+	{
+		auto ordersLock = LockOrders();
+
+		std::size_t budget = snapshotChunk_;
+		const bool done = CaptureLevels<Side::Buy>(budget) and CaptureLevels<Side::Sell>(budget);
+		// Ended under the same lock as the last copy, nothing can change in between.
+		if (done)
+			capture_.End();
+
+		return !done;
+	}
+
+	template <typename Policies>
+	template <Side side>
+	bool BasicOrderBook<Policies>::CaptureLevels(std::size_t& budget) const
+	{
+		if (capture_.IsFinished(side))
+			return true;
 
-		if (order->GetSide() == Side::Sell)
+		// The rest of the level the last chunk ran out in first.
+		if (const RestingOrder* resume = capture_.GetResume(side))
 		{
-			auto price = order->GetPrice();
-			auto& orders = asks_.at(price);
-			/*
-			*  This is why the iterator member in an OrderEntry object is so important, because it allows to easily
-			*    erase orders from the *list* of orders at any price level when calling this CancelOrder method.
-			*/
-			orders.erase(it);
-			if (orders.empty())
-				asks_.erase(price); // if no orders in this particular price level, remove it from the internal dictionary.
+			capture_.SetResume(side, CopyOrders(resume, budget));
+			if (capture_.GetResume(side))
+				return false;
 		}
+
+		bool stopped = false;
+		const auto visitor = [this, &budget, &stopped](Price price, const OrderList& orders)
+			{
+				if (budget == 0)
+				{
+					stopped = true;
+					return false;
+				}
+
+				capture_.Advance(side, price);
+
+				// A claimed level changed after the capture began, what it was then has been preserved already.
+				if (capture_.IsClaimed(side, price))
+				{
+					--budget;
+					return true;
+				}
+
+				capture_.AddCopied(side, ToSnapshotLevel(price, orders));
+				capture_.SetResume(side, CopyOrders(&orders.front(), budget));
+				stopped = capture_.GetResume(side) != nullptr;
+				return !stopped;
+			};
+
+		if (const auto cursor = capture_.GetCursor(side))
+			GetLevels<side>().ForEachLevelAfter(*cursor, visitor);
 		else
+			GetLevels<side>().ForEachLevel(visitor);
+
+		if (!stopped)
+			capture_.Finish(side);
+
+		return !stopped;
+	}
+
+	template <typename Policies>
+	const RestingOrder* BasicOrderBook<Policies>::CopyOrders(const RestingOrder* from, std::size_t& budget) const
+	{
+		OrderList::ConstIterator it{ from };
+		for (; it != OrderList::ConstIterator{} and budget != 0; ++it, --budget)
+			capture_.AddCopiedOrder() = ToSnapshotOrder(*it);
+
+		return it == OrderList::ConstIterator{} ? nullptr : &*it;
+	}
+
+	template <typename Policies>
+	SnapshotLevel BasicOrderBook<Policies>::ToSnapshotLevel(Price price, const OrderList& orders)
+	{
+		return SnapshotLevel{ price, static_cast<std::uint32_t>(orders.size()), orders.GetQuantity() };
+	}
+
+	template <typename Policies>
+	SnapshotOrder BasicOrderBook<Policies>::ToSnapshotOrder(const RestingOrder& order)
+	{
+		const OrderDetails& details = OrderPool::GetDetails(order);
+
+		SnapshotOrder record{};
+		record.orderId_ = order.GetOrderId();
+		record.price_ = order.GetPrice();
+		record.initialQuantity_ = details.GetInitialQuantity();
+		record.remainingQuantity_ = order.GetRemainingQuantity();
+		record.owner_ = details.GetOwner();
+		record.orderType_ = static_cast<std::uint8_t>(order.GetOrderType());
+		record.side_ = static_cast<std::uint8_t>(order.GetSide());
+		record.expiry_ = ToEpochNanoseconds(details.GetExpiry());
+		return record;
+	}
+
+	template <typename Policies>
+	const std::byte* BasicOrderBook<Policies>::ReadLevels(PriceLevels& levels, Side side, std::uint64_t count, const std::byte* in, const std::byte* end)
+	{
+		// OpenSnapshot already checked the file size against the header's counts, so this only guards against counts that disagree with each other.
+		for (std::uint64_t i = 0; i < count; ++i)
 		{
-			auto price = order->GetPrice();
-			auto& orders = bids_.at(price);
-			orders.erase(it);
-			if (orders.empty())
-				bids_.erase(price);
+			if (end - in < static_cast<std::ptrdiff_t>(sizeof(SnapshotLevel)))
+				throw std::runtime_error("Snapshot levels run past the end of the file.");
+
+			// The file is mapped page aligned and every record is a multiple of 8 bytes, so these are read in place.
+			const auto& level = *reinterpret_cast<const SnapshotLevel*>(in);
+			in += sizeof(SnapshotLevel);
+
+			if (!levels.IsValidPrice(level.price_) or level.orders_ == 0 or
+				end - in < static_cast<std::ptrdiff_t>(level.orders_ * sizeof(SnapshotOrder)))
+				throw std::runtime_error(std::format("Snapshot level ({}) is corrupt.", level.price_));
+
+			auto& orders = levels.GetOrCreateLevel(level.price_);
+			BeforeLevelChange(side, level.price_, orders);
+			const auto* records = reinterpret_cast<const SnapshotOrder*>(in);
+
+			for (std::uint32_t j = 0; j < level.orders_; ++j)
+			{
+				const auto& record = records[j];
+				if (record.price_ != level.price_ or static_cast<Side>(record.side_) != side or
+					record.remainingQuantity_ == 0 or record.remainingQuantity_ > record.initialQuantity_)
+					throw std::runtime_error(std::format("Snapshot order ({}) is corrupt.", record.orderId_));
+
+				if (!Types::Supports(static_cast<OrderType>(record.orderType_)))
+					throw std::runtime_error(std::format("Snapshot order ({}) has a type this book doesn't support.", record.orderId_));
+
+				Order order{ static_cast<OrderType>(record.orderType_), record.orderId_, side, record.price_, record.initialQuantity_,
+					FromEpochNanoseconds(record.expiry_), record.owner_ };
+				order.Fill(record.initialQuantity_ - record.remainingQuantity_);
+
+				OrderHandle resting = pool_.Create(order);
+				if (!orders_.Insert(record.orderId_, resting))
+				{
+					pool_.Release(resting);
+					throw std::runtime_error(std::format("Snapshot order ({}) appears twice.", record.orderId_));
+				}
+
+				orders.push_back(*resting);
+				owners_.Insert(*resting);
+
+				if (order.Expires())
+					expiry_.Push(order.GetExpiry(), order.GetOrderId());
+			}
+
+			if (orders.GetQuantity() != level.quantity_)
+				throw std::runtime_error(std::format("Snapshot level ({}) quantity doesn't match its orders.", level.price_));
+
+			levels.UpdateAggregates(level.price_);
+
+			in += level.orders_ * sizeof(SnapshotOrder);
 		}
 
-		OnOrderCancelled(order);
+		return in;
 	}
 
-	void OrderBook::OnOrderCancelled(OrderPointer order)
+	template <typename Policies>
+	template <Side side>
+	void BasicOrderBook<Policies>::OnOrderAdded(const RestingOrder& order, const OrderList& level)
 	{
-		UpdateLevelData(order->GetPrice(), order->GetRemainingQuantity(), LevelData::Action::Remove);
+		OnLevelChanged<side>(order.GetPrice(), level);
 	}
-	
-	void OrderBook::OnOrderAdded(OrderPointer order)
+
+	template <typename Policies>
+	template <Side side>
+	void BasicOrderBook<Policies>::OnOrderCancelled(const RestingOrder& order, const OrderList& level)
 	{
-		UpdateLevelData(order->GetPrice(), order->GetInitialQuantity(), LevelData::Action::Add);
+		OnLevelChanged<side>(order.GetPrice(), level);
 	}
 
-	void OrderBook::OnOrderMatched(Price price, Quantity quantity, bool isFullyFilled)
+	template <typename Policies>
+	template <Side side>
+	void BasicOrderBook<Policies>::OnLevelTraded(const Order& order, Price price, Quantity quantity, Quantity fills)
 	{
-		UpdateLevelData(price, quantity, isFullyFilled ? LevelData::Action::Remove : LevelData::Action::Match);
+		if (!marketData_)
+			return;
+
+		MarketDataEvent event{};
+		event.type_ = MarketDataEventType::LevelTrade;
+		event.levelTrade_ = LevelTradeEvent{ order.GetOrderId(), side, price, quantity, fills };
+		PublishMarketData(event);
 	}
 
-	void OrderBook::UpdateLevelData(Price price, Quantity quantity, LevelData::Action action)
+	template <typename Policies>
+	void BasicOrderBook<Policies>::OnOrderMatched(const Trade& trade)
 	{
-		auto& data = data_[price];
+		if (!marketData_)
+			return;
 
-		data.count_ += action == LevelData::Action::Remove ? -1 : action == LevelData::Action::Add ? 1 : 0;
-		if (action == LevelData::Action::Remove or action == LevelData::Action::Match)
-		{
-			data.quantity_ -= quantity;
-		}
-		else
-		{
-			data.quantity_ += quantity;
-		}
+		MarketDataEvent event{};
+		event.type_ = MarketDataEventType::Trade;
+		event.trade_ = TradeEvent{ trade.GetBidTrade(), trade.GetAskTrade() };
+		PublishMarketData(event);
+	}
+
+	template <typename Policies>
+	template <Side side>
+	void BasicOrderBook<Policies>::OnLevelChanged(Price price, const OrderList& level)
+	{
+		// every change to a level's quantity passes through here, which is what keeps the cumulative aggregates current
+		GetLevels<side>().UpdateAggregates(price);
+		depthDirty_ = true;
 
-		if (data.count_ == 0)
-			data_.erase(price);
+		if (!marketData_)
+			return;
+
+		MarketDataEvent event{};
+		event.type_ = MarketDataEventType::LevelUpdate;
+		event.level_ = LevelUpdateEvent{ side, price, level.GetQuantity(), static_cast<Quantity>(level.size()) };
+		PublishMarketData(event);
+	}
+
+	template <typename Policies>
+	void BasicOrderBook<Policies>::PublishMarketData(MarketDataEvent& event)
+	{
+		// The sequence number is consumed even if the ring is full, that is how the publisher finds out it missed something.
+		event.sequence_ = marketDataSequence_++;
+		marketData_->TryPush(event);
+	}
+
+	template <typename Policies>
+	void BasicOrderBook<Policies>::PublishDepthView()
+	{
+		// Rejected orders and cancels of unknown ids change nothing, readers keep the version they have.
+		if (!depthView_ or !depthDirty_)
+			return;
+
+		depthDirty_ = false;
+		const std::span<LevelInfo> bids{ depthScratch_.data(), depthView_->GetLevels() };
+		const std::span<LevelInfo> asks{ depthScratch_.data() + depthView_->GetLevels(), depthView_->GetLevels() };
+		depthView_->Publish(bids.first(bids_->GetDepth(bids)), asks.first(asks_->GetDepth(asks)), orders_.Size(), marketDataSequence_);
 	}
-	
 
 	/*******************************************************************
 	*							Public API							   *
 	********************************************************************/
 
-	OrderBook::OrderBook()
-		: ordersPruneThread_{ [this]() { PruneGoodForDayOrders(); } }
+	template <typename Policies>
+	BasicOrderBook<Policies>::BasicOrderBook()
+		: BasicOrderBook(OrderBookOptions{})
 	{ }
 
-	OrderBook::~OrderBook()
+	template <typename Policies>
+	BasicOrderBook<Policies>::BasicOrderBook(const OrderBookOptions& options)
+		: arena_{ options.arena_.size_ > 0 ? std::make_unique<MemoryArena>(options.arena_) : nullptr }
+		, arenaPools_{ arena_ ? std::make_unique<std::pmr::unsynchronized_pool_resource>(arena_.get()) : nullptr }
+		, memory_{ arenaPools_ ? static_cast<std::pmr::memory_resource*>(arenaPools_.get()) : std::pmr::get_default_resource() }
+		, pool_{ options.orderCapacity_, arena_ ? static_cast<std::pmr::memory_resource*>(arena_.get()) : std::pmr::get_default_resource() }
+		, orders_{ options.orderIdIndexing_, options.orderCapacity_, memory_ }
+		, owners_{ memory_ }
+		, cancelPrices_{ memory_ }
+		, tradeReporting_{ options.tradeReporting_ }
+		, selfTradePrevention_{ options.selfTradePrevention_ }
+		, journal_{ options.journal_ }
+		, singleWriter_{ !Locking::Enabled or options.threading_ == Threading::SingleWriter }
+		, expiry_{ memory_ }
+		, sessionClose_{ options.sessionClose_ }
+		, expiryChunk_{ options.expiryChunk_ == 0 ? 1 : options.expiryChunk_ }
+		, snapshotChunk_{ options.snapshotChunk_ == 0 ? 1 : options.snapshotChunk_ }
 	{
-		shutdown_.store(true, std::memory_order_release);
-		shutdownConditionVariable_.notify_one();
-		ordersPruneThread_.join();
+		if (options.marketDataCapacity_ > 0)
+			marketData_ = std::make_unique<SpscRing<MarketDataEvent>>(options.marketDataCapacity_);
+
+		if (options.depthViewLevels_ > 0)
+		{
+			depthView_ = std::make_unique<DepthView>(options.depthViewLevels_);
+			depthScratch_.resize(2 * options.depthViewLevels_);
+		}
+
+		bids_ = Levels::template Create<Side::Buy>(options, memory_);
+		asks_ = Levels::template Create<Side::Sell>(options, memory_);
+
+		// started last, once the book it prunes is fully constructed.
+		//  A single-writer book has no other thread allowed in, its owner sends Command::Expire itself. Without expiring order types there is nothing to prune.
+		if constexpr (Types::Expiring)
+			if (!singleWriter_)
+				ordersPruneThread_ = std::thread{ [this]() { PruneExpiredOrders(); } };
 	}
 
-	Trades OrderBook::AddOrder(OrderPointer order)
+	template <typename Policies>
+	BasicOrderBook<Policies>::~BasicOrderBook()
 	{
-		std::scoped_lock<std::mutex> ordersLock{ ordersMutex_ };
-
-		/* Exit condition */
-		if (orders_.contains(order->GetOrderId()))
-			return { };
-		
-		/********* Market Orders **********/
-		// We leverage our GoodTillCancel Orders to implement Market orders
-		if (order->GetOrderType() == OrderType::Market)
 		{
-			if (order->GetSide() == Side::Buy and !asks_.empty())
-			{
-				const auto& [worstAsk, _] = *asks_.rbegin();
-				order->ToGoodTillCancel(worstAsk);
-			}
-			else if (order->GetSide() == Side::Sell and !bids_.empty())
-			{
-				const auto& [worstBid, _] = *bids_.rbegin();
-				order->ToGoodTillCancel(worstBid);
-			}
-			else
-				return { };
+			// under the lock, so the prune thread is either before its shutdown_ check or already waiting, never in between
+			auto ordersLock = LockOrders();
+			shutdown_.store(true, std::memory_order_release);
 		}
+		expiryConditionVariable_.notify_one();
+		if (ordersPruneThread_.joinable())
+			ordersPruneThread_.join();
+	}
 
-		/********* FillAndKill orders **********/
-		if (order->GetOrderType() == OrderType::FillAndKill and !CanMatch(order->GetSide(), order->GetPrice()))
-			return { };
+	template <typename Policies>
+	Trades BasicOrderBook<Policies>::AddOrder(Order order)
+	{
+		auto ordersLock = LockOrders();
 
-		/********* FillOrKill orders **********/
-		if (order->GetOrderType() == OrderType::FillOrKill and !CanFullyFill(order->GetSide(), order->GetPrice(), order->GetInitialQuantity()))
-			return { };
+		// Not reserved: most adds don't trade, and an empty vector costs nothing.
+		Trades trades{};
+		ApplyInternal(Command::Add(order), trades);
+		PublishDepthView();
+		return trades;
+	}
+
+	template <typename Policies>
+	void BasicOrderBook<Policies>::AddOrder(Order order, Trades& trades)
+	{
+		auto ordersLock = LockOrders();
+
+		trades.clear();
+		ApplyInternal(Command::Add(order), trades);
+		PublishDepthView();
+	}
+
+	template <typename Policies>
+	void BasicOrderBook<Policies>::CancelOrder(OrderId orderId)
+	{
+		auto ordersLock = LockOrders();
+
+		Trades none{};
+		ApplyInternal(Command::Cancel(orderId), none);
+		PublishDepthView();
+	}
+
+	template <typename Policies>
+	void BasicOrderBook<Policies>::CancelGoodForDayOrders()
+	{
+		auto ordersLock = LockOrders();
+
+		Trades none{};
+		ApplyInternal(Command::CancelGoodForDay(), none);
+		PublishDepthView();
+	}
+
+	template <typename Policies>
+	void BasicOrderBook<Policies>::CancelSide(Side side)
+	{
+		auto ordersLock = LockOrders();
+
+		Trades none{};
+		ApplyInternal(Command::CancelSide(side), none);
+		PublishDepthView();
+	}
+
+	template <typename Policies>
+	void BasicOrderBook<Policies>::CancelRange(Side side, Price lowPrice, Price highPrice)
+	{
+		auto ordersLock = LockOrders();
+
+		Trades none{};
+		ApplyInternal(Command::CancelRange(side, lowPrice, highPrice), none);
+		PublishDepthView();
+	}
+
+	template <typename Policies>
+	void BasicOrderBook<Policies>::CancelOwnerOrders(OwnerId owner)
+	{
+		auto ordersLock = LockOrders();
+
+		Trades none{};
+		ApplyInternal(Command::CancelOwner(owner), none);
+		PublishDepthView();
+	}
+
+	template <typename Policies>
+	bool BasicOrderBook<Policies>::ExpireOrders(Timestamp now)
+	{
+		auto ordersLock = LockOrders();
+
+		Trades none{};
+		ApplyInternal(Command::Expire(now), none);
+		PublishDepthView();
+		return expiry_.HasDue(now);
+	}
+
+	template <typename Policies>
+	bool BasicOrderBook<Policies>::HasExpiredOrders(Timestamp now) const
+	{
+		auto ordersLock = LockOrders();
 
-		OrderPointers::iterator it{};
+		return expiry_.HasDue(now);
+	}
+
+	template <typename Policies>
+	Trades BasicOrderBook<Policies>::Apply(const Command& command)
+	{
+		auto ordersLock = LockOrders();
+
+		Trades trades{};
+		ApplyInternal(command, trades);
+		PublishDepthView();
+		return trades;
+	}
+
+	template <typename Policies>
+	CommandResult BasicOrderBook<Policies>::Apply(const Command& command, Trades& trades)
+	{
+		auto ordersLock = LockOrders();
+
+		trades.clear();
+		const CommandResult result = ApplyInternal(command, trades);
+		PublishDepthView();
+		return result;
+	}
+
+	template <typename Policies>
+	Trades BasicOrderBook<Policies>::MatchOrder(OrderModify order)
+	{
+		auto ordersLock = LockOrders();
+
+		Trades trades{};
+		ApplyInternal(Command::Modify(order), trades);
+		PublishDepthView();
+		return trades;
+	}
+
+	template <typename Policies>
+	void BasicOrderBook<Policies>::MatchOrder(OrderModify order, Trades& trades)
+	{
+		auto ordersLock = LockOrders();
+
+		trades.clear();
+		ApplyInternal(Command::Modify(order), trades);
+		PublishDepthView();
+	}
+
+	template <typename Policies>
+	void BasicOrderBook<Policies>::AddOrders(std::span<const Order> orders, Trades& trades)
+	{
+		// mutex is only acquired once, regardless of the number of orders in the batch
+		auto ordersLock = LockOrders();
+
+		// Most orders trade at most once, so one slot per order is a fair guess. A reused buffer already has the room and doesn't allocate.
+		trades.reserve(trades.size() + orders.size());
+
+		for (const auto& order : orders)
+			ApplyInternal(Command::Add(order), trades);
+
+		PublishDepthView();
+	}
+
+	template <typename Policies>
+	void BasicOrderBook<Policies>::CancelOrders(std::span<const OrderId> orderIds)
+	{
+		// mutex is only acquired once, regardless of the number of orders in orderIds
+		auto ordersLock = LockOrders();
+
+		Trades none{};
+		for (const auto& orderId : orderIds)
+			ApplyInternal(Command::Cancel(orderId), none);
+
+		PublishDepthView();
+	}
+
+	template <typename Policies>
+	void BasicOrderBook<Policies>::Apply(std::span<const Command> commands, Trades& trades)
+	{
+		auto ordersLock = LockOrders();
+
+		trades.reserve(trades.size() + commands.size());
+
+		for (const auto& command : commands)
+			ApplyInternal(command, trades);
+
+		PublishDepthView();
+	}
+
+	template <typename Policies>
+	void BasicOrderBook<Policies>::Replay(std::span<const Command> commands, Trades& trades)
+	{
+		auto ordersLock = LockOrders();
+
+		replaying_ = true;
+		trades.reserve(trades.size() + commands.size());
+
+		for (const auto& command : commands)
+			ExecuteInternal(command, trades);
+
+		PublishDepthView();
+	}
+
+	template <typename Policies>
+	void BasicOrderBook<Policies>::SaveSnapshot(const std::filesystem::path& path) const
+	{
+		std::scoped_lock captureLock{ snapshotMutex_ };
 
-		if (order->GetSide() == Side::Buy)
 		{
-			// remember, this returns an 'OrderPointers' object, or a std::list<OrderPointer> object, to which we then add the order pointer below.
-			//  notice that orders is a reference, because we need to be able to mutate the list that is contained at the price level indicated by order->GetPrice().
-			auto& orders = bids_[order->GetPrice()];
-			orders.push_back(order);
-			// iterator is assigned to be the last element in the orders container (not 'orders.end()'), i.e, the element we just "pushed back".
-			//  this corresponds to the second element of an OrderEntry object, the "location".
-			it = std::next(orders.begin(), orders.size() - 1);
+			auto ordersLock = LockOrders();
+			capture_.Begin(journal_ ? journal_->GetNextSequence() : 0, orders_.Size(), bids_->GetLevelCount(), asks_->GetLevelCount());
 		}
-		else
+
+		try
+		{
+			while (CaptureChunk())
+			{ }
+		}
+		catch (...)
 		{
-			auto& orders = asks_[order->GetPrice()];
-			orders.push_back(order);
-			it = std::next(orders.begin(), orders.size() - 1);
+			// Out of memory copying, don't leave every later change to the book preserving levels for a capture nobody finishes.
+			auto ordersLock = LockOrders();
+			capture_ = SnapshotCapture{};
+			throw;
 		}
 
-		orders_.insert({ order->GetOrderId(), OrderEntry{ order, it } }); // mutating internal map/state here.
+		WriteSnapshot(path, capture_.TakeImage());
+	}
 
-		OnOrderAdded(order);
-		
-		return MatchOrders();
+	template <typename Policies>
+	std::uint64_t BasicOrderBook<Policies>::LoadSnapshot(const std::filesystem::path& path)
+	{
+		const MappedFile file = OpenSnapshot(path);
+
+		auto ordersLock = LockOrders();
+
+		if (orders_.Size() != 0)
+			throw std::logic_error("A snapshot can only be loaded into an empty book.");
+
+		SnapshotHeader header{};
+		std::memcpy(&header, file.Data(), sizeof(header));
+
+		const std::byte* end = file.Data() + file.Size();
+		const std::byte* in = ReadLevels(*bids_, Side::Buy, header.bidLevels_, file.Data() + sizeof(header), end);
+		ReadLevels(*asks_, Side::Sell, header.askLevels_, in, end);
+		PublishNextExpiry();
+
+		depthDirty_ = true;
+		PublishDepthView();
+
+		return header.journalSequence_;
 	}
 
-	void OrderBook::CancelOrder(OrderId orderId)
+	template <typename Policies>
+	OrderBookLevelInfos BasicOrderBook<Policies>::GetOrderInfos() const
 	{
-		// Why scoped_lock here?
-		std::scoped_lock<std::mutex> orderLocks{ ordersMutex_ };
+		auto ordersLock = LockOrders();
 
-		CancelOrderInternal(orderId);
+		LevelInfos bidInfos(bids_->GetLevelCount()), askInfos(asks_->GetLevelCount());
+
+		// Every level already knows its aggregate quantity, so this is one LevelInfo per level rather than a walk over every order.
+		bids_->GetDepth(bidInfos);
+		asks_->GetDepth(askInfos);
+
+		return OrderBookLevelInfos{ std::move(bidInfos), std::move(askInfos), marketDataSequence_ };
 	}
 
-	/* Modify Order method
-	*   can be thought of as a combination of cancel order and add order method		*/
-	Trades OrderBook::MatchOrder(OrderModify order)
+	template <typename Policies>
+	TopOfBook BasicOrderBook<Policies>::GetTopOfBook() const
 	{
-		if (!orders_.contains(order.GetOrderId()))
-			return { };
+		auto ordersLock = LockOrders();
+
+		TopOfBook top{};
+		bids_->GetDepth({ &top.bid_, 1 });
+		asks_->GetDepth({ &top.ask_, 1 });
 
-		// 'existingOrder' is an OrderPointer, '_' is a placeholder for OrderPointers::iterator object
-		const auto& [existingOrder, _] = orders_.at(order.GetOrderId());
-		CancelOrder(order.GetOrderId());
-		return AddOrder(order.ToOrderPointer(existingOrder->GetOrderType()));
+		return top;
 	}
 
-	OrderBookLevelInfos OrderBook::GetOrderInfos() const
+	template <typename Policies>
+	std::pair<std::size_t, std::size_t> BasicOrderBook<Policies>::GetDepth(std::span<LevelInfo> bids, std::span<LevelInfo> asks) const
 	{
-		LevelInfos bidInfos{}, askInfos{};
-		bidInfos.reserve(orders_.size());
-		askInfos.reserve(orders_.size());
+		auto ordersLock = LockOrders();
 
-		// Clever way of taking a single price level in the 'orders_' dictionary, and returning the sum of all the
-		//   remaining quantities of all the orders in that price level via lambda functions, while at the same time creating a 'LevelInfo' object.
-		// Take some time to understand how it works!
-		auto CreateLevelInfos = [](Price price, const OrderPointers& orders)
-			{
-				return LevelInfo{ price, std::accumulate(orders.begin(), orders.end(), (Quantity)0,
-					[](Quantity runningSum, const OrderPointer& order)
-					{ return runningSum + order->GetRemainingQuantity(); }) };
-			};
+		return { bids_->GetDepth(bids), asks_->GetDepth(asks) };
+	}
 
-		for (const auto& [price, orders] : bids_)
-			bidInfos.push_back(CreateLevelInfos(price, orders));
+	template <typename Policies>
+	void BasicOrderBook<Policies>::GetDepth(Side side, LevelArrays& levels) const
+	{
+		auto ordersLock = LockOrders();
 
-		for (const auto& [price, orders] : asks_)
-			askInfos.push_back(CreateLevelInfos(price, orders));
+		levels.Clear();
+		if (side == Side::Buy)
+			bids_->GetDepth(levels);
+		else
+			asks_->GetDepth(levels);
+	}
 
-		return OrderBookLevelInfos{ bidInfos, askInfos };
+	template <typename Policies>
+	std::uint64_t BasicOrderBook<Policies>::GetQuantityAtOrBetter(Side side, Price price) const
+	{
+		auto ordersLock = LockOrders();
+
+		if (side == Side::Buy)
+			return bids_->GetQuantityAtOrBetter(price, UINT64_MAX);
+		else
+			return asks_->GetQuantityAtOrBetter(price, UINT64_MAX);
+	}
+
+	template <typename Policies>
+	OrderBookStats BasicOrderBook<Policies>::GetStats() const
+	{
+#ifdef OB_ENABLE_STATS
+		return stats_.Snapshot();
+#else
+		return OrderBookStats{};
+#endif
 	}
-}
\ No newline at end of file
+
+	template <typename Policies>
+	std::size_t BasicOrderBook<Policies>::DrainMarketData(std::span<MarketDataEvent> events)
+	{
+		if (!marketData_)
+			return 0;
+
+		return marketData_->PopBatch(events);
+	}
+
+	template <typename Policies>
+	MemoryStats BasicOrderBook<Policies>::GetMemoryStats() const
+	{
+		auto ordersLock = LockOrders();
+
+		return arena_ ? arena_->GetStats() : MemoryStats{};
+	}
+
+	// The variants declared in the header. Everything above is compiled once for each of them, and only for them.
+	template class BasicOrderBook<OrderBookPolicies<>>;
+	template class BasicOrderBook<OrderBookPolicies<DynamicLevels, NoLocking>>;
+	template class BasicOrderBook<OrderBookPolicies<MapLevels, NoLocking, OrderTypes<OrderType::GoodTillCancel, OrderType::FillAndKill>>>;
+}
@@ -6,80 +6,345 @@
 #include "api/obTrade.hpp"
 #include "api/obOrderModify.hpp"
 #include "api/obOrderBookLevelInfos.hpp"
+#include "api/obTopOfBook.hpp"
+#include "api/obMarketDataEvent.hpp"
+#include "api/obSpscRing.hpp"
+#include "api/obCommand.hpp"
+#include "api/obOrderBookOptions.hpp"
+#include "api/obPriceLevels.hpp"
+#include "api/obOrderBookPolicies.hpp"
+#include "api/obOrderPool.hpp"
+#include "api/obOrderIndex.hpp"
+#include "api/obOwnerIndex.hpp"
+#include "api/obOrderBookStats.hpp"
+#include "api/obExpiryQueue.hpp"
+#include "api/obDepthView.hpp"
+#include "api/obMemoryArena.hpp"
+#include "api/obSnapshot.hpp"
 
 //lib
-#include <map>
-#include <unordered_map>
+#include <filesystem>
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <vector>
+#include <utility>
 #include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <atomic>
 
 namespace ob
 {
-	class OrderBook
+	/* The order book, specialized at compile time by its Policies (see obOrderBookPolicies.hpp):
+	*  the level containers, whether it locks, and which order types it supports.
+	*  Most code wants one of the aliases at the bottom of this file, OrderBook being the fully featured, runtime configured one.
+	*/
+	template <typename Policies>
+	class BasicOrderBook
 	{
 	private:
+		using Levels = typename Policies::Levels;
+		using Locking = typename Policies::Locking;
+		using Types = typename Policies::Types;
+		using BidLevels = typename Levels::template Container<Side::Buy>;
+		using AskLevels = typename Levels::template Container<Side::Sell>;
 
-		struct OrderEntry
-		{
-			OrderPointer order_{ nullptr };
-			OrderPointers::iterator location_;
-		};
+		/* Declared first so that it outlives every container allocating from it. Only there with OrderBookOptions::arena_,
+		*  the containers then allocate from arenaPools_, which recycles the small blocks they free and passes the large ones on to the arena's free list. */
+		std::unique_ptr<MemoryArena> arena_;
+		std::unique_ptr<std::pmr::unsynchronized_pool_resource> arenaPools_;
+		// arenaPools_, or the heap.
+		std::pmr::memory_resource* const memory_;
 
-		struct LevelData
-		{
-			Quantity quantity_{};
-			Quantity count_{};
-
-			enum class Action
-			{
-				Add,
-				Remove,
-				Match
-			};
-		};
-
-		// Bookkeeping data structure
-		std::unordered_map<Price, LevelData> data_;
-		/* These ordered maps organize orders by Price-Time priority.
-		*  This means that orders are first organized by price in the map, as price is the key of the map,
-		*  and then, orders in the same price level are organized by time priority, since the data structure in the value is a list,
+		/* These containers organize orders by Price-Time priority.
+		*  This means that orders are first organized by price, as price is the key of each level,
+		*  and then, orders in the same price level are organized by time priority, since the data structure of each level is a list,
 		*  meaning that if we retrieve the first item in this list, it corresponds to the first order that was placed for this particular price level.
+		*  Whether they are ordered maps or flat price ladders is decided by the Levels policy, or by OrderBookOptions at construction with DynamicLevels.
+		*  Each level also carries its own aggregates (quantity and order count), kept up to date as orders are added, filled and cancelled,
+		*  so market data never has to walk the orders themselves.
 		*/
-		std::map<Price, OrderPointers, std::greater<Price>> bids_{};
-		std::map<Price, OrderPointers, std::less<Price>> asks_{};
-		std::unordered_map<OrderId, OrderEntry> orders_{};
+		std::unique_ptr<BidLevels> bids_{};
+		std::unique_ptr<AskLevels> asks_{};
+		/* Storage for every resting order, declared before the containers that point into it.
+		*  Its slabs come straight from arena_ when there is one, they are only freed with the book so there is nothing for arenaPools_ to recycle. */
+		OrderPool pool_;
+		/* OrderId -> OrderHandle. The handle points into pool_, and since the level lists are intrusive it is also the order's position in its level,
+		*  so a single lookup here is all a cancel needs. */
+		OrderIndex orders_;
+		// Each owner's resting orders, for CancelOwnerOrders. Orders without an owner aren't in it.
+		OwnerIndex owners_;
+		// Prices of the levels a CancelRange is about to take out, kept to avoid allocating every time.
+		std::pmr::vector<Price> cancelPrices_;
+		/* Market-data delta feed, only allocated when OrderBookOptions::marketDataCapacity_ is not zero.
+		*  The book is its only producer (always under ordersMutex_), and the publisher draining it is its only consumer. */
+		std::unique_ptr<SpscRing<MarketDataEvent>> marketData_{};
+		std::uint64_t marketDataSequence_{ 0 };
+		// Trade events for every fill, or one per level swept (see OrderBookOptions::tradeReporting_).
+		const TradeReporting tradeReporting_;
+		const SelfTradePrevention selfTradePrevention_;
+		/* Top-N depth for lock-free readers, only allocated when OrderBookOptions::depthViewLevels_ is not zero.
+		*  Republished at the end of every public call that changed a level, from depthScratch_. */
+		std::unique_ptr<DepthView> depthView_{};
+		std::vector<LevelInfo> depthScratch_{};
+		bool depthDirty_{ false };
+		// Write-ahead journal from OrderBookOptions, or null.
+		JournalWriter* const journal_;
+		// Set by NoLocking or Threading::SingleWriter, in which case ordersMutex_ is never taken and there is no prune thread.
+		const bool singleWriter_;
 		mutable std::mutex ordersMutex_{};
-		/* The purpose of this thread is to wait until the end of the trading day, and then submit an unsolicited cancel to all GoodTillDay orders */
+
+		/* Orders that expire on their own (GoodTillTime, and GoodForDay at the session close), earliest first.
+		*  Expiry happens in chunks of at most expiryChunk_ orders per lock, see ExpireOrders. */
+		ExpiryQueue expiry_;
+		// expiry_'s earliest entry, for other threads to read without the lock (see GetNextExpiry).
+		std::atomic<Timestamp> nextExpiry_{ Timestamp::max() };
+		const std::chrono::minutes sessionClose_;
+		const std::size_t expiryChunk_;
+		// The session close GoodForDay orders currently get, valid for adds between sessionCloseFrom_ and it.
+		Timestamp sessionCloseFrom_{};
+		Timestamp sessionCloseCache_{};
+		/* The purpose of this thread is to sleep until the earliest expiry, and then submit unsolicited cancels for every order that expired.
+		*  nextExpiryWake_ is when it is due to wake up, an add that expires earlier than that wakes it through expiryConditionVariable_. */
 		std::thread ordersPruneThread_{};
-		std::condition_variable shutdownConditionVariable_{};
+		std::condition_variable expiryConditionVariable_{};
+		Timestamp nextExpiryWake_{ Timestamp::max() };
 		std::atomic<bool> shutdown_{ false };
+		/* Set by Replay and cleared by the next command applied live. Meanwhile the prune thread leaves the orders alone,
+		*  what expires during a replay is exactly what the journal's Expire commands expire, whatever the wall clock says. */
+		bool replaying_{ false };
+		/* The snapshot SaveSnapshot is taking, one at a time (snapshotMutex_), in chunks of about snapshotChunk_ orders per lock.
+		*  mutable because saving is const for the book, yet every change to a level has to check whether a capture needs it first. */
+		mutable SnapshotCapture capture_{};
+		mutable std::mutex snapshotMutex_{};
+		const std::size_t snapshotChunk_;
+#ifdef OB_ENABLE_STATS
+		// mutable because even the const readers count their lock waits
+		mutable OrderBookCounters stats_{};
+#endif
+
+		void PruneExpiredOrders();
+		// One chunk of ExpireOrders for the prune thread, unless a replay is going on. Returns whether more are due.
+		bool PruneChunk(Timestamp now);
+
+		// Locks ordersMutex_, or returns an empty lock in single-writer mode where only one thread ever touches the book.
+		std::unique_lock<std::mutex> LockOrders() const;
 
-		void PruneGoodForDayOrders();
+		// One side's levels, picked at compile time.
+		template <Side side>
+		auto& GetLevels()
+		{
+			if constexpr (side == Side::Buy)
+				return *bids_;
+			else
+				return *asks_;
+		}
+
+		template <Side side>
+		const auto& GetLevels() const
+		{
+			if constexpr (side == Side::Buy)
+				return *bids_;
+			else
+				return *asks_;
+		}
 
-		bool CanFullyFill(Side side, Price price, Quantity quantity) const;
-		bool CanMatch(Side side, Price price) const;
-		Trades MatchOrders();
+		/* Can an order on 'side' at 'price' trade right away (fully, for CanFullyFill)?
+		*  CanFullyFill leaves out what self-trade prevention would keep 'owner' from trading against, see CanFullyFillAroundOwner. */
+		template <Side side>
+		bool CanFullyFill(Price price, Quantity quantity, OwnerId owner) const;
+		template <Side side>
+		bool CanFullyFillAroundOwner(Price price, Quantity quantity, OwnerId owner) const;
+		template <Side side>
+		bool CanMatch(Price price) const;
+		/* Trades an incoming order on 'side' against the other side for as long as it crosses, appending the trades to 'trades'.
+		*  Returns false if self-trade prevention cancelled what was left of the order, which then must not rest. */
+		template <Side side>
+		bool Sweep(Order& order, Trades& trades);
+		// Applies selfTradePrevention_ to 'order' meeting 'match', the front of 'level'. Returns whether 'order' carries on.
+		bool PreventSelfTrade(Order& order, OrderList& level, RestingOrder& match);
+		// Takes the front order of a level out of the book (the level, orders_, its owner's list) and releases it.
+		void RemoveFront(OrderList& level);
 
-		void OnOrderCancelled(OrderPointer order);
-		void OnOrderAdded(OrderPointer order);
-		void OnOrderMatched(Price price, Quantity quantity, bool isFullyFilled);
-		void UpdateLevelData(Price price, Quantity quantity, LevelData::Action action);
+		template <Side side>
+		void OnOrderAdded(const RestingOrder& order, const OrderList& level);
+		template <Side side>
+		void OnOrderCancelled(const RestingOrder& order, const OrderList& level);
+		void OnOrderMatched(const Trade& trade);
+		template <Side side>
+		void OnLevelTraded(const Order& order, Price price, Quantity quantity, Quantity fills);
+		template <Side side>
+		void OnLevelChanged(Price price, const OrderList& level);
+		void PublishMarketData(MarketDataEvent& event);
+		void PublishDepthView();
 
-		void CancelOrders(OrderIds orderIds);
-		void CancelOrderInternal(OrderId orderId);
+		/* The *Internal methods do the actual work and expect ordersMutex_ to be held already (or the book to be single-writer),
+		*  so the public single and batch calls only differ in how often they lock. Trades are appended to 'trades', never cleared. */
+		CommandResult AddOrderInternal(Order order, Trades& trades);
+		CommandResult CancelOrderInternal(OrderId orderId);
+		// What the two above do once the side of the order is known, they only branch on it to pick one of these.
+		template <Side side>
+		CommandResult AddOrderToSide(Order order, Trades& trades);
+		template <Side side>
+		void CancelOrderFromSide(RestingOrder& order);
+		/* Mass cancels. A level is taken out in one go: its orders are released straight off the list,
+		*  then the level's aggregates and market data are updated once, instead of once per order. */
+		template <Side side>
+		void CancelLevel(Price price);
+		template <Side side>
+		void CancelSideInternal();
+		template <Side side>
+		void CancelRangeInternal(Price lowPrice, Price highPrice);
+		void CancelOwnerInternal(OwnerId owner);
+		// Takes a resting order down to 'quantity' (at most its remaining quantity) without moving it.
+		template <Side side>
+		void ReduceOrder(RestingOrder& order, Quantity quantity);
+
+		/* Every change to a level goes through here first. It only does something while SaveSnapshot is capturing:
+		*  the level is then preserved as it is, unless the capture already has it (see SnapshotCapture). */
+		void BeforeLevelChange(Side side, Price price, const OrderList& level)
+		{
+			if (capture_.IsActive()) [[unlikely]]
+				PreserveLevel(side, price, level);
+		}
+		void PreserveLevel(Side side, Price price, const OrderList& level);
+		// One lock's worth of SaveSnapshot, returns whether there is more to copy.
+		bool CaptureChunk() const;
+		// Copies 'side' from where the capture got to until 'budget' orders are copied. Returns whether the side is done.
+		template <Side side>
+		bool CaptureLevels(std::size_t& budget) const;
+		// Copies 'from' and the orders behind it in its level until 'budget' runs out. Returns the order it stopped at, null once the level is done.
+		const RestingOrder* CopyOrders(const RestingOrder* from, std::size_t& budget) const;
+		static SnapshotLevel ToSnapshotLevel(Price price, const OrderList& orders);
+		static SnapshotOrder ToSnapshotOrder(const RestingOrder& order);
+		const std::byte* ReadLevels(PriceLevels& levels, Side side, std::uint64_t count, const std::byte* in, const std::byte* end);
+		CommandResult MatchOrderInternal(OrderModify order, Trades& trades);
+		void CancelGoodForDayOrdersInternal();
+		std::size_t ExpireOrdersInternal(Timestamp now);
+		void ScheduleExpiry(const Order& order);
+		void PublishNextExpiry();
+		// Does this queue entry still stand for a resting order with that expiry? (It may have been filled, cancelled or modified since.)
+		bool IsLiveExpiry(const ExpiryQueue::Entry& entry) const;
+		Timestamp GetSessionClose(Timestamp now);
+		// Every public call that changes the book ends up here: the command is journaled, then executed.
+		CommandResult ApplyInternal(const Command& command, Trades& trades);
+		CommandResult ExecuteInternal(const Command& command, Trades& trades);
 
 	public:
 
 		// Constructor and destructor
-		OrderBook();
-		~OrderBook();
+		BasicOrderBook();
+		explicit BasicOrderBook(const OrderBookOptions& options);
+		~BasicOrderBook();
 
-		Trades AddOrder(OrderPointer order);
+		BasicOrderBook(const BasicOrderBook&) = delete;
+		BasicOrderBook& operator=(const BasicOrderBook&) = delete;
+
+		/* The book keeps its own copy of the order in its pool, so the caller's order is never referenced after the call.
+		*  The OrderPointer overload is kept for convenience, the Order overload avoids the shared_ptr allocation entirely. */
+		Trades AddOrder(Order order);
+		Trades AddOrder(OrderPointer order) { return AddOrder(*order); }
+		/* Same as above, but the trades go into the caller's 'trades', which is cleared first rather than replaced by a new vector.
+		*  Reusing one buffer means no allocation at all unless a call trades more than it has ever held. */
+		void AddOrder(Order order, Trades& trades);
 		void CancelOrder(OrderId orderId);
 		/* Modify Order method
-		*   can be thought of as a combination of cancel order and add order methods */
+		*   can be thought of as a combination of cancel order and add order methods, under one lock.
+		*   Except when the side and price stay and the quantity doesn't grow: the order is then reduced in place and keeps its priority. */
 		Trades MatchOrder(OrderModify order);
-		std::size_t Size() const { return orders_.size(); }
+		void MatchOrder(OrderModify order, Trades& trades);
+		// Cancels every GoodForDay order right away, in one pass. Session close expiry goes through ExpireOrders instead.
+		void CancelGoodForDayOrders();
+		/* Cancel every order on one side, every order of one side priced from lowPrice to highPrice (both included),
+		*  or every order of one owner (see Order::GetOwner), e.g. when its session disconnects.
+		*  The first two cost one step per level cancelled, CancelOwnerOrders one step per order of that owner, never a search through the book. */
+		void CancelSide(Side side);
+		void CancelRange(Side side, Price lowPrice, Price highPrice);
+		void CancelOwnerOrders(OwnerId owner);
+		/* Removes up to OrderBookOptions::expiryChunk_ orders whose expiry is at or before 'now', and returns true if more are due,
+		*  so callers repeat it (letting other work in between) until it returns false.
+		*  The prune thread does this on its own, single-writer books have no prune thread and rely on their owner to send Command::Expire. */
+		bool ExpireOrders(Timestamp now);
+		bool HasExpiredOrders(Timestamp now) const;
+		/* When the earliest order still queued for expiry is due, Timestamp::max() if there is none. Any thread, without the lock,
+		*  so a scheduler can tell which books need a Command::Expire without asking each of them. May name an order that has left the book since. */
+		Timestamp GetNextExpiry() const { return nextExpiry_.load(std::memory_order_relaxed); }
+		/* Dispatches a Command to the matching call above and returns its trades (only Add and Modify can trade).
+		*  The second overload also says what became of it (see CommandStatus), which is what OrderBookPipeline and MatchingEngine ack with. */
+		Trades Apply(const Command& command);
+		CommandResult Apply(const Command& command, Trades& trades);
+
+		/* Batch versions of the calls above. Each takes ordersMutex_ once for the whole batch and processes it in order,
+		*  exactly as if the calls had been made one by one with nothing in between.
+		*  Trades are appended to the caller's 'trades' (it is not cleared), so a gateway can keep reusing one buffer across bursts
+		*  and, once it has grown, never allocate for trades again. */
+		void AddOrders(std::span<const Order> orders, Trades& trades);
+		void CancelOrders(std::span<const OrderId> orderIds);
+		void Apply(std::span<const Command> commands, Trades& trades);
+
+		/* Same as the batch Apply, minus the journal: for rebuilding a book from a JournalReader after a restart.
+		*  Replaying every batch the reader hands out, in order, into a fresh book with the same options leaves it in the same state and produces the same trades.
+		*  Read in large batches and reuse 'trades' (clear it between batches) and replay costs one lock per batch and no allocation per command.
+		*  From the first Replay until the next live call (any of the calls above), the prune thread expires nothing: orders only expire through the journal's
+		*  Expire commands, as they did the first time. Whatever is overdue by then is expired as soon as the book goes live. */
+		void Replay(std::span<const Command> commands, Trades& trades);
+
+		/* Writes every resting order, level by level in price-time order, to a snapshot file, as of the moment the call began.
+		*  The book keeps matching meanwhile: it is copied in chunks of OrderBookOptions::snapshotChunk_ orders per lock,
+		*  and a level that changes before the chunks got to it (or all through it) is copied right then, as it was, under the lock the change holds anyway.
+		*  The image is put together and written once the lock is released. With a journal attached, the snapshot records where in the journal it was taken. */
+		void SaveSnapshot(const std::filesystem::path& path) const;
+		/* Loads a snapshot into an empty book (throws std::logic_error otherwise) straight from the mapped file,
+		*  building each level in one pass instead of going through AddOrder. Throws std::runtime_error if the file is corrupt.
+		*  Returns the journal sequence to resume replay from (see JournalReader), or zero if the snapshot was taken without a journal.
+		*  Publishes no market data, publishers should start from GetDepth. */
+		std::uint64_t LoadSnapshot(const std::filesystem::path& path);
+
+		// Not synchronized, for the thread that owns the book. Other threads get the count from GetDepthView.
+		std::size_t Size() const { return orders_.Size(); }
+		// Counters since construction, readable from any thread without the lock. All zero (and enabled_ false) unless built with OB_ENABLE_STATS.
+		OrderBookStats GetStats() const;
 
+		/* Full depth of both sides, tagged with the market-data sequence it is consistent with. Allocates, prefer GetTopOfBook or GetDepth for frequent polling.
+		*  Also what a feed consumer resyncs from after a gap, see DrainMarketData. */
 		OrderBookLevelInfos GetOrderInfos() const;
+		// O(1), no allocation.
+		TopOfBook GetTopOfBook() const;
+		/* Writes up to bids.size() bid levels and asks.size() ask levels, best first, into the caller's buffers.
+		*  Returns how many levels were written for each side. No allocation, O(levels written). */
+		std::pair<std::size_t, std::size_t> GetDepth(std::span<LevelInfo> bids, std::span<LevelInfo> asks) const;
+		/* Every level of 'side', best first, into 'levels' (cleared first) as arrays, ready for the aggregates in obDepthAnalytics.hpp.
+		*  Keep one LevelArrays per side and pass it again: once it has grown to the book's depth this no longer allocates. */
+		void GetDepth(Side side, LevelArrays& levels) const;
+		/* Total quantity resting on 'side' at 'price' or better, i.e. what an incoming order on the other side with that limit could trade against.
+		*  O(log levels) with ladder storage, proportional to the levels in between with map storage. */
+		std::uint64_t GetQuantityAtOrBetter(Side side, Price price) const;
+
+		/* Pops up to events.size() market-data events, oldest first, and returns how many were written.
+		*  Must only be called from one thread at a time (the publisher), it never takes ordersMutex_. Returns 0 if the feed is disabled.
+		*  If the publisher falls behind and the feed fills up, new events are dropped and show up as a gap in MarketDataEvent::sequence_.
+		*  To recover, take GetOrderInfos (or, from a thread that can't call into the book, Read the DepthView, which only has its top levels):
+		*  both say which sequence they are as of, drop the drained events below it and carry on from there. */
+		std::size_t DrainMarketData(std::span<MarketDataEvent> events);
+
+		// What the book's MemoryArena has mapped and handed out. All zero without one.
+		MemoryStats GetMemoryStats() const;
+
+		/* Top OrderBookOptions::depthViewLevels_ levels of each side and the order count, as of the end of the last call that changed them.
+		*  Any number of threads can Read it at any time, without ever taking ordersMutex_ or slowing the matching down. Null if disabled. */
+		const DepthView* GetDepthView() const { return depthView_.get(); }
 	};
+
+	// Runtime configured through OrderBookOptions, every order type. What OrderBook has always been.
+	using OrderBook = BasicOrderBook<OrderBookPolicies<>>;
+	// The same without any locking or prune thread, for books owned by a single thread (OrderBookPipeline, MatchingEngine).
+	using SingleWriterOrderBook = BasicOrderBook<OrderBookPolicies<DynamicLevels, NoLocking>>;
+	// Single-threaded venues that only take GoodTillCancel and FillAndKill (IOC) orders on map levels: no virtual calls, no mutex, no Market, FillOrKill or expiry paths.
+	using LimitOrderBook = BasicOrderBook<OrderBookPolicies<MapLevels, NoLocking, OrderTypes<OrderType::GoodTillCancel, OrderType::FillAndKill>>>;
+
+	// The member definitions live in obOrderBook.cpp, which instantiates exactly these. Another combination of policies needs its own line there.
+	extern template class BasicOrderBook<OrderBookPolicies<>>;
+	extern template class BasicOrderBook<OrderBookPolicies<DynamicLevels, NoLocking>>;
+	extern template class BasicOrderBook<OrderBookPolicies<MapLevels, NoLocking, OrderTypes<OrderType::GoodTillCancel, OrderType::FillAndKill>>>;
 };
\ No newline at end of file
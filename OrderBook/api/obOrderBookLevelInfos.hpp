@@ -2,23 +2,32 @@
 
 #include "api/obLevelInfo.hpp"
 
+//lib
+#include <cstdint>
+
 namespace ob
 {
 	class OrderBookLevelInfos
 	{
 	public:
-		OrderBookLevelInfos(const LevelInfos& bids, const LevelInfos& asks)
-			: bids_ { bids }
-			, asks_ { asks }
+		// Taken by value and moved in, pass temporaries (or std::move) and no level is copied.
+		OrderBookLevelInfos(LevelInfos bids, LevelInfos asks, std::uint64_t marketDataSequence = 0)
+			: bids_ { std::move(bids) }
+			, asks_ { std::move(asks) }
+			, marketDataSequence_{ marketDataSequence }
 		{ }
 
 		// Getters
 		//  Notice that these getters return const objects that cannot be modified.
 		const LevelInfos& GetBids() const { return bids_; }
 		const LevelInfos& GetAsks() const { return asks_; }
+		/* The MarketDataEvent::sequence_ of the first event these levels don't include yet (see OrderBook::DrainMarketData).
+		*  A feed consumer that saw a gap starts over from these levels, skips the events below it and applies the rest. */
+		std::uint64_t GetMarketDataSequence() const { return marketDataSequence_; }
 
 	private:
 		LevelInfos bids_;
 		LevelInfos asks_;
+		std::uint64_t marketDataSequence_;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "api/obAliases.hpp"
+#include "api/obOrderIndex.hpp"
+#include "api/obMemoryArena.hpp"
+
+//lib
+#include <chrono>
+#include <cstddef>
+
+namespace ob
+{
+	class JournalWriter;
+
+	enum class LevelStorage
+	{
+		Map,	// std::map per side, works for any price
+		Ladder	// flat array of levels indexed by tick, see PriceLadder
+	};
+
+	enum class Threading
+	{
+		Locked,			// any thread may call into the book, every call takes the book's mutex
+		SingleWriter	// exactly one thread ever calls into the book (see OrderBookPipeline), no mutex and no prune thread
+	};
+
+	// How the market-data feed reports trades. The trades returned to the caller are always one per fill.
+	enum class TradeReporting
+	{
+		PerFill,	// a Trade event for every fill, naming both orders
+		PerLevel	// one LevelTrade event per price level an incoming order trades at, however many resting orders it fills there
+	};
+
+	/* What happens when an incoming order would trade with a resting order of the same owner (see Order::GetOwner).
+	*  Orders without an owner always trade. Nothing is ever traded, so there is nothing to net afterwards. */
+	enum class SelfTradePrevention
+	{
+		None,				// they trade like any two orders
+		CancelNewest,		// what is left of the incoming order is cancelled, the resting order stays
+		CancelOldest,		// the resting order is cancelled, the incoming order carries on down the book
+		CancelBoth,			// both are cancelled
+		DecrementAndCancel	// both are reduced by the smaller of their quantities without trading, whichever is then empty is cancelled (both if equal)
+	};
+
+	/* Construction-time settings for an OrderBook.
+	*  A default constructed OrderBookOptions gives the same book as OrderBook's default constructor.
+	*/
+	struct OrderBookOptions
+	{
+		LevelStorage levelStorage_{ LevelStorage::Map };
+
+		// Ladder settings. Prices that are not a multiple of tickSize_ away from basePrice_ are rejected in Ladder mode.
+		Price tickSize_{ 1 };
+		Price basePrice_{ 0 };
+		// Number of ticks the ladder covers initially, it re-centers (and grows if it must) when prices drift outside of it.
+		std::size_t ladderLevels_{ 1024 };
+		/* Most ticks a ladder's window ever grows to cover, rather than one far-off order allocating (and moving every level into) a ladder as wide as the distance.
+		*  Levels further than this behind a side's best level rest in an ordered map next to the window (see PriceLadder), as slow as LevelStorage::Map,
+		*  and never hold up the levels near the touch. No price on a tick is ever rejected for being far away. */
+		std::size_t ladderMaxLevels_{ std::size_t{ 1 } << 18 };
+
+		// Number of resting orders to preallocate storage for (pool and order index), both grow past it if they have to.
+		std::size_t orderCapacity_{ 4096 };
+		// Use OrderIdIndexing::Dense when the venue assigns increasing OrderIds.
+		OrderIdIndexing orderIdIndexing_{ OrderIdIndexing::Hash };
+
+		// Size of the market-data delta feed (see OrderBook::DrainMarketData), zero disables it.
+		std::size_t marketDataCapacity_{ 0 };
+		TradeReporting tradeReporting_{ TradeReporting::PerFill };
+		SelfTradePrevention selfTradePrevention_{ SelfTradePrevention::None };
+		// Levels per side published for lock-free readers (see OrderBook::GetDepthView), zero disables it.
+		std::size_t depthViewLevels_{ 0 };
+
+		Threading threading_{ Threading::Locked };
+
+		// Local time of day the session closes, GoodForDay orders expire then.
+		std::chrono::minutes sessionClose_{ std::chrono::hours(16) };
+		/* Most orders one expiry pass removes while holding the book, so a session close with a million GoodForDay orders
+		*  becomes many short pauses instead of one long freeze (see OrderBook::ExpireOrders). */
+		std::size_t expiryChunk_{ 1024 };
+		/* Most orders SaveSnapshot copies per lock, so that saving a book with millions of orders never holds matching up for more than a few microseconds.
+		*  Except for the one change that finds its level still to be copied, which copies that level whole (see OrderBook::SaveSnapshot). */
+		std::size_t snapshotChunk_{ 32 };
+
+		/* Where the order pool, the id index, the levels, the expiry queue and the owner index allocate from (the 'memory' their constructors take).
+		*  By default (size_ zero) the heap, otherwise a MemoryArena of that size: huge pages, bound to a NUMA node and prefaulted, see obMemoryArena.hpp. */
+		ArenaOptions arena_{};
+
+		// Every command the book accepts is appended here before it runs (see obJournal.hpp). Not owned, it must outlive the book. Null disables journaling.
+		JournalWriter* journal_{ nullptr };
+	};
+}
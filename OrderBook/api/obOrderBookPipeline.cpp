@@ -0,0 +1,122 @@
+#include "api/obOrderBookPipeline.hpp"
+#include "api/obThreadAffinity.hpp"
+
+// lib
+#include <algorithm>
+#include <array>
+
+namespace ob
+{
+	/*******************************************************************
+	*							Private API							   *
+	********************************************************************/
+	void OrderBookPipeline::Run()
+	{
+		std::array<QueuedCommand, 64> batch{};
+		// reused for every command, so matching never allocates once it has grown to the largest fill seen
+		Trades trades{};
+
+		while (true)
+		{
+			/* Read both before popping: once running_ is false Submit refuses new commands, and with none halfway through
+			*  everything accepted is guaranteed to be in this pop or an earlier one. */
+			const bool stopping = !running_.load() and submitting_.load() == 0;
+
+			const std::size_t count = ingress_.PopBatch(batch);
+			for (std::size_t i = 0; i < count; ++i)
+				Process(batch[i], trades);
+
+			if (count == 0)
+			{
+				if (stopping)
+					return;
+
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	void OrderBookPipeline::Process(const QueuedCommand& queued, Trades& trades)
+	{
+		const Command& command = queued.command_;
+		const CommandResult result = book_.Apply(command, trades);
+		for (const auto& trade : trades)
+			Publish(ExecutionEvent::FromTrade(trade));
+
+		if (!queued.requeued_)
+			Publish(ExecutionEvent::FromCommand(command, result));
+
+		// One expiry chunk per command, the rest goes to the back of the queue so the commands already waiting get matched in between.
+		if (command.type_ == CommandType::Expire and book_.HasExpiredOrders(command.time_))
+			ingress_.TryPush(QueuedCommand{ command, true }); // if the ring is full the next Expire picks up where this one left off
+	}
+
+	void OrderBookPipeline::Publish(const ExecutionEvent& event)
+	{
+		/* Trades can't be dropped, so wait for the consumer. Once stopping, nobody may be draining anymore: rather than hang,
+		*  the event goes to overflow_ for Drain to hand out after Stop(), and so does everything after it, to keep the order. */
+		while (overflow_.empty())
+		{
+			if (egress_.TryPush(event))
+				return;
+
+			if (!running_.load(std::memory_order_relaxed))
+				break;
+
+			std::this_thread::yield();
+		}
+
+		overflow_.push_back(event);
+	}
+
+	/*******************************************************************
+	*							Public API							   *
+	********************************************************************/
+	OrderBookPipeline::OrderBookPipeline(OrderBookOptions bookOptions, const PipelineOptions& options)
+		: book_{ bookOptions }
+		, ingress_{ options.ingressCapacity_ }
+		, egress_{ options.egressCapacity_ }
+		, matchingThread_{ [this]() { Run(); } }
+	{
+		PinThread(matchingThread_, options.core_);
+	}
+
+	OrderBookPipeline::~OrderBookPipeline()
+	{
+		Stop();
+	}
+
+	bool OrderBookPipeline::Submit(const Command& command)
+	{
+		/* Counted before running_ is checked, and like Stop()'s store and Run's loads sequentially consistent: if Run saw running_ false
+		*  and nothing in flight, any Submit it missed counts itself afterwards, sees running_ false too and backs out. */
+		submitting_.fetch_add(1);
+		const bool pushed = running_.load() and ingress_.TryPush(QueuedCommand{ command });
+		submitting_.fetch_sub(1);
+		return pushed;
+	}
+
+	std::size_t OrderBookPipeline::Drain(std::span<ExecutionEvent> events)
+	{
+		// Read before popping: once stopped, the ring gets nothing more, so whatever this pop leaves behind can only be in overflow_.
+		const bool stopped = stopped_.load(std::memory_order_acquire);
+
+		std::size_t count = egress_.PopBatch(events);
+		if (!stopped or count == events.size())
+			return count;
+
+		const std::size_t overflow = std::min(events.size() - count, overflow_.size() - overflowDrained_);
+		std::copy_n(overflow_.begin() + overflowDrained_, overflow, events.begin() + count);
+		overflowDrained_ += overflow;
+		return count + overflow;
+	}
+
+	void OrderBookPipeline::Stop()
+	{
+		running_.store(false);
+		if (matchingThread_.joinable())
+			matchingThread_.join();
+
+		stopped_.store(true, std::memory_order_release);
+	}
+}
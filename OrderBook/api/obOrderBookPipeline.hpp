@@ -0,0 +1,89 @@
+#pragma once
+
+#include "api/obOrderBook.hpp"
+#include "api/obCommand.hpp"
+#include "api/obExecutionEvent.hpp"
+#include "api/obMpscRing.hpp"
+#include "api/obSpscRing.hpp"
+
+//lib
+#include <atomic>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace ob
+{
+	struct PipelineOptions
+	{
+		// Commands waiting to be matched, shared by every submitting thread.
+		std::size_t ingressCapacity_{ 1 << 16 };
+		// Acks and trades waiting to be drained.
+		std::size_t egressCapacity_{ 1 << 16 };
+		// Core to pin the matching thread to, negative to leave it unpinned.
+		int core_{ -1 };
+	};
+
+	/* Single-writer front end for an OrderBook.
+	*  Any number of gateway threads Submit commands into a lock-free ingress ring, and one matching thread owns the book:
+	*  it is the only thread that ever touches it, so the book is a SingleWriterOrderBook with no mutex at all.
+	*  Results (the trades of each command followed by its ack) are published on an outbound ring that one consumer thread drains.
+	*  With no prune thread, expiry is up to the owner: Submit Command::Expire(now) periodically, the pipeline requeues it until everything due is gone
+	*  and acks it once.
+	*
+	*  Shutdown: Stop() lets the matching thread work through every command already queued, and each of them still gets its trades and ack.
+	*  Whatever no longer fits in the outbound ring by then is kept aside rather than dropped, and Drain hands it out after the ring, in order,
+	*  once Stop() has returned. So the consumer drains until Stop() returns, then once more until Drain returns zero, and has seen every result.
+	*/
+	class OrderBookPipeline
+	{
+	public:
+		explicit OrderBookPipeline(OrderBookOptions bookOptions = {}, const PipelineOptions& options = {});
+		~OrderBookPipeline();
+
+		OrderBookPipeline(const OrderBookPipeline&) = delete;
+		OrderBookPipeline& operator=(const OrderBookPipeline&) = delete;
+
+		/* Any thread. Returns false if the ingress ring is full or the pipeline is stopping, the command was not queued.
+		*  (A command submitted while another thread is in Stop() may make it in or not. If this returns true it is processed and acked.) */
+		bool Submit(const Command& command);
+
+		/* One consumer thread only. Pops up to events.size() events and returns how many were written.
+		*  The matching thread waits when the outbound ring is full, so the consumer must keep draining while the pipeline runs. */
+		std::size_t Drain(std::span<ExecutionEvent> events);
+
+		// Processes every command submitted so far, then stops the matching thread. Nothing is lost, see the shutdown note above. Called by the destructor.
+		void Stop();
+
+		/* Market-data feed of the underlying book (see OrderBook::DrainMarketData), safe to drain from one other thread
+		*  while the pipeline runs, since it never takes the book's lock. */
+		std::size_t DrainMarketData(std::span<MarketDataEvent> events) { return book_.DrainMarketData(events); }
+		// Depth view of the underlying book (see OrderBook::GetDepthView), for any number of reader threads. Null unless bookOptions enabled it.
+		const DepthView* GetDepthView() const { return book_.GetDepthView(); }
+
+	private:
+		struct QueuedCommand
+		{
+			Command command_{};
+			// An Expire the matching thread put back for its next chunk, it was acked the first time round.
+			bool requeued_{ false };
+		};
+
+		SingleWriterOrderBook book_;
+		MpscRing<QueuedCommand> ingress_;
+		SpscRing<ExecutionEvent> egress_;
+		std::atomic<bool> running_{ true };
+		// Submit calls between checking running_ and pushing. The matching thread only exits once running_ is false, none are left and the ring is empty.
+		std::atomic<std::size_t> submitting_{ 0 };
+		/* Events published while stopping that the outbound ring had no room for, and every one after them so they stay in order.
+		*  Only the matching thread touches it until it is joined, then only Drain, which stopped_ tells when that is. */
+		std::vector<ExecutionEvent> overflow_{};
+		std::size_t overflowDrained_{ 0 };
+		std::atomic<bool> stopped_{ false };
+		std::thread matchingThread_{};
+
+		void Run();
+		void Process(const QueuedCommand& queued, Trades& trades);
+		void Publish(const ExecutionEvent& event);
+	};
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "api/obAliases.hpp"
+#include "api/obSide.hpp"
+#include "api/obOrderType.hpp"
+#include "api/obOrderBookOptions.hpp"
+#include "api/obPriceLevels.hpp"
+#include "api/obPriceLadder.hpp"
+
+//lib
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+
+namespace ob
+{
+	/* Everything that differs between the bid side and the ask side, known at compile time.
+	*  The book's side specific code is written once as a template on Side and looks its side's rules up here,
+	*  so after the one branch on the incoming order's side there is no other.
+	*/
+	template <Side side>
+	struct SideTraits;
+
+	template <>
+	struct SideTraits<Side::Buy>
+	{
+		static constexpr Side Opposite = Side::Sell;
+		// Bids are kept best (highest price) first.
+		using Compare = std::greater<Price>;
+		// Can a buy at 'price' trade against an ask resting at 'opposite'?
+		static constexpr bool Crosses(Price price, Price opposite) { return price >= opposite; }
+	};
+
+	template <>
+	struct SideTraits<Side::Sell>
+	{
+		static constexpr Side Opposite = Side::Buy;
+		// Asks are kept best (lowest price) first.
+		using Compare = std::less<Price>;
+		static constexpr bool Crosses(Price price, Price opposite) { return price <= opposite; }
+	};
+
+	/******************** Level containers ********************/
+	// Container<side> is the type of that side's levels, Create builds it on 'memory' (see OrderBookOptions::arena_).
+
+	// Chosen at run time by OrderBookOptions::levelStorage_, every level operation is a virtual call. What OrderBook has always done.
+	struct DynamicLevels
+	{
+		template <Side side>
+		using Container = PriceLevels;
+
+		template <Side side>
+		static std::unique_ptr<PriceLevels> Create(const OrderBookOptions& options, std::pmr::memory_resource* memory)
+		{
+			if (options.levelStorage_ == LevelStorage::Ladder)
+				return std::make_unique<PriceLadder>(side, options.basePrice_, options.tickSize_, options.ladderLevels_, options.ladderMaxLevels_, memory);
+
+			return std::make_unique<MapPriceLevels<typename SideTraits<side>::Compare>>(memory);
+		}
+	};
+
+	// Always ordered maps, OrderBookOptions::levelStorage_ is ignored. The containers are final, so the compiler calls (and inlines) them directly.
+	struct MapLevels
+	{
+		template <Side side>
+		using Container = MapPriceLevels<typename SideTraits<side>::Compare>;
+
+		template <Side side>
+		static std::unique_ptr<Container<side>> Create(const OrderBookOptions&, std::pmr::memory_resource* memory)
+		{
+			return std::make_unique<Container<side>>(memory);
+		}
+	};
+
+	// Always price ladders, set up from OrderBookOptions' ladder settings. Same direct calls as MapLevels.
+	struct LadderLevels
+	{
+		template <Side side>
+		using Container = PriceLadder;
+
+		template <Side side>
+		static std::unique_ptr<PriceLadder> Create(const OrderBookOptions& options, std::pmr::memory_resource* memory)
+		{
+			return std::make_unique<PriceLadder>(side, options.basePrice_, options.tickSize_, options.ladderLevels_, options.ladderMaxLevels_, memory);
+		}
+	};
+
+	/******************** Locking ********************/
+
+	// ordersMutex_ guards the book unless OrderBookOptions::threading_ says Threading::SingleWriter, and a prune thread expires orders.
+	struct MutexLocking
+	{
+		static constexpr bool Enabled = true;
+	};
+
+	/* Always single-writer, OrderBookOptions::threading_ is ignored: no mutex is ever taken and there is no prune thread,
+	*  the owner expires orders with Command::Expire (see OrderBookPipeline and MatchingEngine). */
+	struct NoLocking
+	{
+		static constexpr bool Enabled = false;
+	};
+
+	/******************** Order types ********************/
+
+	/* The order types a book accepts, the others are rejected on arrival like any invalid order.
+	*  The code for an unsupported type is compiled out: no Market conversion, no FillAndKill check after matching, no expiry scheduling. */
+	template <OrderType... types>
+	struct OrderTypes
+	{
+		static constexpr std::uint32_t Mask = ((std::uint32_t{ 1 } << static_cast<std::uint32_t>(types)) | ... | 0);
+
+		static constexpr bool Supports(OrderType type)
+		{
+			return static_cast<std::uint32_t>(type) < 32 and (Mask >> static_cast<std::uint32_t>(type)) & 1;
+		}
+
+		// Do any of these expire on their own?
+		static constexpr bool Expiring = Supports(OrderType::GoodForDay) or Supports(OrderType::GoodTillTime);
+	};
+
+	using AllOrderTypes = OrderTypes<OrderType::GoodTillCancel, OrderType::FillAndKill, OrderType::FillOrKill,
+		OrderType::GoodForDay, OrderType::Market, OrderType::GoodTillTime>;
+
+	// The policies of a BasicOrderBook, see obOrderBook.hpp for the ready made combinations.
+	template <typename LevelsPolicy = DynamicLevels, typename LockingPolicy = MutexLocking, typename TypesPolicy = AllOrderTypes>
+	struct OrderBookPolicies
+	{
+		using Levels = LevelsPolicy;
+		using Locking = LockingPolicy;
+		using Types = TypesPolicy;
+	};
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "api/obOrderType.hpp"
+
+//lib
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/* Book instrumentation is compiled in only when OB_ENABLE_STATS is defined (e.g. in the project's PreprocessorDefinitions).
+*  Without it every OB_STATS(...) statement disappears, and OrderBook::GetStats() returns an all-zero OrderBookStats with enabled_ false. */
+#ifdef OB_ENABLE_STATS
+#define OB_STATS(...) __VA_ARGS__
+#else
+#define OB_STATS(...)
+#endif
+
+namespace ob
+{
+	constexpr std::size_t OrderTypeCount = static_cast<std::size_t>(OrderType::GoodTillTime) + 1;
+
+	// A point-in-time copy of a book's counters, see OrderBook::GetStats. Times are in nanoseconds.
+	struct OrderBookStats
+	{
+		bool enabled_{ false };
+
+		// Indexed by OrderType. adds_ counts every AddOrder (and the add half of a modify), rejects_ those that never reached the book.
+		std::array<std::uint64_t, OrderTypeCount> adds_{};
+		std::array<std::uint64_t, OrderTypeCount> rejects_{};
+		// Orders that left the book by cancel (explicit, FillAndKill or Market remainder, expiry or self-trade prevention) and orders that took part in a trade, by their type.
+		std::array<std::uint64_t, OrderTypeCount> cancels_{};
+		std::array<std::uint64_t, OrderTypeCount> fills_{};
+		std::uint64_t modifies_{};
+		// Modifies done in place (quantity down, same price), the rest of modifies_ went through cancel and add.
+		std::uint64_t reductions_{};
+		std::uint64_t trades_{};
+		// Incoming orders that met a resting order of their own owner, once per resting order met (see SelfTradePrevention).
+		std::uint64_t selfTradesPrevented_{};
+
+		// Price levels incoming orders traded at, one per level per order however many fills it took.
+		std::uint64_t levelsSwept_{};
+		std::uint64_t levelsCreated_{};
+		std::uint64_t levelsDestroyed_{};
+
+		std::uint64_t lockAcquisitions_{};
+		std::uint64_t lockWaitTime_{};
+		std::uint64_t lockWaitMax_{};
+		// Expiry runs (GoodForDay and GoodTillTime) and how long they held the lock in total and at most.
+		std::uint64_t expiryRuns_{};
+		std::uint64_t expiryLockTime_{};
+		std::uint64_t expiryLockMax_{};
+	};
+
+	/* The live counters behind OrderBookStats.
+	*  Every write happens with the book's lock held (or on its single writer), so a counter is bumped with a relaxed load and store rather than
+	*  a locked read-modify-write, and any thread may read them at any time without the lock.
+	*  The whole block sits on its own cache lines so updating it never invalidates the lines of the book's other members.
+	*/
+	class alignas(64) OrderBookCounters
+	{
+	public:
+		class Counter
+		{
+		public:
+			void Add(std::uint64_t amount = 1) { value_.store(value_.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed); }
+			void Max(std::uint64_t value)
+			{
+				if (value > value_.load(std::memory_order_relaxed))
+					value_.store(value, std::memory_order_relaxed);
+			}
+			std::uint64_t Load() const { return value_.load(std::memory_order_relaxed); }
+
+		private:
+			std::atomic<std::uint64_t> value_{ 0 };
+		};
+
+		std::array<Counter, OrderTypeCount> adds_{};
+		std::array<Counter, OrderTypeCount> rejects_{};
+		std::array<Counter, OrderTypeCount> cancels_{};
+		std::array<Counter, OrderTypeCount> fills_{};
+		Counter modifies_{};
+		Counter reductions_{};
+		Counter trades_{};
+		Counter selfTradesPrevented_{};
+		Counter levelsSwept_{};
+		Counter levelsCreated_{};
+		Counter levelsDestroyed_{};
+		Counter lockAcquisitions_{};
+		Counter lockWaitTime_{};
+		Counter lockWaitMax_{};
+		Counter expiryRuns_{};
+		Counter expiryLockTime_{};
+		Counter expiryLockMax_{};
+
+		OrderBookStats Snapshot() const
+		{
+			OrderBookStats stats{};
+			stats.enabled_ = true;
+
+			for (std::size_t i = 0; i < OrderTypeCount; ++i)
+			{
+				stats.adds_[i] = adds_[i].Load();
+				stats.rejects_[i] = rejects_[i].Load();
+				stats.cancels_[i] = cancels_[i].Load();
+				stats.fills_[i] = fills_[i].Load();
+			}
+
+			stats.modifies_ = modifies_.Load();
+			stats.reductions_ = reductions_.Load();
+			stats.trades_ = trades_.Load();
+			stats.selfTradesPrevented_ = selfTradesPrevented_.Load();
+			stats.levelsSwept_ = levelsSwept_.Load();
+			stats.levelsCreated_ = levelsCreated_.Load();
+			stats.levelsDestroyed_ = levelsDestroyed_.Load();
+			stats.lockAcquisitions_ = lockAcquisitions_.Load();
+			stats.lockWaitTime_ = lockWaitTime_.Load();
+			stats.lockWaitMax_ = lockWaitMax_.Load();
+			stats.expiryRuns_ = expiryRuns_.Load();
+			stats.expiryLockTime_ = expiryLockTime_.Load();
+			stats.expiryLockMax_ = expiryLockMax_.Load();
+			return stats;
+		}
+	};
+
+	inline std::size_t ToIndex(OrderType orderType) { return static_cast<std::size_t>(orderType); }
+}
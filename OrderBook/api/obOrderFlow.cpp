@@ -0,0 +1,97 @@
+#include "api/obOrderFlow.hpp"
+
+// lib
+#include <algorithm>
+
+namespace ob
+{
+	/*******************************************************************
+	*							Private API							   *
+	********************************************************************/
+	Price OrderFlowGenerator::NextPrice(Side side, bool aggressive)
+	{
+		// at least one tick away, so passive bids and asks never meet at the mid
+		const Price ticks = std::min<Price>(ticks_(random_) + 1, options_.maxTicksFromMid_);
+		const Price offset = ticks * options_.tickSize_;
+
+		const bool below = (side == Side::Buy) != aggressive;
+		return below ? options_.midPrice_ - offset : options_.midPrice_ + offset;
+	}
+
+	OrderId OrderFlowGenerator::TakeLiveOrder()
+	{
+		std::uniform_int_distribution<std::size_t> pick{ 0, live_.size() - 1 };
+		const std::size_t i = pick(random_);
+
+		const OrderId orderId = live_[i];
+		live_[i] = live_.back();
+		live_.pop_back();
+		return orderId;
+	}
+
+	/*******************************************************************
+	*							Public API							   *
+	********************************************************************/
+	OrderFlowGenerator::OrderFlowGenerator(const OrderFlowOptions& options)
+		: options_{ options }
+		, random_{ options.seed_ }
+		, ticks_{ 1.0 / std::max(1.0, options.meanTicksFromMid_) }
+		, quantity_{ 1, std::max<Quantity>(1, options.maxQuantity_) }
+	{ }
+
+	Command OrderFlowGenerator::Next()
+	{
+		double roll = unit_(random_);
+
+		if (!live_.empty())
+		{
+			if (roll < options_.cancelRatio_)
+				return Command::Cancel(TakeLiveOrder());
+			roll -= options_.cancelRatio_;
+
+			if (roll < options_.modifyRatio_)
+			{
+				// the modified order keeps its id, so it stays a candidate for later cancels and modifies
+				const OrderId orderId = TakeLiveOrder();
+				live_.push_back(orderId);
+
+				const Side side = NextSide();
+				return Command::Modify(OrderModify{ orderId, side, NextPrice(side, unit_(random_) < options_.aggressiveRatio_), quantity_(random_) });
+			}
+			roll -= options_.modifyRatio_;
+		}
+
+		const OrderId orderId = nextOrderId_++;
+		const Side side = NextSide();
+		const Quantity quantity = quantity_(random_);
+
+		if (roll < options_.marketRatio_)
+			return Command::Add(Order{ orderId, side, quantity, GetOwner(orderId) });
+		roll -= options_.marketRatio_;
+
+		OrderType orderType = OrderType::GoodTillCancel;
+		if (roll < options_.fillAndKillRatio_)
+			orderType = OrderType::FillAndKill;
+		else if (roll < options_.fillAndKillRatio_ + options_.fillOrKillRatio_)
+			orderType = OrderType::FillOrKill;
+		else if (roll < options_.fillAndKillRatio_ + options_.fillOrKillRatio_ + options_.goodForDayRatio_)
+			orderType = OrderType::GoodForDay;
+
+		// FillAndKill and FillOrKill orders are there to trade, so they are always priced through the mid.
+		const bool aggressive = orderType == OrderType::FillAndKill or orderType == OrderType::FillOrKill or unit_(random_) < options_.aggressiveRatio_;
+
+		if (orderType == OrderType::GoodTillCancel or orderType == OrderType::GoodForDay)
+			live_.push_back(orderId);
+
+		return Command::Add(Order{ orderType, orderId, side, NextPrice(side, aggressive), quantity, {}, GetOwner(orderId) });
+	}
+
+	Command OrderFlowGenerator::NextPassive()
+	{
+		const OrderId orderId = nextOrderId_++;
+		const Side side = NextSide();
+		live_.push_back(orderId);
+
+		return Command::Add(Order{ OrderType::GoodTillCancel, orderId, side, NextPrice(side, false), quantity_(random_), {}, GetOwner(orderId) });
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "api/obAliases.hpp"
+#include "api/obCommand.hpp"
+
+//lib
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace ob
+{
+	/* Shape of a synthetic order flow. Ratios are fractions of all messages and are checked in order (cancel, modify, then the add types),
+	*  whatever is left over is GoodTillCancel adds.
+	*/
+	struct OrderFlowOptions
+	{
+		std::uint64_t seed_{ 1 };
+
+		double cancelRatio_{ 0.45 };
+		double modifyRatio_{ 0.05 };
+		double marketRatio_{ 0.01 };
+		double fillAndKillRatio_{ 0.02 };
+		double fillOrKillRatio_{ 0.02 };
+		double goodForDayRatio_{ 0.05 };
+
+		// Prices are drawn around midPrice_: most orders rest a few ticks off the touch, fewer the further out.
+		Price midPrice_{ 10'000 };
+		Price tickSize_{ 1 };
+		// Mean distance from the mid in ticks (geometric), and the furthest an order is placed.
+		double meanTicksFromMid_{ 4.0 };
+		Price maxTicksFromMid_{ 200 };
+		// Fraction of limit orders priced through the mid, i.e. aggressive and likely to trade.
+		double aggressiveRatio_{ 0.1 };
+
+		Quantity maxQuantity_{ 100 };
+
+		// Owners the adds are spread over, round robin by OrderId (e.g. to exercise self-trade prevention). Zero leaves every order without one.
+		OwnerId owners_{ 0 };
+	};
+
+	/* Reproducible stream of Commands for benchmarks and replay tests, the same options always give the same flow.
+	*  OrderIds are handed out in increasing order starting at 1, and cancels and modifies pick one of the generator's previous adds at random,
+	*  some of which will have traded away already, as happens in real flows.
+	*/
+	class OrderFlowGenerator
+	{
+	public:
+		explicit OrderFlowGenerator(const OrderFlowOptions& options = {});
+
+		Command Next();
+		/* A resting GoodTillCancel order that never crosses, bids below the mid and asks above it.
+		*  For building a book of a given depth before measuring. */
+		Command NextPassive();
+
+		OrderId GetNextOrderId() const { return nextOrderId_; }
+
+	private:
+		OrderFlowOptions options_;
+		std::mt19937_64 random_;
+		std::uniform_real_distribution<double> unit_{ 0.0, 1.0 };
+		std::geometric_distribution<Price> ticks_;
+		std::uniform_int_distribution<Quantity> quantity_;
+		OrderId nextOrderId_{ 1 };
+		// Ids of past adds, cancels and modifies target these. Entries are swapped out when cancelled.
+		std::vector<OrderId> live_{};
+
+		Side NextSide() { return unit_(random_) < 0.5 ? Side::Buy : Side::Sell; }
+		Price NextPrice(Side side, bool aggressive);
+		// From the id rather than the random stream, so a flow with owners is otherwise the same flow as one without.
+		OwnerId GetOwner(OrderId orderId) const { return options_.owners_ == 0 ? OwnerId{} : static_cast<OwnerId>(1 + orderId % options_.owners_); }
+		OrderId TakeLiveOrder();
+	};
+}
@@ -0,0 +1,225 @@
+#include "api/obOrderFlowFile.hpp"
+#include "api/obMappedFile.hpp"
+#include "api/obSessionClock.hpp"
+
+// lib
+#include <array>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <format>
+#include <string>
+#include <string_view>
+
+namespace ob
+{
+	namespace
+	{
+		constexpr std::array<std::string_view, 8> CommandTypeNames{ "add", "cancel", "modify", "cancel_gfd", "expire", "cancel_side", "cancel_range", "cancel_owner" };
+		constexpr std::array<std::string_view, 6> OrderTypeNames{ "GoodTillCancel", "FillAndKill", "FillOrKill", "GoodForDay", "Market", "GoodTillTime" };
+		constexpr std::array<std::string_view, 2> SideNames{ "buy", "sell" };
+
+		bool IsCsv(const std::filesystem::path& path)
+		{
+			return path.extension() == ".csv";
+		}
+
+		template <typename Enum, std::size_t Count>
+		Enum ParseName(const std::array<std::string_view, Count>& names, std::string_view field, Enum fallback, std::size_t line)
+		{
+			if (field.empty())
+				return fallback;
+
+			for (std::size_t i = 0; i < Count; ++i)
+				if (names[i] == field)
+					return static_cast<Enum>(i);
+
+			throw std::runtime_error(std::format("Order flow line {}: unknown value ({}).", line, std::string{ field }));
+		}
+
+		template <typename Number>
+		Number ParseNumber(std::string_view field, std::size_t line)
+		{
+			Number value{};
+			if (field.empty())
+				return value;
+
+			const auto [end, error] = std::from_chars(field.data(), field.data() + field.size(), value);
+			if (error != std::errc{} or end != field.data() + field.size())
+				throw std::runtime_error(std::format("Order flow line {}: bad number ({}).", line, std::string{ field }));
+
+			return value;
+		}
+
+		std::vector<FlowMessage> ReadCsv(const std::filesystem::path& path)
+		{
+			std::ifstream file{ path };
+			if (!file)
+				throw std::runtime_error(std::format("Cannot open ({}).", path.string()));
+
+			std::vector<FlowMessage> messages;
+			std::string text;
+			std::getline(file, text); // header
+
+			for (std::size_t line = 2; std::getline(file, text); ++line)
+			{
+				if (!text.empty() and text.back() == '\r')
+					text.pop_back();
+				if (text.empty())
+					continue;
+
+				std::array<std::string_view, 10> fields{};
+				std::string_view rest{ text };
+				for (auto& field : fields)
+				{
+					const auto comma = rest.find(',');
+					field = rest.substr(0, comma);
+					rest = comma == std::string_view::npos ? std::string_view{} : rest.substr(comma + 1);
+				}
+
+				FlowMessage message{};
+				message.timestamp_ = ParseNumber<std::uint64_t>(fields[0], line);
+				message.command_.type_ = ParseName(CommandTypeNames, fields[1], CommandType::Add, line);
+				message.command_.orderType_ = ParseName(OrderTypeNames, fields[2], OrderType::GoodTillCancel, line);
+				message.command_.side_ = ParseName(SideNames, fields[3], Side::Buy, line);
+				message.command_.orderId_ = ParseNumber<OrderId>(fields[4], line);
+				message.command_.price_ = ParseNumber<Price>(fields[5], line);
+				message.command_.quantity_ = ParseNumber<Quantity>(fields[6], line);
+				message.command_.time_ = FromEpochNanoseconds(ParseNumber<std::int64_t>(fields[7], line));
+				message.command_.owner_ = ParseNumber<OwnerId>(fields[8], line);
+				message.command_.highPrice_ = ParseNumber<Price>(fields[9], line);
+				messages.push_back(message);
+			}
+
+			return messages;
+		}
+
+		void WriteCsv(const std::filesystem::path& path, std::span<const FlowMessage> messages)
+		{
+			std::ofstream file{ path };
+			if (!file)
+				throw std::runtime_error(std::format("Cannot create ({}).", path.string()));
+
+			file << "timestamp,type,order_type,side,order_id,price,quantity,time,owner,high_price\n";
+			for (const auto& [timestamp, command] : messages)
+			{
+				// only the fields the command type uses, as ReadCsv defaults the rest
+				switch (command.type_)
+				{
+				case CommandType::Add:
+					file << std::format("{},add,{},{},{},{},{},{},{},\n", timestamp, OrderTypeNames[static_cast<std::size_t>(command.orderType_)],
+						SideNames[static_cast<std::size_t>(command.side_)], command.orderId_, command.price_, command.quantity_, ToEpochNanoseconds(command.time_), command.owner_);
+					break;
+				case CommandType::Cancel:
+					file << std::format("{},cancel,,,{},,,,,\n", timestamp, command.orderId_);
+					break;
+				case CommandType::Modify:
+					file << std::format("{},modify,,{},{},{},{},,,\n", timestamp, SideNames[static_cast<std::size_t>(command.side_)],
+						command.orderId_, command.price_, command.quantity_);
+					break;
+				case CommandType::CancelGoodForDay:
+					file << std::format("{},cancel_gfd,,,,,,,,\n", timestamp);
+					break;
+				case CommandType::Expire:
+					file << std::format("{},expire,,,,,,{},,\n", timestamp, ToEpochNanoseconds(command.time_));
+					break;
+				case CommandType::CancelSide:
+					file << std::format("{},cancel_side,,{},,,,,,\n", timestamp, SideNames[static_cast<std::size_t>(command.side_)]);
+					break;
+				case CommandType::CancelRange:
+					file << std::format("{},cancel_range,,{},,{},,,,{}\n", timestamp, SideNames[static_cast<std::size_t>(command.side_)], command.price_, command.highPrice_);
+					break;
+				case CommandType::CancelOwner:
+					file << std::format("{},cancel_owner,,,,,,,{},\n", timestamp, command.owner_);
+					break;
+				}
+			}
+		}
+
+		std::vector<FlowMessage> ReadBinary(const std::filesystem::path& path)
+		{
+			const MappedFile file{ path, MappedFile::Mode::ReadOnly };
+
+			FlowHeader header{};
+			if (file.Size() >= sizeof(header))
+				std::memcpy(&header, file.Data(), sizeof(header));
+
+			const auto notAnOrderFlow = [&path]() { return std::runtime_error(std::format("({}) is not an order flow this version can read.", path.string())); };
+
+			// The record count against the size in records, not messages_ * sizeof(FlowRecord), which a corrupt count could overflow into a match.
+			if (header.magic_ != FlowHeader::Magic or header.version_ != FlowHeader::CurrentVersion or header.recordSize_ != sizeof(FlowRecord) or
+				(file.Size() - sizeof(FlowHeader)) % sizeof(FlowRecord) != 0 or (file.Size() - sizeof(FlowHeader)) / sizeof(FlowRecord) != header.messages_)
+				throw notAnOrderFlow();
+
+			const auto* records = reinterpret_cast<const FlowRecord*>(file.Data() + sizeof(FlowHeader));
+
+			std::vector<FlowMessage> messages(header.messages_);
+			for (std::size_t i = 0; i < messages.size(); ++i)
+			{
+				const auto& record = records[i];
+				if (record.type_ >= CommandTypeNames.size() or record.orderType_ >= OrderTypeNames.size() or record.side_ >= SideNames.size())
+					throw notAnOrderFlow();
+
+				auto& [timestamp, command] = messages[i];
+				timestamp = record.timestamp_;
+				command.type_ = static_cast<CommandType>(record.type_);
+				command.orderType_ = static_cast<OrderType>(record.orderType_);
+				command.side_ = static_cast<Side>(record.side_);
+				command.orderId_ = record.orderId_;
+				command.time_ = FromEpochNanoseconds(record.time_);
+				command.price_ = record.price_;
+				command.quantity_ = record.quantity_;
+				command.owner_ = record.owner_;
+				command.highPrice_ = record.highPrice_;
+			}
+
+			return messages;
+		}
+
+		void WriteBinary(const std::filesystem::path& path, std::span<const FlowMessage> messages)
+		{
+			std::filesystem::remove(path);
+			const std::size_t size = sizeof(FlowHeader) + messages.size() * sizeof(FlowRecord);
+			MappedFile file{ path, MappedFile::Mode::ReadWrite, size };
+
+			FlowHeader header{};
+			header.recordSize_ = sizeof(FlowRecord);
+			header.messages_ = messages.size();
+			std::memcpy(file.Data(), &header, sizeof(header));
+
+			std::byte* out = file.Data() + sizeof(header);
+			for (const auto& [timestamp, command] : messages)
+			{
+				FlowRecord record{};
+				record.timestamp_ = timestamp;
+				record.orderId_ = command.orderId_;
+				record.time_ = ToEpochNanoseconds(command.time_);
+				record.price_ = command.price_;
+				record.quantity_ = command.quantity_;
+				record.owner_ = command.owner_;
+				record.highPrice_ = command.highPrice_;
+				record.type_ = static_cast<std::uint8_t>(command.type_);
+				record.orderType_ = static_cast<std::uint8_t>(command.orderType_);
+				record.side_ = static_cast<std::uint8_t>(command.side_);
+				std::memcpy(out, &record, sizeof(record));
+				out += sizeof(record);
+			}
+
+			file.Flush(0, size);
+		}
+	}
+
+	std::vector<FlowMessage> ReadOrderFlow(const std::filesystem::path& path)
+	{
+		return IsCsv(path) ? ReadCsv(path) : ReadBinary(path);
+	}
+
+	void WriteOrderFlow(const std::filesystem::path& path, std::span<const FlowMessage> messages)
+	{
+		if (IsCsv(path))
+			WriteCsv(path, messages);
+		else
+			WriteBinary(path, messages);
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "api/obCommand.hpp"
+
+//lib
+#include <bit>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+namespace ob
+{
+	// One message of a recorded or generated order flow: a command and when it arrived, in nanoseconds from any fixed origin.
+	struct FlowMessage
+	{
+		std::uint64_t timestamp_{};
+		Command command_{};
+	};
+
+	/* Order-flow files, in two formats picked by extension.
+	*  ".csv" is one message per line after a header line: timestamp,type,order_type,side,order_id,price,quantity,time,owner,high_price
+	*    where type is add, cancel, modify, cancel_gfd, expire, cancel_side, cancel_range or cancel_owner,
+	*    order_type is the OrderType name (GoodTillCancel, ...) and side is buy or sell.
+	*    time is Command::time_ in nanoseconds since the epoch: an add's expiry, or the 'now' of an expire.
+	*    owner is an add's owner or the owner a cancel_owner is for, a cancel_range cancels from price to high_price.
+	*    Fields a message doesn't use may be left empty, and trailing columns no message uses may be left out altogether.
+	*  Anything else is the binary form: a FlowHeader followed by 48 byte little-endian FlowRecords, read straight from a mapping.
+	*  Both throw std::runtime_error on files they can't read.
+	*/
+	static_assert(std::endian::native == std::endian::little, "Binary flows are written as raw little-endian structs.");
+
+	struct FlowHeader
+	{
+		static constexpr std::uint64_t Magic = 0x574f4c46424f; // "OBFLOW"
+		static constexpr std::uint32_t CurrentVersion = 3; // 2: records carry Command::time_. 3: and Command::owner_ and highPrice_
+
+		std::uint64_t magic_{ Magic };
+		std::uint32_t version_{ CurrentVersion };
+		std::uint32_t recordSize_{};
+		std::uint64_t messages_{};
+		std::uint64_t reserved_{};
+	};
+
+	struct FlowRecord
+	{
+		std::uint64_t timestamp_{};
+		std::uint64_t orderId_{};
+		std::int64_t time_{};
+		std::int32_t price_{};
+		std::uint32_t quantity_{};
+		std::uint32_t owner_{};
+		std::int32_t highPrice_{};
+		std::uint8_t type_{};
+		std::uint8_t orderType_{};
+		std::uint8_t side_{};
+		std::uint8_t reserved_[5]{};
+	};
+
+	static_assert(sizeof(FlowHeader) == 32 and sizeof(FlowRecord) == 48);
+
+	std::vector<FlowMessage> ReadOrderFlow(const std::filesystem::path& path);
+	void WriteOrderFlow(const std::filesystem::path& path, std::span<const FlowMessage> messages);
+}
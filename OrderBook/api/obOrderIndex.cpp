@@ -0,0 +1,184 @@
+#include "api/obOrderIndex.hpp"
+
+// lib
+#include <bit>
+#include <algorithm>
+
+namespace ob
+{
+	/*******************************************************************
+	*							Private API							   *
+	********************************************************************/
+	OrderHandle OrderIndex::FindHashed(OrderId orderId) const
+	{
+		for (std::size_t i = Home(orderId);; i = (i + 1) & mask_)
+		{
+			const Slot& slot = slots_[i];
+			if (!slot.order_)
+				return nullptr;
+			if (slot.orderId_ == orderId)
+				return slot.order_;
+		}
+	}
+
+	bool OrderIndex::InsertHashed(OrderId orderId, OrderHandle order)
+	{
+		// keep the load factor at or below one half, probe sequences stay short
+		if ((hashedSize_ + 1) * 2 > slots_.size())
+			Rehash(slots_.size() * 2);
+
+		for (std::size_t i = Home(orderId);; i = (i + 1) & mask_)
+		{
+			Slot& slot = slots_[i];
+			if (!slot.order_)
+			{
+				slot = Slot{ orderId, order };
+				++hashedSize_;
+				return true;
+			}
+			if (slot.orderId_ == orderId)
+				return false;
+		}
+	}
+
+	/* Backward shift deletion: after emptying a slot, walk the rest of the cluster and move back every entry
+	*  whose home slot is not between the hole and its current position, so that no probe sequence is ever broken by the hole.
+	*/
+	OrderHandle OrderIndex::ExtractHashed(OrderId orderId)
+	{
+		std::size_t hole = Home(orderId);
+		while (true)
+		{
+			if (!slots_[hole].order_)
+				return nullptr;
+			if (slots_[hole].orderId_ == orderId)
+				break;
+			hole = (hole + 1) & mask_;
+		}
+
+		const OrderHandle order = slots_[hole].order_;
+		for (std::size_t i = (hole + 1) & mask_; slots_[i].order_; i = (i + 1) & mask_)
+		{
+			const std::size_t home = Home(slots_[i].orderId_);
+			// distance travelled from the home slot, compared to the distance between the home slot and the hole (both modulo the table size)
+			if (((i - home) & mask_) >= ((i - hole) & mask_))
+			{
+				slots_[hole] = slots_[i];
+				hole = i;
+			}
+		}
+
+		slots_[hole] = Slot{};
+		--hashedSize_;
+		return order;
+	}
+
+	void OrderIndex::Rehash(std::size_t capacity)
+	{
+		std::pmr::vector<Slot> old{ std::move(slots_) };
+
+		slots_.assign(std::bit_ceil(std::max<std::size_t>(capacity, 16)), Slot{});
+		mask_ = slots_.size() - 1;
+		hashedSize_ = 0;
+
+		for (const auto& slot : old)
+			if (slot.order_)
+				InsertHashed(slot.orderId_, slot.order_);
+	}
+
+	/* With increasing ids the window moves one id at a time, so each slide looks at one slot, and only a live order that old is moved.
+	*  A jump of a whole window or more looks at every slot once, never more.
+	*/
+	void OrderIndex::SlideDenseWindow(OrderId base)
+	{
+		const OrderId passed = std::min<OrderId>(base - denseBase_, denseSlots_.size());
+		for (OrderId i = 0; i < passed; ++i)
+		{
+			// Slot of the i-th id from the old base, in the order the window passes them, so the id is known without looking at the order.
+			const OrderId orderId = denseBase_ + i;
+			OrderHandle& slot = denseSlots_[orderId & denseMask_];
+			if (!slot)
+				continue;
+
+			InsertHashed(orderId, slot);
+			slot = nullptr;
+		}
+
+		denseBase_ = base;
+	}
+
+	/*******************************************************************
+	*							Public API							   *
+	********************************************************************/
+	OrderIndex::OrderIndex(OrderIdIndexing indexing, std::size_t capacity, std::pmr::memory_resource* memory)
+		: slots_{ memory }
+		, dense_{ indexing == OrderIdIndexing::Dense }
+		, denseSlots_{ memory }
+	{
+		if (dense_)
+		{
+			// Room for twice the orders the book expects, so that with ids handed out in order the live ones are all (or nearly all) in the ring.
+			denseSlots_.assign(std::bit_ceil(std::max<std::size_t>(capacity * 2, 1024)), nullptr);
+			denseMask_ = denseSlots_.size() - 1;
+			Rehash(capacity);
+		}
+		else
+		{
+			Rehash(capacity * 2);
+		}
+	}
+
+	bool OrderIndex::Insert(OrderId orderId, OrderHandle order)
+	{
+		if (dense_)
+		{
+			if (!denseBaseSet_)
+			{
+				denseBase_ = orderId;
+				denseBaseSet_ = true;
+			}
+
+			// ids ahead of the window move it forward until they are its last id, ids behind it go to the hash table
+			if (orderId > denseBase_ and orderId - denseBase_ >= denseSlots_.size())
+				SlideDenseWindow(orderId - denseSlots_.size() + 1);
+
+			// ids below the base wrap around to huge offsets, so a single comparison covers both ends of the window
+			if (orderId - denseBase_ < denseSlots_.size())
+			{
+				OrderHandle& slot = denseSlots_[orderId & denseMask_];
+				if (slot)
+					return false;
+
+				slot = order;
+				++size_;
+				return true;
+			}
+		}
+
+		if (!InsertHashed(orderId, order))
+			return false;
+
+		++size_;
+		return true;
+	}
+
+	OrderHandle OrderIndex::Extract(OrderId orderId)
+	{
+		if (dense_ and orderId - denseBase_ < denseSlots_.size())
+		{
+			OrderHandle& slot = denseSlots_[orderId & denseMask_];
+			const OrderHandle order = slot;
+			if (!order)
+				return nullptr;
+
+			slot = nullptr;
+			--size_;
+			return order;
+		}
+
+		const OrderHandle order = ExtractHashed(orderId);
+		if (order)
+			--size_;
+		return order;
+	}
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "api/obAliases.hpp"
+
+//lib
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+namespace ob
+{
+	enum class OrderIdIndexing
+	{
+		Hash,	// open addressing hash table, works for any OrderId
+		Dense	// direct indexed array, for venues that hand out increasing OrderIds
+	};
+
+	/* OrderId -> OrderHandle lookup for the orders resting in a book.
+	*  In Hash mode this is a flat, linear probing hash table. There are no tombstones: erasing shifts the following entries of the probe
+	*  sequence back, so lookups never have to skip over deleted slots, no matter how many cancels the book has seen.
+	*  In Dense mode the most recent ids are looked up directly in a ring (one load, no hashing, no probing): id & denseMask_ is the slot,
+	*  for the ids of a fixed size window that slides forward with the id stream. The ring is allocated once, at construction, and never resized.
+	*  Orders the window slides past, and ids that arrive behind it, go to the hash table, so Dense mode is never incorrect, only slower for stray ids.
+	*/
+	class OrderIndex
+	{
+	public:
+		explicit OrderIndex(OrderIdIndexing indexing = OrderIdIndexing::Hash, std::size_t capacity = 4096,
+			std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+		// nullptr if there is no such order.
+		OrderHandle Find(OrderId orderId) const
+		{
+			if (dense_ and orderId - denseBase_ < denseSlots_.size())
+				return denseSlots_[orderId & denseMask_];
+
+			return FindHashed(orderId);
+		}
+
+		bool Contains(OrderId orderId) const { return Find(orderId) != nullptr; }
+
+		// Returns false (and does nothing) if the id is already present.
+		bool Insert(OrderId orderId, OrderHandle order);
+		// Removes the id and returns its order, nullptr if it was not present. One probe, where Find and then Erase would take two.
+		OrderHandle Extract(OrderId orderId);
+		// Returns false if the id was not present.
+		bool Erase(OrderId orderId) { return Extract(orderId) != nullptr; }
+
+		std::size_t Size() const { return size_; }
+
+		template <typename Visitor>
+		void ForEach(Visitor&& visitor) const
+		{
+			for (const auto order : denseSlots_)
+				if (order)
+					visitor(order);
+
+			for (const auto& slot : slots_)
+				if (slot.order_)
+					visitor(slot.order_);
+		}
+
+	private:
+		struct Slot
+		{
+			OrderId orderId_{};
+			OrderHandle order_{ nullptr };	// nullptr marks an empty slot
+		};
+
+		std::pmr::vector<Slot> slots_;
+		std::size_t mask_{ 0 };
+		std::size_t hashedSize_{ 0 };
+
+		bool dense_{ false };
+		bool denseBaseSet_{ false };
+		// The window is [denseBase_, denseBase_ + denseSlots_.size()). Every id in the hash table is below it.
+		OrderId denseBase_{ 0 };
+		std::size_t denseMask_{ 0 };
+		std::pmr::vector<OrderHandle> denseSlots_;
+
+		std::size_t size_{ 0 };
+
+		std::size_t Home(OrderId orderId) const
+		{
+			// Fibonacci hashing, the high bits of the product are well mixed even for sequential ids
+			return static_cast<std::size_t>((orderId * 0x9E3779B97F4A7C15ull) >> 32) & mask_;
+		}
+
+		OrderHandle FindHashed(OrderId orderId) const;
+		bool InsertHashed(OrderId orderId, OrderHandle order);
+		OrderHandle ExtractHashed(OrderId orderId);
+		void Rehash(std::size_t capacity);
+		// Moves the window forward to start at 'base', the orders still in the slots it leaves behind go to the hash table.
+		void SlideDenseWindow(OrderId base);
+	};
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "api/obRestingOrder.hpp"
+
+//lib
+#include <cstddef>
+#include <iterator>
+
+namespace ob
+{
+	/* Intrusive, doubly linked list of the orders resting at one price level, in time priority.
+	*  The links live inside RestingOrder itself, so pushing or erasing never allocates, and erasing only needs the RestingOrder*.
+	*  The list does not own its orders, they belong to the OrderBook's OrderPool.
+	*  It also keeps the level's aggregate remaining quantity up to date, as long as fills go through Fill below.
+	*/
+	class OrderList
+	{
+	public:
+		class ConstIterator
+		{
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = RestingOrder;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const RestingOrder*;
+			using reference = const RestingOrder&;
+
+			ConstIterator() = default;
+			explicit ConstIterator(const RestingOrder* order) : order_{ order } { }
+
+			reference operator*() const { return *order_; }
+			pointer operator->() const { return order_; }
+			ConstIterator& operator++() { order_ = order_->next_; return *this; }
+			ConstIterator operator++(int) { ConstIterator copy{ *this }; ++(*this); return copy; }
+			bool operator==(const ConstIterator&) const = default;
+
+		private:
+			const RestingOrder* order_{ nullptr };
+		};
+
+		bool empty() const { return size_ == 0; }
+		std::size_t size() const { return size_; }
+		// Sum of the remaining quantity of every order in the list.
+		Quantity GetQuantity() const { return quantity_; }
+
+		RestingOrder& front() { return *head_; }
+		const RestingOrder& front() const { return *head_; }
+
+		ConstIterator begin() const { return ConstIterator{ head_ }; }
+		ConstIterator end() const { return ConstIterator{}; }
+
+		void push_back(RestingOrder& order)
+		{
+			order.SetPrev(tail_);
+			order.next_ = nullptr;
+
+			if (tail_)
+				tail_->next_ = &order;
+			else
+				head_ = &order;
+
+			tail_ = &order;
+			++size_;
+			quantity_ += order.GetRemainingQuantity();
+		}
+
+		void erase(RestingOrder& order)
+		{
+			RestingOrder* prev = order.GetPrev();
+			if (prev)
+				prev->next_ = order.next_;
+			else
+				head_ = order.next_;
+
+			if (order.next_)
+				order.next_->SetPrev(prev);
+			else
+				tail_ = prev;
+
+			order.SetPrev(nullptr);
+			order.next_ = nullptr;
+			--size_;
+			quantity_ -= order.GetRemainingQuantity();
+		}
+
+		void pop_front() { erase(*head_); }
+
+		// Fills an order of this list, keeping the level quantity in sync.
+		void Fill(RestingOrder& order, Quantity quantity)
+		{
+			order.Fill(quantity);
+			quantity_ -= quantity;
+		}
+
+		// Reduces an order of this list in place (it keeps its place in the queue), keeping the level quantity in sync.
+		void Reduce(RestingOrder& order, Quantity quantity)
+		{
+			quantity_ -= order.GetRemainingQuantity() - quantity;
+			order.Reduce(quantity);
+		}
+
+		// Empties the list in one go, handing every order to 'dispose' front to back. Nothing is unlinked one by one, so 'dispose' may free the order.
+		template <typename Disposer>
+		void clear_and_dispose(Disposer dispose)
+		{
+			for (RestingOrder* order = head_; order;)
+			{
+				RestingOrder* next = order->next_;
+				order->SetPrev(nullptr);
+				order->next_ = nullptr;
+				dispose(*order);
+				order = next;
+			}
+
+			clear();
+		}
+
+		// Forgets every order without touching them, the caller is responsible for the orders themselves.
+		void clear()
+		{
+			head_ = tail_ = nullptr;
+			size_ = 0;
+			quantity_ = 0;
+		}
+
+	private:
+		RestingOrder* head_{ nullptr };
+		RestingOrder* tail_{ nullptr };
+		std::size_t size_{ 0 };
+		Quantity quantity_{ 0 };
+	};
+}
@@ -3,6 +3,7 @@
 #include "api/obAliases.hpp"
 #include "api/obSide.hpp"
 #include "api/obOrderType.hpp"
+#include "api/obOrder.hpp"
 
 namespace ob
 {
@@ -24,7 +25,13 @@ namespace ob
 
 		OrderPointer ToOrderPointer(OrderType type) const
 		{
-			return std::make_shared<Order>(type, GetOrderId(), GetSide(), GetPrice(), GetQuantity());
+			return std::make_shared<Order>(ToOrder(type));
+		}
+
+		// The expiry and owner are the original order's, a modify never changes how long an order lives or whose it is.
+		Order ToOrder(OrderType type, Timestamp expiry = {}, OwnerId owner = {}) const
+		{
+			return Order{ type, GetOrderId(), GetSide(), GetPrice(), GetQuantity(), expiry, owner };
 		}
 
 	private:
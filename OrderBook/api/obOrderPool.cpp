@@ -0,0 +1,87 @@
+#include "api/obOrderPool.hpp"
+
+// lib
+#include <algorithm>
+#include <new>
+
+namespace ob
+{
+	/*******************************************************************
+	*							Private API							   *
+	********************************************************************/
+	void OrderPool::Grow(std::size_t slots)
+	{
+		const Slab slab{ nullptr, std::min((std::max<std::size_t>(slots, 1) + BlockSize - 1) / BlockSize * BlockSize, SlabSize) };
+		auto* data = static_cast<Slot*>(memory_->allocate(slab.GetBytes(), DetailsOffset));
+
+		// Nothing is written to it, TakeFresh gets to it once the slabs before it are used up.
+		slabs_.push_back(Slab{ data, slab.size_ });
+		capacity_ += slab.size_;
+	}
+
+	OrderPool::Slot* OrderPool::TakeFresh()
+	{
+		while (fresh_ == freshEnd_)
+		{
+			// freshEnd_ is where the details of the block just used up start, the next block's orders come after them.
+			if (freshSlabEnd_ and freshEnd_ + BlockSize != freshSlabEnd_)
+			{
+				fresh_ = freshEnd_ + BlockSize;
+				freshEnd_ = fresh_ + BlockSize;
+				continue;
+			}
+
+			if (freshSlab_ == slabs_.size())
+				Grow(SlabSize);
+
+			const Slab& slab = slabs_[freshSlab_++];
+			fresh_ = slab.slots_;
+			freshEnd_ = slab.slots_ + BlockSize;
+			freshSlabEnd_ = slab.GetEnd();
+		}
+
+		return fresh_++;
+	}
+
+	/*******************************************************************
+	*							Public API							   *
+	********************************************************************/
+	OrderPool::OrderPool(std::size_t capacity, std::pmr::memory_resource* memory)
+		: memory_{ memory }
+	{
+		while (Capacity() < capacity)
+			Grow(capacity - Capacity());
+	}
+
+	// Orders still in the pool are simply dropped with their slabs, like a book's resting orders always were.
+	OrderPool::~OrderPool()
+	{
+		for (const Slab& slab : slabs_)
+			memory_->deallocate(slab.slots_, slab.GetBytes(), DetailsOffset);
+	}
+
+	RestingOrder* OrderPool::Create(const Order& order)
+	{
+		Slot* slot = freeList_;
+		if (slot)
+			freeList_ = slot->nextFree_;
+		else
+			slot = TakeFresh();
+		++size_;
+
+		RestingOrder* created = ::new (static_cast<void*>(slot->storage_)) RestingOrder{ order };
+		::new (static_cast<void*>(&GetDetails(*created))) OrderDetails{ order };
+		return created;
+	}
+
+	void OrderPool::Release(RestingOrder* order)
+	{
+		GetDetails(*order).~OrderDetails();
+		order->~RestingOrder();
+
+		Slot* slot = reinterpret_cast<Slot*>(order);
+		slot->nextFree_ = freeList_;
+		freeList_ = slot;
+		--size_;
+	}
+}
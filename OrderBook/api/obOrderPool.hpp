@@ -0,0 +1,90 @@
+#pragma once
+
+#include "api/obRestingOrder.hpp"
+
+//lib
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+namespace ob
+{
+	/* Slab allocator for the orders resting in an OrderBook.
+	*  Orders are constructed in place in fixed size slabs that never move, so a RestingOrder* handed out by Create stays valid until Release,
+	*  and released slots go on a free list to be reused by the next Create. Once the pool has grown to the size of the book, no more heap allocations happen.
+	*  A slab is a run of blocks, each BlockSize RestingOrders back to back (a page of them), then their OrderDetails in the same order.
+	*  The details take a slot as big as an order's, so they are always DetailsOffset bytes after it: no lookup, no pointer to keep, and nothing depends on where the slab is.
+	*  The first slab of a pool smaller than SlabSize is short: it only holds 'capacity' slots, rounded up to whole blocks.
+	*  Released slots are reused first, otherwise slots are handed out block by block in address order. Nothing is written ahead of that,
+	*  so a page is only touched once an order needs it and a thousand small books cost what their orders take, not a slab each. A book that wants its pages faulted in up front uses a prefaulted MemoryArena.
+	*  Slabs are asked for page aligned, so that a page holds either half of a block, not both.
+	*/
+	class OrderPool
+	{
+	public:
+		static constexpr std::size_t BlockSize = 128;
+		static constexpr std::size_t BlockBytes = 2 * BlockSize * sizeof(RestingOrder);
+		static constexpr std::size_t SlabBytes = std::size_t{ 1 } << 19;
+		static constexpr std::size_t SlabSize = SlabBytes / BlockBytes * BlockSize;
+
+		explicit OrderPool(std::size_t capacity = SlabSize, std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+		~OrderPool();
+
+		OrderPool(const OrderPool&) = delete;
+		OrderPool& operator=(const OrderPool&) = delete;
+
+		RestingOrder* Create(const Order& order);
+		void Release(RestingOrder* order);
+
+		static OrderDetails& GetDetails(const RestingOrder& order)
+		{
+			return *reinterpret_cast<OrderDetails*>(reinterpret_cast<std::uintptr_t>(&order) + DetailsOffset);
+		}
+
+		static RestingOrder& GetOrder(const OrderDetails& details)
+		{
+			return *reinterpret_cast<RestingOrder*>(reinterpret_cast<std::uintptr_t>(&details) - DetailsOffset);
+		}
+
+		std::size_t Size() const { return size_; }
+		std::size_t Capacity() const { return capacity_; }
+
+	private:
+		union Slot
+		{
+			Slot* nextFree_;
+			alignas(RestingOrder) std::byte storage_[sizeof(RestingOrder)];
+		};
+
+		static constexpr std::size_t DetailsOffset = BlockSize * sizeof(Slot);
+		static_assert(sizeof(Slot) == sizeof(RestingOrder) and sizeof(OrderDetails) <= sizeof(RestingOrder) and alignof(OrderDetails) <= alignof(RestingOrder),
+			"An order's details are found a fixed offset after it, in a slot of the same size.");
+
+		struct Slab
+		{
+			// The start of the first block. Block k's orders are at slots_ + 2 * k * BlockSize, its details right after them.
+			Slot* slots_{ nullptr };
+			// Orders it holds, whole blocks.
+			std::size_t size_{ 0 };
+
+			std::size_t GetBytes() const { return size_ / BlockSize * BlockBytes; }
+			Slot* GetEnd() const { return slots_ + 2 * size_; }
+		};
+
+		std::pmr::memory_resource* const memory_;
+		std::vector<Slab> slabs_{};
+		Slot* freeList_{ nullptr };
+		// Slots never handed out yet: the rest of the block being started on, the blocks after it up to freshSlabEnd_, then every slab from slabs_[freshSlab_] on.
+		Slot* fresh_{ nullptr };
+		Slot* freshEnd_{ nullptr };
+		Slot* freshSlabEnd_{ nullptr };
+		std::size_t freshSlab_{ 0 };
+		std::size_t size_{ 0 };
+		std::size_t capacity_{ 0 };
+
+		// Adds a slab of 'slots' slots rounded up to whole blocks, at most SlabSize.
+		void Grow(std::size_t slots);
+		Slot* TakeFresh();
+	};
+}
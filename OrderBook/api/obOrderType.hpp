@@ -1,13 +1,17 @@
 #pragma once
 
+//lib
+#include <cstdint>
+
 namespace ob
 {
-	enum class OrderType
+	enum class OrderType : std::uint8_t
 	{
 		GoodTillCancel,
 		FillAndKill,
 		FillOrKill,
 		GoodForDay,
-		Market
+		Market,
+		GoodTillTime	// rests until its expiry time (see Order::GetExpiry), new types go last as journals and snapshots store the value
 	};
 }
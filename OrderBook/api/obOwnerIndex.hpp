@@ -0,0 +1,78 @@
+#pragma once
+
+#include "api/obAliases.hpp"
+#include "api/obOrderPool.hpp"
+
+//lib
+#include <cstddef>
+#include <memory_resource>
+#include <unordered_map>
+
+namespace ob
+{
+	/* OwnerId -> that owner's resting orders, as an intrusive list through each order's OwnerHook (in its OrderDetails), oldest first.
+	*  Cancelling everything an owner has (e.g. on disconnect) walks exactly its orders, however big the book is.
+	*  Orders without an owner are never linked. An owner's entry comes with its first resting order and goes with its last,
+	*  so owners that come and go (e.g. keyed by session, a new one on every reconnect) don't pile up.
+	*/
+	class OwnerIndex
+	{
+	public:
+		explicit OwnerIndex(std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+			: owners_{ memory }
+		{ }
+
+		// Links a resting order into its owner's list.
+		void Insert(RestingOrder& order)
+		{
+			OrderDetails& details = OrderPool::GetDetails(order);
+			if (details.GetOwner() == OwnerId{})
+				return;
+
+			OwnerHook& sentinel = owners_[details.GetOwner()].sentinel_;
+			details.ownerPrev_ = sentinel.ownerPrev_;
+			details.ownerNext_ = &sentinel;
+			sentinel.ownerPrev_->ownerNext_ = &details;
+			sentinel.ownerPrev_ = &details;
+		}
+
+		/* Unlinking needs no lookup, see OwnerHook, only taking out the owner's entry once that was its last order does.
+		*  Orders without an owner aren't linked, their OrderDetails aren't even read. */
+		void Erase(RestingOrder& order)
+		{
+			if (!order.HasOwner())
+				return;
+
+			OrderDetails& details = OrderPool::GetDetails(order);
+			OwnerHook* const next = details.ownerNext_;
+			details.Unlink();
+
+			// Only the sentinel of a list that is now empty points at itself.
+			if (next->ownerNext_ == next)
+				owners_.erase(details.GetOwner());
+		}
+
+		// The owner's oldest resting order, or null if it has none. Cancelling it makes the next one the oldest.
+		RestingOrder* Front(OwnerId owner) const
+		{
+			const auto it = owners_.find(owner);
+			if (it == owners_.end())
+				return nullptr;
+
+			return &OrderPool::GetOrder(static_cast<const OrderDetails&>(*it->second.sentinel_.ownerNext_));
+		}
+
+	private:
+		// The sentinel of an empty list points at itself, only ever briefly. Map nodes never move, so neither do the sentinels the orders point at.
+		struct Owner
+		{
+			Owner() { sentinel_.ownerPrev_ = sentinel_.ownerNext_ = &sentinel_; }
+			Owner(const Owner&) = delete;
+			Owner& operator=(const Owner&) = delete;
+
+			OwnerHook sentinel_{};
+		};
+
+		std::pmr::unordered_map<OwnerId, Owner> owners_;
+	};
+}
@@ -0,0 +1,444 @@
+#include "api/obPriceLadder.hpp"
+
+// lib
+#include <bit>
+#include <stdexcept>
+#include <algorithm>
+#include <iterator>
+
+namespace ob
+{
+	/*******************************************************************
+	*							Private API							   *
+	********************************************************************/
+	bool PriceLadder::InRange(Price price) const
+	{
+		return price >= basePrice_ and price < basePrice_ + static_cast<std::int64_t>(levels_.size()) * tickSize_;
+	}
+
+	std::size_t PriceLadder::GetSpan(Price price) const
+	{
+		std::int64_t low = price;
+		std::int64_t high = price;
+		if (levelCount_ > 0)
+		{
+			low = std::min<std::int64_t>(low, ToPrice(std::min(best_, worst_)));
+			high = std::max<std::int64_t>(high, ToPrice(std::max(best_, worst_)));
+		}
+
+		return static_cast<std::size_t>((high - low) / tickSize_) + 1;
+	}
+
+	std::size_t PriceLadder::NextOccupiedAbove(std::size_t index) const
+	{
+		std::size_t start = index + 1;
+		if (start >= levels_.size())
+			return npos;
+
+		std::size_t word = start >> 6;
+		// mask off the bits below 'start' in the first word
+		std::uint64_t bits = occupied_[word] & (~std::uint64_t{ 0 } << (start & 63));
+
+		while (true)
+		{
+			if (bits)
+				return (word << 6) + std::countr_zero(bits);
+
+			if (++word == occupied_.size())
+				return npos;
+
+			bits = occupied_[word];
+		}
+	}
+
+	std::size_t PriceLadder::NextOccupiedBelow(std::size_t index) const
+	{
+		if (index == 0)
+			return npos;
+
+		std::size_t end = index - 1;
+		std::size_t word = end >> 6;
+		// mask off the bits above 'end' in the first word
+		std::uint64_t bits = occupied_[word] & (~std::uint64_t{ 0 } >> (63 - (end & 63)));
+
+		while (true)
+		{
+			if (bits)
+				return (word << 6) + 63 - std::countl_zero(bits);
+
+			if (word-- == 0)
+				return npos;
+
+			bits = occupied_[word];
+		}
+	}
+
+	void PriceLadder::AddQuantity(std::size_t index, std::uint64_t delta)
+	{
+		totalQuantity_ += delta;
+		for (std::size_t i = index + 1; i < quantityTree_.size(); i += i & (~i + 1))
+			quantityTree_[i] += delta;
+	}
+
+	std::uint64_t PriceLadder::GetPrefixQuantity(std::size_t end) const
+	{
+		std::uint64_t quantity = 0;
+		for (std::size_t i = end; i > 0; i -= i & (~i + 1))
+			quantity += quantityTree_[i];
+
+		return quantity;
+	}
+
+	// O(n) build, each node pushes its partial sum up to its parent once.
+	void PriceLadder::RebuildQuantityTree()
+	{
+		quantityTree_.assign(levels_.size() + 1, 0);
+		counted_.assign(levels_.size(), 0);
+		orderCounts_.assign(levels_.size(), 0);
+		totalQuantity_ = 0;
+
+		for (std::size_t index = 0; index < levels_.size(); ++index)
+		{
+			counted_[index] = levels_[index].GetQuantity();
+			orderCounts_[index] = static_cast<Quantity>(levels_[index].size());
+			totalQuantity_ += counted_[index];
+
+			const std::size_t node = index + 1;
+			quantityTree_[node] += counted_[index];
+			const std::size_t parent = node + (node & (~node + 1));
+			if (parent < quantityTree_.size())
+				quantityTree_[parent] += quantityTree_[node];
+		}
+	}
+
+	/* Moves the window so that 'price' and the occupied levels fit, with the occupied range roughly centered.
+	*  Only as many of them as maxLevels_ ticks reach from the best of them (or 'price', if it is better) though, the ones behind that go to the overflow.
+	*  This is the slow path, it only runs when the market drifts far enough from where the ladder was placed.
+	*/
+	void PriceLadder::Recenter(Price price)
+	{
+		std::int64_t best = price;
+		std::int64_t worst = price;
+		if (levelCount_ > 0)
+		{
+			if (IsWorse(price, ToPrice(best_)))
+				best = ToPrice(best_);
+			if (IsWorse(ToPrice(worst_), price))
+				worst = ToPrice(worst_);
+		}
+
+		const std::int64_t reach = static_cast<std::int64_t>(maxLevels_ - 1) * tickSize_;
+		worst = side_ == Side::Buy ? std::max(worst, best - reach) : std::min(worst, best + reach);
+		const std::int64_t low = std::min(best, worst);
+		const std::size_t needed = static_cast<std::size_t>((std::max(best, worst) - low) / tickSize_) + 1;
+
+		std::size_t size = levels_.size();
+		// leave some room on both sides, otherwise the very next tick outside the range re-centers again. Up to maxLevels_, which needed fits in.
+		while (size < needed * 2 and size < maxLevels_)
+			size *= 2;
+		size = std::max(std::min(size, maxLevels_), needed);
+
+		const std::int64_t newBase = low - static_cast<std::int64_t>((size - needed) / 2) * tickSize_;
+		const std::int64_t newEnd = newBase + static_cast<std::int64_t>(size) * tickSize_;
+
+		std::pmr::vector<OrderList> levels(size, levels_.get_allocator());
+		std::pmr::vector<std::uint64_t> occupied((size + 63) / 64, 0, occupied_.get_allocator());
+		std::size_t count = 0;
+		std::size_t lowest = npos;
+		std::size_t highest = 0;
+
+		// the orders themselves don't move, only the list heads do
+		const auto place = [&](std::int64_t levelPrice, const OrderList& orders)
+			{
+				const std::size_t newIndex = static_cast<std::size_t>((levelPrice - newBase) / tickSize_);
+				levels[newIndex] = orders;
+				occupied[newIndex >> 6] |= std::uint64_t{ 1 } << (newIndex & 63);
+				++count;
+				lowest = std::min(lowest, newIndex);
+				highest = std::max(highest, newIndex);
+			};
+
+		if (levelCount_ > 0)
+		{
+			const std::size_t first = std::min(best_, worst_);
+			const std::size_t last = std::max(best_, worst_);
+			for (std::size_t index = first; index <= last; ++index)
+			{
+				if (!IsOccupied(index))
+					continue;
+
+				if (const std::int64_t levelPrice = ToPrice(index); levelPrice >= newBase and levelPrice < newEnd)
+					place(levelPrice, levels_[index]);
+				else
+					overflow_.emplace(static_cast<Price>(levelPrice), levels_[index]);
+			}
+		}
+
+		// The overflow levels the window reaches now, the rest are all behind it.
+		for (auto it = overflow_.lower_bound(static_cast<Price>(newBase)); it != overflow_.end() and it->first < newEnd; it = overflow_.erase(it))
+			place(it->first, it->second);
+
+		levelCount_ = count;
+		best_ = side_ == Side::Buy ? highest : lowest;
+		worst_ = side_ == Side::Buy ? lowest : highest;
+		basePrice_ = newBase;
+		levels_ = std::move(levels);
+		occupied_ = std::move(occupied);
+		RebuildQuantityTree();
+	}
+
+	bool PriceLadder::VisitFrom(std::size_t index, const LevelVisitor& visitor) const
+	{
+		for (; index != npos; index = NextWorse(index))
+		{
+			if (!visitor(ToPrice(index), levels_[index]))
+				return false;
+			if (index == worst_)
+				break;
+		}
+
+		return true;
+	}
+
+	bool PriceLadder::VisitOverflowAfter(Price price, const LevelVisitor& visitor) const
+	{
+		if (side_ == Side::Buy)
+		{
+			for (auto it = std::make_reverse_iterator(overflow_.lower_bound(price)); it != overflow_.rend(); ++it)
+				if (!visitor(it->first, it->second))
+					return false;
+		}
+		else
+		{
+			for (auto it = overflow_.upper_bound(price); it != overflow_.end(); ++it)
+				if (!visitor(it->first, it->second))
+					return false;
+		}
+
+		return true;
+	}
+
+	/*******************************************************************
+	*							Public API							   *
+	********************************************************************/
+	PriceLadder::PriceLadder(Side side, Price basePrice, Price tickSize, std::size_t levels, std::size_t maxLevels, std::pmr::memory_resource* memory)
+		: side_{ side }
+		, basePrice_{ basePrice }
+		, tickSize_{ tickSize }
+		, maxLevels_{ std::max<std::size_t>({ levels, maxLevels, 64 }) }
+		, levels_(std::max<std::size_t>(levels, 64), memory)
+		, occupied_((levels_.size() + 63) / 64, 0, memory)
+		, quantityTree_(levels_.size() + 1, 0, memory)
+		, counted_(levels_.size(), 0, memory)
+		, orderCounts_(levels_.size(), 0, memory)
+		, overflow_{ memory }
+	{
+		if (tickSize <= 0)
+			throw std::invalid_argument("PriceLadder tick size must be positive.");
+	}
+
+	bool PriceLadder::IsValidPrice(Price price) const
+	{
+		return (price - basePrice_) % tickSize_ == 0;
+	}
+
+	Price PriceLadder::GetWorstPrice() const
+	{
+		if (overflow_.empty())
+			return ToPrice(worst_);
+
+		return side_ == Side::Buy ? overflow_.begin()->first : overflow_.rbegin()->first;
+	}
+
+	OrderList& PriceLadder::GetOrCreateLevel(Price price)
+	{
+		if (!InRange(price))
+		{
+			// Too far behind the window's levels for one window to hold both.
+			if (levelCount_ > 0 and IsWorse(price, ToPrice(worst_)) and GetSpan(price) > maxLevels_)
+				return overflow_[price];
+
+			Recenter(price);
+		}
+
+		const std::size_t index = ToIndex(price);
+		if (IsOccupied(index))
+			return levels_[index];
+
+		occupied_[index >> 6] |= std::uint64_t{ 1 } << (index & 63);
+
+		if (levelCount_++ == 0)
+		{
+			best_ = worst_ = index;
+		}
+		else
+		{
+			if (IsBetter(index, best_))
+				best_ = index;
+			if (IsBetter(worst_, index))
+				worst_ = index;
+		}
+
+		return levels_[index];
+	}
+
+	OrderList& PriceLadder::GetLevel(Price price)
+	{
+		if (InRange(price) and IsOccupied(ToIndex(price)))
+			return levels_[ToIndex(price)];
+
+		if (const auto it = overflow_.find(price); it != overflow_.end())
+			return it->second;
+
+		throw std::out_of_range("PriceLadder has no level at this price.");
+	}
+
+	void PriceLadder::EraseLevel(Price price)
+	{
+		if (!InRange(price))
+		{
+			overflow_.erase(price);
+			return;
+		}
+
+		const std::size_t index = ToIndex(price);
+		if (!IsOccupied(index))
+			return;
+
+		levels_[index].clear();
+		occupied_[index >> 6] &= ~(std::uint64_t{ 1 } << (index & 63));
+		UpdateAggregates(price);
+
+		if (--levelCount_ == 0)
+		{
+			if (!overflow_.empty())
+				Recenter(side_ == Side::Buy ? overflow_.rbegin()->first : overflow_.begin()->first);
+			return;
+		}
+
+		// Only the cursors that pointed at this level need to move, and they always move towards the other cursor.
+		if (index == best_)
+			best_ = NextWorse(index);
+		if (index == worst_)
+			worst_ = side_ == Side::Buy ? NextOccupiedAbove(index) : NextOccupiedBelow(index);
+	}
+
+	void PriceLadder::ForEachLevel(const LevelVisitor& visitor) const
+	{
+		if (Empty())
+			return;
+
+		if (VisitFrom(best_, visitor))
+			VisitOverflowAfter(ToPrice(worst_), visitor);
+	}
+
+	void PriceLadder::ForEachLevelAfter(Price price, const LevelVisitor& visitor) const
+	{
+		if (Empty() or !IsWorse(GetWorstPrice(), price))
+			return;
+
+		// Past the window's worst level only the overflow is left.
+		if (!IsWorse(ToPrice(worst_), price))
+		{
+			VisitOverflowAfter(price, visitor);
+			return;
+		}
+
+		// Not better than the best level and better than the worst, so inside the window whatever the ladder re-centered to since 'price' was a level.
+		if (VisitFrom(IsWorse(GetBestPrice(), price) ? best_ : NextWorse(ToIndex(price)), visitor))
+			VisitOverflowAfter(ToPrice(worst_), visitor);
+	}
+
+	std::size_t PriceLadder::GetDepth(std::span<LevelInfo> levels) const
+	{
+		if (Empty())
+			return 0;
+
+		std::size_t count = 0;
+		for (std::size_t index = best_; index != npos and count < levels.size(); index = NextWorse(index))
+		{
+			levels[count++] = ToLevelInfo(ToPrice(index), levels_[index]);
+			if (index == worst_)
+				break;
+		}
+
+		if (count < levels.size() and !overflow_.empty())
+		{
+			VisitOverflowAfter(ToPrice(worst_), [&levels, &count](Price price, const OrderList& orders)
+				{
+					levels[count++] = ToLevelInfo(price, orders);
+					return count < levels.size();
+				});
+		}
+
+		return count;
+	}
+
+	void PriceLadder::GetDepth(LevelArrays& levels) const
+	{
+		if (Empty())
+			return;
+
+		levels.Reserve(levels.Size() + GetLevelCount());
+		for (std::size_t index = best_; index != npos; index = NextWorse(index))
+		{
+			levels.Append(ToPrice(index), counted_[index], orderCounts_[index]);
+			if (index == worst_)
+				break;
+		}
+
+		if (!overflow_.empty())
+		{
+			VisitOverflowAfter(ToPrice(worst_), [&levels](Price price, const OrderList& orders)
+				{
+					levels.Append(price, orders.GetQuantity(), static_cast<Quantity>(orders.size()));
+					return true;
+				});
+		}
+	}
+
+	void PriceLadder::UpdateAggregates(Price price)
+	{
+		if (!InRange(price))
+			return;
+
+		const std::size_t index = ToIndex(price);
+		orderCounts_[index] = static_cast<Quantity>(levels_[index].size());
+
+		const Quantity quantity = levels_[index].GetQuantity();
+		if (quantity == counted_[index])
+			return;
+
+		AddQuantity(index, static_cast<std::uint64_t>(quantity) - counted_[index]);
+		counted_[index] = quantity;
+	}
+
+	std::uint64_t PriceLadder::GetQuantityAtOrBetter(Price price, std::uint64_t enough) const
+	{
+		// Position of 'price' on the ladder, rounded towards the worse side when it falls between two ticks.
+		const std::int64_t offset = static_cast<std::int64_t>(price) - basePrice_;
+		const std::int64_t size = static_cast<std::int64_t>(levels_.size());
+		std::uint64_t quantity = 0;
+
+		if (side_ == Side::Buy)
+		{
+			// bids at or above the price: levels [ceil(offset / tick), size)
+			const std::int64_t first = offset <= 0 ? 0 : (offset + tickSize_ - 1) / tickSize_;
+			if (first < size)
+				quantity = totalQuantity_ - GetPrefixQuantity(static_cast<std::size_t>(first));
+
+			// then the overflow, walked like a map from its best level, only when 'price' reaches past the window
+			for (auto it = overflow_.rbegin(); it != overflow_.rend() and quantity < enough and it->first >= price; ++it)
+				quantity += it->second.GetQuantity();
+			return quantity;
+		}
+
+		// asks at or below the price: levels [0, floor(offset / tick)]
+		if (offset >= 0)
+			quantity = GetPrefixQuantity(static_cast<std::size_t>(std::min(offset / tickSize_, size - 1)) + 1);
+
+		for (auto it = overflow_.begin(); it != overflow_.end() and quantity < enough and it->first <= price; ++it)
+			quantity += it->second.GetQuantity();
+		return quantity;
+	}
+}
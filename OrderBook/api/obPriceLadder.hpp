@@ -0,0 +1,107 @@
+#pragma once
+
+#include "api/obPriceLevels.hpp"
+#include "api/obSide.hpp"
+
+//lib
+#include <cstdint>
+#include <map>
+#include <memory_resource>
+#include <vector>
+
+namespace ob
+{
+	/* Flat, tick-indexed storage for one side of the book.
+	*  Level i holds the orders at price basePrice_ + i * tickSize_, so finding a level is a subtraction and a division instead of a tree walk.
+	*  A bitmap with one bit per level tracks which levels are occupied, so that when the best level empties we can find
+	*  the next one by scanning 64 levels at a time instead of touching every (mostly empty) list.
+	*  When a price falls outside of the window the ladder re-centers itself around the occupied range, doubling its size if the range doesn't fit.
+	*  It never grows past maxLevels_ ticks though. The window holds the best levels, and levels further than that behind them wait in overflow_,
+	*  an ordered map like MapPriceLevels', so a far-off order costs a map node rather than a window as wide as the distance,
+	*  and the orders near the touch stay in the window whatever rests far away. When the window empties, the best of the overflow becomes the window.
+	*/
+	class PriceLadder final : public PriceLevels
+	{
+	public:
+		PriceLadder(Side side, Price basePrice, Price tickSize, std::size_t levels, std::size_t maxLevels,
+			std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+		bool Empty() const override { return levelCount_ == 0; }
+		std::size_t GetLevelCount() const override { return levelCount_ + overflow_.size(); }
+		// On a tick. Too far behind the window's levels, it rests in the overflow.
+		bool IsValidPrice(Price price) const override;
+
+		Price GetBestPrice() const override { return ToPrice(best_); }
+		Price GetWorstPrice() const override;
+		OrderList& GetBestLevel() override { return levels_[best_]; }
+
+		OrderList& GetOrCreateLevel(Price price) override;
+		OrderList& GetLevel(Price price) override;
+		void EraseLevel(Price price) override;
+
+		void ForEachLevel(const LevelVisitor& visitor) const override;
+		void ForEachLevelAfter(Price price, const LevelVisitor& visitor) const override;
+		std::size_t GetDepth(std::span<LevelInfo> levels) const override;
+		// Straight from the per-tick arrays below, the order lists aren't touched.
+		void GetDepth(LevelArrays& levels) const override;
+
+		// O(log levels) from the Fenwick tree, however many levels the price is away from the touch.
+		std::uint64_t GetQuantityAtOrBetter(Price price, std::uint64_t enough) const override;
+		void UpdateAggregates(Price price) override;
+
+	private:
+		static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+		Side side_;
+		std::int64_t basePrice_;
+		std::int64_t tickSize_;
+		std::size_t maxLevels_;
+		std::pmr::vector<OrderList> levels_;
+		std::pmr::vector<std::uint64_t> occupied_;
+		std::size_t levelCount_{ 0 };
+		// Indices of the best and worst occupied levels, only meaningful when levelCount_ > 0
+		std::size_t best_{ 0 };
+		std::size_t worst_{ 0 };
+		/* Fenwick (binary indexed) tree over the level quantities, so the quantity of any range of levels is two O(log n) prefix sums.
+		*  counted_[i] is what level i currently contributes to it, UpdateAggregates adds the difference to the level's actual quantity.
+		*  Entries are unsigned and rely on wrap-around for negative differences, every prefix sum still comes out right. */
+		std::pmr::vector<std::uint64_t> quantityTree_;
+		std::pmr::vector<Quantity> counted_;
+		/* Order count of every level, per tick like counted_ (which, once UpdateAggregates has run, is the quantity of every level).
+		*  Together they are the ladder's aggregates in structure-of-arrays form, read without going through levels_. */
+		std::pmr::vector<Quantity> orderCounts_;
+		std::uint64_t totalQuantity_{ 0 };
+		/* Levels more than maxLevels_ ticks behind the best one, all of them worse than every level of the window and outside it.
+		*  Empty whenever the window is, and not in the aggregates above. */
+		std::pmr::map<Price, OrderList> overflow_;
+
+		Price ToPrice(std::size_t index) const { return static_cast<Price>(basePrice_ + static_cast<std::int64_t>(index) * tickSize_); }
+		bool InRange(Price price) const;
+		// Ticks from the lowest to the highest of 'price' and the window's occupied levels, both included.
+		std::size_t GetSpan(Price price) const;
+		// Does a level at 'price' match after one at 'other' on this side?
+		bool IsWorse(Price price, Price other) const { return side_ == Side::Buy ? price < other : price > other; }
+		std::size_t ToIndex(Price price) const { return static_cast<std::size_t>((price - basePrice_) / tickSize_); }
+
+		bool IsOccupied(std::size_t index) const { return (occupied_[index >> 6] >> (index & 63)) & 1; }
+		// Closest occupied index strictly above/below 'index', or npos.
+		std::size_t NextOccupiedAbove(std::size_t index) const;
+		std::size_t NextOccupiedBelow(std::size_t index) const;
+		// Does 'index' match before 'other' on this side?
+		bool IsBetter(std::size_t index, std::size_t other) const { return side_ == Side::Buy ? index > other : index < other; }
+		// Next occupied level on the worse side of 'index', or npos.
+		std::size_t NextWorse(std::size_t index) const { return side_ == Side::Buy ? NextOccupiedBelow(index) : NextOccupiedAbove(index); }
+
+		// Visits the window's occupied levels from 'index' (occupied, or npos) to the worst one. Returns false if the visitor stopped.
+		bool VisitFrom(std::size_t index, const LevelVisitor& visitor) const;
+		// Same for the overflow levels worse than 'price'.
+		bool VisitOverflowAfter(Price price, const LevelVisitor& visitor) const;
+		// Moves the window to cover 'price' and the best of the levels, sending the ones it can't reach to overflow_ and taking in the overflow levels it now does.
+		void Recenter(Price price);
+
+		void AddQuantity(std::size_t index, std::uint64_t delta);
+		// Sum of the quantities of levels [0, end).
+		std::uint64_t GetPrefixQuantity(std::size_t end) const;
+		void RebuildQuantityTree();
+	};
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "api/obAliases.hpp"
+#include "api/obOrderList.hpp"
+#include "api/obLevelInfo.hpp"
+
+//lib
+#include <cstdint>
+#include <map>
+#include <memory_resource>
+#include <functional>
+#include <span>
+
+namespace ob
+{
+	/* One side of the book (all the bids, or all the asks), organized by Price-Time priority.
+	*  "Best" always means the price level that matches first: the highest price for bids and the lowest price for asks.
+	*  OrderBook only talks to this interface, so the underlying container can be chosen when the book is constructed.
+	*/
+	class PriceLevels
+	{
+	public:
+		// Return false to stop visiting.
+		using LevelVisitor = std::function<bool(Price, const OrderList&)>;
+
+		virtual ~PriceLevels() = default;
+
+		virtual bool Empty() const = 0;
+		virtual std::size_t GetLevelCount() const = 0;
+		// Can an order resting at this price be stored at all? (e.g. is it aligned to a ladder's tick size)
+		virtual bool IsValidPrice(Price price) const = 0;
+
+		// The following three require that the container is not empty.
+		virtual Price GetBestPrice() const = 0;
+		virtual Price GetWorstPrice() const = 0;
+		virtual OrderList& GetBestLevel() = 0;
+
+		// Same semantics as std::map::operator[] and std::map::at respectively.
+		virtual OrderList& GetOrCreateLevel(Price price) = 0;
+		virtual OrderList& GetLevel(Price price) = 0;
+		virtual void EraseLevel(Price price) = 0;
+
+		// Visits every non-empty level, from the best price to the worst price.
+		virtual void ForEachLevel(const LevelVisitor& visitor) const = 0;
+		// Same, starting from the first level worse than 'price' (which doesn't have to be a level), for walks that are resumed later.
+		virtual void ForEachLevelAfter(Price price, const LevelVisitor& visitor) const = 0;
+		// Writes the aggregates of the best levels.size() levels (or fewer if there aren't as many) and returns how many were written.
+		virtual std::size_t GetDepth(std::span<LevelInfo> levels) const = 0;
+		// Appends every level, best first, to 'levels'.
+		virtual void GetDepth(LevelArrays& levels) const = 0;
+
+		/* Total quantity resting at 'price' or better (at or above it for bids, at or below it for asks).
+		*  Implementations may stop adding up once they reach 'enough', callers that only need to know whether some quantity is there should pass it. */
+		virtual std::uint64_t GetQuantityAtOrBetter(Price price, std::uint64_t enough) const = 0;
+		/* Must be called after the quantity of the level at 'price' changed (orders added, filled or cancelled), before the next GetQuantityAtOrBetter.
+		*  Containers that keep cumulative aggregates catch up here, the others have nothing to do. */
+		virtual void UpdateAggregates(Price) { }
+
+	protected:
+		static LevelInfo ToLevelInfo(Price price, const OrderList& orders)
+		{
+			return LevelInfo{ price, orders.GetQuantity(), static_cast<Quantity>(orders.size()) };
+		}
+	};
+
+	/* The original implementation: an ordered map keyed by price.
+	*  Compare is std::greater<Price> for bids and std::less<Price> for asks, so that begin() is always the best price.
+	*/
+	template <typename Compare>
+	class MapPriceLevels final : public PriceLevels
+	{
+	public:
+		explicit MapPriceLevels(std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+			: levels_{ memory }
+		{ }
+
+		bool Empty() const override { return levels_.empty(); }
+		std::size_t GetLevelCount() const override { return levels_.size(); }
+		bool IsValidPrice(Price) const override { return true; }
+
+		Price GetBestPrice() const override { return levels_.begin()->first; }
+		Price GetWorstPrice() const override { return levels_.rbegin()->first; }
+		OrderList& GetBestLevel() override { return levels_.begin()->second; }
+
+		OrderList& GetOrCreateLevel(Price price) override { return levels_[price]; }
+		OrderList& GetLevel(Price price) override { return levels_.at(price); }
+		void EraseLevel(Price price) override { levels_.erase(price); }
+
+		void ForEachLevel(const LevelVisitor& visitor) const override
+		{
+			for (const auto& [price, orders] : levels_)
+				if (!visitor(price, orders))
+					return;
+		}
+
+		void ForEachLevelAfter(Price price, const LevelVisitor& visitor) const override
+		{
+			for (auto it = levels_.upper_bound(price); it != levels_.end(); ++it)
+				if (!visitor(it->first, it->second))
+					return;
+		}
+
+		std::size_t GetDepth(std::span<LevelInfo> levels) const override
+		{
+			std::size_t count = 0;
+			for (auto it = levels_.begin(); it != levels_.end() and count < levels.size(); ++it)
+				levels[count++] = ToLevelInfo(it->first, it->second);
+
+			return count;
+		}
+
+		void GetDepth(LevelArrays& levels) const override
+		{
+			levels.Reserve(levels.Size() + levels_.size());
+			for (const auto& [price, orders] : levels_)
+				levels.Append(price, orders.GetQuantity(), static_cast<Quantity>(orders.size()));
+		}
+
+		// Walks from the best level, so the cost is the number of levels between the touch and 'price' (or until 'enough' is reached).
+		std::uint64_t GetQuantityAtOrBetter(Price price, std::uint64_t enough) const override
+		{
+			std::uint64_t quantity = 0;
+			for (auto it = levels_.begin(); it != levels_.end() and quantity < enough and !Compare{}(price, it->first); ++it)
+				quantity += it->second.GetQuantity();
+
+			return quantity;
+		}
+
+	private:
+		std::pmr::map<Price, OrderList, Compare> levels_;
+	};
+}
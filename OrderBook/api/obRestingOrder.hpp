@@ -0,0 +1,131 @@
+#pragma once
+
+#include "api/obOrder.hpp"
+
+//lib
+#include <cstdint>
+
+namespace ob
+{
+	/* Links an order into the list of its owner's resting orders (see obOwnerIndex.hpp).
+	*  The list is circular around a sentinel hook, so an order unlinks itself without knowing which list it is in or looking anything up.
+	*/
+	class OwnerHook
+	{
+	public:
+		OwnerHook() = default;
+		OwnerHook(const OwnerHook&) = delete;
+		OwnerHook& operator=(const OwnerHook&) = delete;
+
+		bool IsLinked() const { return ownerNext_ != nullptr; }
+
+		void Unlink()
+		{
+			if (!IsLinked())
+				return;
+
+			ownerPrev_->ownerNext_ = ownerNext_;
+			ownerNext_->ownerPrev_ = ownerPrev_;
+			ownerPrev_ = ownerNext_ = nullptr;
+		}
+
+	private:
+		OwnerHook* ownerPrev_{ nullptr };
+		OwnerHook* ownerNext_{ nullptr };
+
+		friend class OwnerIndex;
+	};
+
+	/* An order resting in a book, split in two by how often it is touched.
+	*  RestingOrder is what matching, queue walks and cancels read: id, price, remaining quantity, side, type and the links of its price level,
+	*  32 bytes, two to a cache line. OrderDetails is the rest, only read when the order is added, modified, expired or snapshotted, or has an owner.
+	*  Both live in the book's OrderPool, the details a fixed distance after the order, which is how one is found from the other (OrderPool::GetDetails).
+	*/
+	class alignas(32) RestingOrder
+	{
+	public:
+		explicit RestingOrder(const Order& order)
+			: orderId_{ order.GetOrderId() }
+			, price_{ order.GetPrice() }
+			, remainingQuantity_{ order.GetRemainingQuantity() }
+			, prevAndFlags_{ static_cast<std::uintptr_t>(order.GetSide()) << SideShift | static_cast<std::uintptr_t>(order.GetOrderType()) << TypeShift
+				| static_cast<std::uintptr_t>(order.GetOwner() != OwnerId{}) << OwnedShift }
+		{ }
+
+		RestingOrder(const RestingOrder&) = delete;
+		RestingOrder& operator=(const RestingOrder&) = delete;
+
+		OrderId GetOrderId() const { return orderId_; }
+		Price GetPrice() const { return price_; }
+		Quantity GetRemainingQuantity() const { return remainingQuantity_; }
+		bool IsFilled() const { return remainingQuantity_ == 0; }
+		Side GetSide() const { return static_cast<Side>(prevAndFlags_ >> SideShift & 0b1); }
+		OrderType GetOrderType() const { return static_cast<OrderType>(prevAndFlags_ >> TypeShift & 0b111); }
+		bool Expires() const { return GetOrderType() == OrderType::GoodTillTime or GetOrderType() == OrderType::GoodForDay; }
+		// Whether the order has an owner, i.e. is linked in an OwnerIndex list, without reading the OrderDetails.
+		bool HasOwner() const { return prevAndFlags_ >> OwnedShift & 0b1; }
+
+		/* Unchecked: the book only ever fills the smaller of two remaining quantities, so the check Order::Fill makes could never fire here.
+		*  Use OrderList::Fill, which keeps the level quantity in sync. */
+		void Fill(Quantity quantity) { remainingQuantity_ -= quantity; }
+
+		// See OrderDetails::Reduce, which has to go with it.
+		void Reduce(Quantity quantity)
+		{
+			if (quantity > remainingQuantity_) [[unlikely]]
+				ThrowQuantityError(orderId_, "reduced to");
+
+			remainingQuantity_ = quantity;
+		}
+
+	private:
+		/* Resting orders are aligned to their size, so the low five bits of a link to one are always zero.
+		*  prevAndFlags_ keeps the order's side, type and whether it has an owner in them, next to the link to the previous order:
+		*  there is no room for a separate field, and a cancel can then tell which side to look at without loading the OrderDetails. */
+		static constexpr unsigned SideShift = 0;
+		static constexpr unsigned OwnedShift = 1;
+		static constexpr unsigned TypeShift = 2;
+		static constexpr std::uintptr_t FlagBits = 0b11111;
+
+		OrderId orderId_;
+		Price price_;
+		Quantity remainingQuantity_;
+
+		/* Intrusive links to the neighbouring orders of the same price level (see obOrderList.hpp), the previous one under the flags.
+		*  Only meaningful while the order rests in an OrderBook. */
+		std::uintptr_t prevAndFlags_;
+		RestingOrder* next_{ nullptr };
+
+		RestingOrder* GetPrev() const { return reinterpret_cast<RestingOrder*>(prevAndFlags_ & ~FlagBits); }
+		void SetPrev(RestingOrder* prev) { prevAndFlags_ = reinterpret_cast<std::uintptr_t>(prev) | (prevAndFlags_ & FlagBits); }
+
+		friend class OrderList;
+	};
+
+	static_assert(sizeof(RestingOrder) == 32 and alignof(RestingOrder) == 32, "Two resting orders are meant to share a cache line.");
+	// New order types go last (see obOrderType.hpp), this is where they run out of flag bits.
+	static_assert(static_cast<unsigned>(OrderType::GoodTillTime) <= 0b111, "The order type no longer fits RestingOrder's flag bits.");
+
+	class OrderDetails : public OwnerHook
+	{
+	public:
+		explicit OrderDetails(const Order& order)
+			: expiry_{ order.GetExpiry() }
+			, initialQuantity_{ order.GetInitialQuantity() }
+			, owner_{ order.GetOwner() }
+		{ }
+
+		Quantity GetInitialQuantity() const { return initialQuantity_; }
+		OwnerId GetOwner() const { return owner_; }
+		Timestamp GetExpiry() const { return expiry_; }
+
+		/* A reduced order keeps its place in the queue, and the quantity taken off doesn't count as filled: the initial quantity shrinks by as much.
+		*  Only ever downwards, an order that grows has to go to the back of its queue, i.e. be cancelled and added again. */
+		void Reduce(Quantity by) { initialQuantity_ -= by; }
+
+	private:
+		Timestamp expiry_;
+		Quantity initialQuantity_;
+		OwnerId owner_;
+	};
+}
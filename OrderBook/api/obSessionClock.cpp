@@ -0,0 +1,31 @@
+#include "api/obSessionClock.hpp"
+
+// lib
+#include <ctime>
+
+namespace ob
+{
+	Timestamp NextSessionClose(Timestamp now, std::chrono::minutes close)
+	{
+		using namespace std::chrono;
+
+		// converts time_point value to std::time_t
+		const auto now_c = system_clock::to_time_t(now);
+		std::tm now_parts{};
+		// converts the time_t value now_c into a calendar time and stores it in now_parts.
+#ifdef _WIN32
+		localtime_s(&now_parts, &now_c);
+#else
+		localtime_r(&now_c, &now_parts);
+#endif
+
+		if (now_parts.tm_hour * 60 + now_parts.tm_min >= close.count()) // close.count() returns number of ticks (minutes) for duration 'close'
+			now_parts.tm_mday += 1;
+
+		now_parts.tm_hour = static_cast<int>(close.count() / 60);
+		now_parts.tm_min = static_cast<int>(close.count() % 60);
+		now_parts.tm_sec = 0;
+
+		return system_clock::from_time_t(mktime(&now_parts));
+	}
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "api/obAliases.hpp"
+
+//lib
+#include <chrono>
+#include <cstdint>
+
+namespace ob
+{
+	/* Next time (local time) the trading session closes, strictly after 'now'. 'close' is the time of day, e.g. 16h or 16h + 30min.
+	*  GoodForDay orders expire at that moment. */
+	Timestamp NextSessionClose(Timestamp now, std::chrono::minutes close = std::chrono::hours(16));
+
+	// Timestamps as they are stored in journals, snapshots and flow files: nanoseconds since the epoch, whatever the clock's own resolution.
+	inline std::int64_t ToEpochNanoseconds(Timestamp time)
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+	}
+
+	inline Timestamp FromEpochNanoseconds(std::int64_t nanoseconds)
+	{
+		return Timestamp{ std::chrono::duration_cast<Timestamp::duration>(std::chrono::nanoseconds{ nanoseconds }) };
+	}
+}
@@ -1,8 +1,11 @@
 #pragma once
 
+//lib
+#include <cstdint>
+
 namespace ob
 {
-	enum class Side
+	enum class Side : std::uint8_t
 	{
 		Buy,
 		Sell
@@ -0,0 +1,162 @@
+#include "api/obSnapshot.hpp"
+
+// lib
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <format>
+
+namespace ob
+{
+	namespace
+	{
+		// Adds 'price' to the sorted 'prices', returns false if it was there already.
+		bool Insert(std::vector<Price>& prices, Price price)
+		{
+			const auto it = std::ranges::lower_bound(prices, price);
+			if (it != prices.end() and *it == price)
+				return false;
+
+			prices.insert(it, price);
+			return true;
+		}
+	}
+
+	void WriteSnapshot(const std::filesystem::path& path, std::span<const std::byte> image)
+	{
+		std::filesystem::path temporary{ path };
+		temporary += ".tmp";
+		std::filesystem::remove(temporary);
+
+		{
+			MappedFile file{ temporary, MappedFile::Mode::ReadWrite, image.size() };
+			std::memcpy(file.Data(), image.data(), image.size());
+			file.Flush(0, image.size());
+		}
+
+		std::filesystem::rename(temporary, path);
+	}
+
+	MappedFile OpenSnapshot(const std::filesystem::path& path)
+	{
+		MappedFile file{ path, MappedFile::Mode::ReadOnly };
+
+		SnapshotHeader header{};
+		if (file.Size() >= sizeof(header))
+			std::memcpy(&header, file.Data(), sizeof(header));
+
+		if (header.magic_ != SnapshotHeader::Magic or header.version_ != SnapshotHeader::CurrentVersion or header.headerSize_ != sizeof(SnapshotHeader))
+			throw std::runtime_error(std::format("({}) is not a snapshot this version can read.", path.string()));
+
+		const std::uint64_t expected = sizeof(SnapshotHeader) + (header.bidLevels_ + header.askLevels_) * sizeof(SnapshotLevel) + header.orders_ * sizeof(SnapshotOrder);
+		if (file.Size() != expected)
+			throw std::runtime_error(std::format("Snapshot ({}) is truncated.", path.string()));
+
+		return file;
+	}
+
+	void SnapshotCapture::Begin(std::uint64_t journalSequence, std::size_t orders, std::size_t bidLevels, std::size_t askLevels)
+	{
+		states_ = {};
+		GetState(Side::Buy).copied_.reserve(bidLevels);
+		GetState(Side::Buy).preserved_.reserve(bidLevels);
+		GetState(Side::Sell).copied_.reserve(askLevels);
+		GetState(Side::Sell).preserved_.reserve(askLevels);
+		// Every level there is now, and as many new prices again (a few at least), before a claim has to reallocate.
+		GetState(Side::Buy).claimed_.reserve(2 * bidLevels + 16);
+		GetState(Side::Sell).claimed_.reserve(2 * askLevels + 16);
+
+		// Not initialized, the pages are only touched as the orders are copied into them.
+		storage_ = std::make_unique_for_overwrite<std::byte[]>(orders * sizeof(SnapshotOrder));
+		orders_ = reinterpret_cast<SnapshotOrder*>(storage_.get());
+		capacity_ = orders;
+		copiedEnd_ = 0;
+		preservedBegin_ = orders;
+		journalSequence_ = journalSequence;
+		active_ = true;
+	}
+
+	bool SnapshotCapture::Claim(Side side, Price price)
+	{
+		State& state = GetState(side);
+		if (state.resume_ and price == *state.cursor_)
+		{
+			// Halfway through it, the orders copied so far go back and the level is preserved whole.
+			copiedEnd_ = state.copied_.back().firstOrder_;
+			state.copied_.pop_back();
+			state.resume_ = nullptr;
+			return Insert(state.claimed_, price);
+		}
+
+		// Everything the walk went past is in the image already, as it was then, or wasn't there when it did.
+		if (state.finished_ or (state.cursor_ and (side == Side::Buy ? price >= *state.cursor_ : price <= *state.cursor_)))
+			return false;
+
+		return Insert(state.claimed_, price);
+	}
+
+	std::span<SnapshotOrder> SnapshotCapture::AddPreserved(Side side, const SnapshotLevel& level)
+	{
+		preservedBegin_ -= level.orders_;
+		GetState(side).preserved_.push_back(Level{ level, preservedBegin_ });
+		return { orders_ + preservedBegin_, level.orders_ };
+	}
+
+	void SnapshotCapture::AddCopied(Side side, const SnapshotLevel& level)
+	{
+		GetState(side).copied_.push_back(Level{ level, copiedEnd_ });
+	}
+
+	std::vector<std::byte> SnapshotCapture::TakeImage()
+	{
+		SnapshotHeader header{};
+		header.bidLevels_ = GetState(Side::Buy).copied_.size() + GetState(Side::Buy).preserved_.size();
+		header.askLevels_ = GetState(Side::Sell).copied_.size() + GetState(Side::Sell).preserved_.size();
+		header.orders_ = copiedEnd_ + (capacity_ - preservedBegin_);
+		header.journalSequence_ = journalSequence_;
+
+		std::vector<std::byte> image(sizeof(SnapshotHeader) + (header.bidLevels_ + header.askLevels_) * sizeof(SnapshotLevel) + header.orders_ * sizeof(SnapshotOrder));
+		std::memcpy(image.data(), &header, sizeof(header));
+		std::byte* out = WriteSide(Side::Buy, image.data() + sizeof(header));
+		WriteSide(Side::Sell, out);
+
+		states_ = {};
+		storage_.reset();
+		orders_ = nullptr;
+		return image;
+	}
+
+	std::byte* SnapshotCapture::WriteSide(Side side, std::byte* out)
+	{
+		const auto better = [side](const Level& lhs, const Level& rhs)
+			{
+				return side == Side::Buy ? lhs.level_.price_ > rhs.level_.price_ : lhs.level_.price_ < rhs.level_.price_;
+			};
+
+		State& state = GetState(side);
+		std::sort(state.preserved_.begin(), state.preserved_.end(), better);
+
+		const auto write = [this, &out](const Level& level)
+			{
+				std::memcpy(out, &level.level_, sizeof(level.level_));
+				out += sizeof(level.level_);
+
+				const std::size_t bytes = level.level_.orders_ * sizeof(SnapshotOrder);
+				std::memcpy(out, orders_ + level.firstOrder_, bytes);
+				out += bytes;
+			};
+
+		// Both in price order now, and no price is in both.
+		auto copied = state.copied_.begin();
+		auto preserved = state.preserved_.begin();
+		while (copied != state.copied_.end() or preserved != state.preserved_.end())
+		{
+			if (preserved == state.preserved_.end() or (copied != state.copied_.end() and better(*copied, *preserved)))
+				write(*copied++);
+			else
+				write(*preserved++);
+		}
+
+		return out;
+	}
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "api/obAliases.hpp"
+#include "api/obMappedFile.hpp"
+#include "api/obSide.hpp"
+#include "api/obRestingOrder.hpp"
+
+//lib
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace ob
+{
+	/* On-disk layout of an OrderBook snapshot (see OrderBook::SaveSnapshot).
+	*  A SnapshotHeader, then every bid level best first, then every ask level best first.
+	*  Each level is a SnapshotLevel followed by its orders_ SnapshotOrders in time priority.
+	*  Everything is little-endian and 8 byte aligned, so a mapped file is read in place with no parsing pass.
+	*/
+	static_assert(std::endian::native == std::endian::little, "Snapshots are written as raw little-endian structs.");
+
+	struct SnapshotHeader
+	{
+		static constexpr std::uint64_t Magic = 0x50414e53424f; // "OBSNAP"
+		static constexpr std::uint32_t CurrentVersion = 3; // 2: orders carry their expiry. 3: and their owner
+
+		std::uint64_t magic_{ Magic };
+		std::uint32_t version_{ CurrentVersion };
+		std::uint32_t headerSize_{ sizeof(SnapshotHeader) };
+		std::uint64_t bidLevels_{};
+		std::uint64_t askLevels_{};
+		std::uint64_t orders_{};
+		// Journal sequence of the first command not reflected in the snapshot, replay the journal from there. Zero without a journal.
+		std::uint64_t journalSequence_{};
+		std::uint64_t reserved_[2]{};
+	};
+
+	struct SnapshotLevel
+	{
+		std::int32_t price_{};
+		std::uint32_t orders_{};
+		std::uint64_t quantity_{};
+	};
+
+	struct SnapshotOrder
+	{
+		std::uint64_t orderId_{};
+		std::int32_t price_{};
+		std::uint32_t initialQuantity_{};
+		std::uint32_t remainingQuantity_{};
+		std::uint32_t owner_{};
+		std::uint8_t orderType_{};
+		std::uint8_t side_{};
+		std::uint8_t reserved_[6]{};
+		// Nanoseconds since the epoch, zero for orders that don't expire.
+		std::int64_t expiry_{};
+	};
+
+	static_assert(sizeof(SnapshotHeader) == 64 and sizeof(SnapshotLevel) == 16 and sizeof(SnapshotOrder) == 40);
+
+	// Writes a complete snapshot image to 'path' through a temporary file, so a crash never leaves a half written snapshot behind.
+	void WriteSnapshot(const std::filesystem::path& path, std::span<const std::byte> image);
+	// Maps a snapshot read-only and checks its header, throws std::runtime_error if it isn't one this version can read.
+	MappedFile OpenSnapshot(const std::filesystem::path& path);
+
+	/* A snapshot being taken while the book keeps matching (see OrderBook::SaveSnapshot), guarded by the book's lock.
+	*  The book walks each side from the best level to the worst a chunk at a time, copying levels, and matches in between.
+	*  The image still shows the book as it was when the capture began, copy on write one level at a time:
+	*  a level ahead of the walk that is about to change is claimed and preserved as it still is, and the walk skips its price when it gets there.
+	*  Either way an order is recorded at most once, so one buffer sized for the orders resting at Begin holds them all, and nothing reallocates under the lock:
+	*  copied levels fill it from the front, preserved levels from the back. The same goes for the levels, and for the claimed prices,
+	*  unless more new prices get claimed during one capture than each side had levels at Begin.
+	*/
+	class SnapshotCapture
+	{
+	public:
+		bool IsActive() const { return active_; }
+		// Allocates (without touching) room for 'orders' orders, and for the levels each side has, twice over for the claimed prices.
+		void Begin(std::uint64_t journalSequence, std::size_t orders, std::size_t bidLevels, std::size_t askLevels);
+		void End() { active_ = false; }
+
+		/* Before the level at 'price' changes. Returns true when the walk is still to reach it (or is halfway through it) and it hasn't been claimed yet,
+		*  the caller then preserves it with AddPreserved (unless it is empty, i.e. created since the capture began). */
+		bool Claim(Side side, Price price);
+		bool IsClaimed(Side side, Price price) const { return std::ranges::binary_search(GetState(side).claimed_, price); }
+		// Room for the orders of a preserved level, to be filled in time priority.
+		std::span<SnapshotOrder> AddPreserved(Side side, const SnapshotLevel& level);
+
+		// The walk's position on 'side': the last price it visited, empty before the first.
+		std::optional<Price> GetCursor(Side side) const { return GetState(side).cursor_; }
+		void Advance(Side side, Price price) { GetState(side).cursor_ = price; }
+		/* Where the walk stopped in the middle of the level at the cursor, when a chunk ran out there. Null otherwise.
+		*  The level can't have changed since: Claim drops the half copied level and it gets preserved whole instead. */
+		const RestingOrder* GetResume(Side side) const { return GetState(side).resume_; }
+		void SetResume(Side side, const RestingOrder* order) { GetState(side).resume_ = order; }
+		bool IsFinished(Side side) const { return GetState(side).finished_; }
+		void Finish(Side side) { GetState(side).finished_ = true; }
+		// The walk copies a level by adding it, then each of its orders (possibly over several chunks).
+		void AddCopied(Side side, const SnapshotLevel& level);
+		SnapshotOrder& AddCopiedOrder() { return orders_[copiedEnd_++]; }
+
+		/* Once the capture has ended, without the book's lock: the snapshot image (see the layout above),
+		*  both kinds of levels merged back into price order. Leaves the capture empty. */
+		std::vector<std::byte> TakeImage();
+
+	private:
+		struct Level
+		{
+			SnapshotLevel level_;
+			// Index of its first order in orders_.
+			std::size_t firstOrder_;
+		};
+
+		struct State
+		{
+			// In price order.
+			std::vector<Level> copied_{};
+			// In the order they changed in.
+			std::vector<Level> preserved_{};
+			// Sorted: a claim is a binary search and an insert into room reserved at Begin, not a hash node allocated under the lock.
+			std::vector<Price> claimed_{};
+			std::optional<Price> cursor_{};
+			const RestingOrder* resume_{ nullptr };
+			bool finished_{ false };
+		};
+
+		std::array<State, 2> states_{};
+		// Raw bytes: SnapshotOrder's member initializers would have every order zeroed first, on the matching thread's time.
+		std::unique_ptr<std::byte[]> storage_{};
+		SnapshotOrder* orders_{ nullptr };
+		// Copied orders are [0, copiedEnd_), preserved ones [preservedBegin_, capacity_).
+		std::size_t capacity_{ 0 };
+		std::size_t copiedEnd_{ 0 };
+		std::size_t preservedBegin_{ 0 };
+		std::uint64_t journalSequence_{};
+		bool active_{ false };
+
+		State& GetState(Side side) { return states_[side == Side::Buy ? 0 : 1]; }
+		const State& GetState(Side side) const { return states_[side == Side::Buy ? 0 : 1]; }
+		// Appends one side's levels, best first, to 'out'.
+		std::byte* WriteSide(Side side, std::byte* out);
+	};
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+//lib
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace ob
+{
+	/* Bounded, lock-free ring buffer for exactly one producer thread and one consumer thread.
+	*  The capacity is rounded up to a power of two and allocated once, pushing and popping never allocate.
+	*  head_ is only written by the consumer and tail_ only by the producer, each on its own cache line so the two threads don't keep stealing it from each other.
+	*/
+	template <typename T>
+	class SpscRing
+	{
+	public:
+		explicit SpscRing(std::size_t capacity)
+			: buffer_(std::bit_ceil(capacity < 2 ? std::size_t{ 2 } : capacity))
+			, mask_{ buffer_.size() - 1 }
+		{ }
+
+		SpscRing(const SpscRing&) = delete;
+		SpscRing& operator=(const SpscRing&) = delete;
+
+		std::size_t Capacity() const { return buffer_.size(); }
+
+		// Producer side. Returns false if the ring is full.
+		bool TryPush(const T& item)
+		{
+			const std::size_t tail = tail_.load(std::memory_order_relaxed);
+			if (tail - cachedHead_ == buffer_.size())
+			{
+				cachedHead_ = head_.load(std::memory_order_acquire);
+				if (tail - cachedHead_ == buffer_.size())
+					return false;
+			}
+
+			buffer_[tail & mask_] = item;
+			tail_.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Consumer side. Returns false if the ring is empty.
+		bool TryPop(T& item)
+		{
+			return PopBatch({ &item, 1 }) == 1;
+		}
+
+		// Consumer side. Pops up to items.size() items in one go and returns how many were popped.
+		std::size_t PopBatch(std::span<T> items)
+		{
+			const std::size_t head = head_.load(std::memory_order_relaxed);
+			if (cachedTail_ - head < items.size())
+				cachedTail_ = tail_.load(std::memory_order_acquire);
+
+			std::size_t count = cachedTail_ - head;
+			if (count > items.size())
+				count = items.size();
+
+			for (std::size_t i = 0; i < count; ++i)
+				items[i] = buffer_[(head + i) & mask_];
+
+			head_.store(head + count, std::memory_order_release);
+			return count;
+		}
+
+		bool Empty() const { return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire); }
+
+	private:
+		static constexpr std::size_t CacheLine = 64;
+
+		std::vector<T> buffer_;
+		std::size_t mask_;
+
+		// consumer owned
+		alignas(CacheLine) std::atomic<std::size_t> head_{ 0 };
+		std::size_t cachedTail_{ 0 };
+
+		// producer owned
+		alignas(CacheLine) std::atomic<std::size_t> tail_{ 0 };
+		std::size_t cachedHead_{ 0 };
+	};
+}
@@ -0,0 +1,33 @@
+#include "api/obThreadAffinity.hpp"
+
+// lib
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace ob
+{
+	bool PinThread(std::thread& thread, int core)
+	{
+		if (core < 0)
+			return true;
+
+		if (static_cast<unsigned>(core) >= std::thread::hardware_concurrency())
+			return false;
+
+#ifdef _WIN32
+		const DWORD_PTR mask = DWORD_PTR{ 1 } << core;
+		return SetThreadAffinityMask(thread.native_handle(), mask) != 0;
+#else
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(core, &set);
+		return pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) == 0;
+#endif
+	}
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+//lib
+#include <thread>
+
+namespace ob
+{
+	/* Pins a thread to one CPU core so the scheduler never migrates it (and its warm caches) elsewhere.
+	*  Returns false if the core doesn't exist or the platform refused. A negative core leaves the thread alone and returns true.
+	*/
+	bool PinThread(std::thread& thread, int core);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "api/obLevelInfo.hpp"
+#include "api/obConstants.hpp"
+
+namespace ob
+{
+	/* Best bid and best ask with their aggregate quantity and order count.
+	*  An empty side has a quantity_ (and count_) of zero. */
+	struct TopOfBook
+	{
+		LevelInfo bid_{ Constants::InvalidPrice, 0, 0 };
+		LevelInfo ask_{ Constants::InvalidPrice, 0, 0 };
+
+		bool HasBid() const { return bid_.count_ != 0; }
+		bool HasAsk() const { return ask_.count_ != 0; }
+	};
+}
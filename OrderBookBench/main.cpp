@@ -0,0 +1,276 @@
+#include "api/obOrderBook.hpp"
+#include "api/obOrderFlow.hpp"
+#include "api/obLatencyHistogram.hpp"
+
+// lib
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/* Benchmarks the public OrderBook calls against synthetic flows (see OrderFlowGenerator) at several book depths.
+*  For every depth the book is first filled with passive orders, then a pre-generated flow is run through it one call at a time,
+*  each call timed on its own. Prints throughput and latency percentiles per operation, in nanoseconds.
+*
+*  OrderBookBench [--depths 1000,100000,1000000,10000000] [--ops 1000000] [--storage map|ladder] [--seed 1]
+*                 [--cancel-ratio 0.45] [--modify-ratio 0.05] [--market-ratio 0.01] [--fak-ratio 0.02] [--fok-ratio 0.02] [--aggressive-ratio 0.1]
+*                 [--arena-mb 0] [--numa-node -1] [--owners 0] [--stp none|newest|oldest|both|decrement]
+*
+*  --arena-mb puts the book on a MemoryArena of that many megabytes (huge pages, prefaulted), --numa-node binds it to a node.
+*  --owners spreads the orders over that many owners, --stp picks the book's self-trade prevention (compare against none for its cost).
+*/
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	struct BenchOptions
+	{
+		std::vector<std::size_t> depths_{ 1'000, 100'000, 1'000'000, 10'000'000 };
+		std::size_t operations_{ 1'000'000 };
+		std::size_t depthQueries_{ 1'000 };
+		ob::LevelStorage levelStorage_{ ob::LevelStorage::Map };
+		ob::ArenaOptions arena_{};
+		ob::SelfTradePrevention selfTradePrevention_{ ob::SelfTradePrevention::None };
+		ob::OrderFlowOptions flow_{};
+	};
+
+	// One row of the report per kind of call, adds are split by order type since they take quite different paths.
+	enum Operation
+	{
+		AddGoodTillCancel,
+		AddGoodForDay,
+		AddFillAndKill,
+		AddFillOrKill,
+		AddMarket,
+		Cancel,
+		Modify,
+		GetOrderInfos,
+		OperationCount
+	};
+
+	constexpr std::array<std::string_view, OperationCount> OperationNames
+	{
+		"AddOrder GoodTillCancel", "AddOrder GoodForDay", "AddOrder FillAndKill", "AddOrder FillOrKill", "AddOrder Market",
+		"CancelOrder", "MatchOrder", "GetOrderInfos"
+	};
+
+	Operation GetOperation(const ob::Command& command)
+	{
+		switch (command.type_)
+		{
+		case ob::CommandType::Cancel:
+			return Cancel;
+		case ob::CommandType::Modify:
+			return Modify;
+		default:
+			break;
+		}
+
+		switch (command.orderType_)
+		{
+		case ob::OrderType::GoodForDay:
+			return AddGoodForDay;
+		case ob::OrderType::FillAndKill:
+			return AddFillAndKill;
+		case ob::OrderType::FillOrKill:
+			return AddFillOrKill;
+		case ob::OrderType::Market:
+			return AddMarket;
+		default:
+			return AddGoodTillCancel;
+		}
+	}
+
+	std::vector<std::size_t> ParseList(std::string_view text)
+	{
+		std::vector<std::size_t> values;
+		while (!text.empty())
+		{
+			const auto comma = text.find(',');
+			values.push_back(std::stoull(std::string{ text.substr(0, comma) }));
+			text = comma == std::string_view::npos ? std::string_view{} : text.substr(comma + 1);
+		}
+		return values;
+	}
+
+	ob::SelfTradePrevention ParseSelfTradePrevention(std::string_view text)
+	{
+		if (text == "newest")
+			return ob::SelfTradePrevention::CancelNewest;
+		if (text == "oldest")
+			return ob::SelfTradePrevention::CancelOldest;
+		if (text == "both")
+			return ob::SelfTradePrevention::CancelBoth;
+		if (text == "decrement")
+			return ob::SelfTradePrevention::DecrementAndCancel;
+		if (text == "none")
+			return ob::SelfTradePrevention::None;
+		throw std::runtime_error(std::format("unknown self-trade prevention {}", std::string{ text }));
+	}
+
+	ob::LevelStorage ParseLevelStorage(std::string_view text)
+	{
+		if (text == "map")
+			return ob::LevelStorage::Map;
+		if (text == "ladder")
+			return ob::LevelStorage::Ladder;
+		throw std::runtime_error(std::format("unknown storage {}", std::string{ text }));
+	}
+
+	BenchOptions ParseOptions(int argc, char** argv)
+	{
+		BenchOptions options{};
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string_view name{ argv[i] };
+			if (i + 1 >= argc)
+				throw std::runtime_error(std::format("{} needs a value", std::string{ name }));
+			const std::string value{ argv[++i] };
+
+			if (name == "--depths")
+				options.depths_ = ParseList(value);
+			else if (name == "--ops")
+				options.operations_ = std::stoull(value);
+			else if (name == "--storage")
+				options.levelStorage_ = ParseLevelStorage(value);
+			else if (name == "--arena-mb")
+				options.arena_.size_ = std::stoull(value) << 20;
+			else if (name == "--numa-node")
+				options.arena_.numaNode_ = std::stoi(value);
+			else if (name == "--owners")
+				options.flow_.owners_ = static_cast<ob::OwnerId>(std::stoul(value));
+			else if (name == "--stp")
+				options.selfTradePrevention_ = ParseSelfTradePrevention(value);
+			else if (name == "--seed")
+				options.flow_.seed_ = std::stoull(value);
+			else if (name == "--cancel-ratio")
+				options.flow_.cancelRatio_ = std::stod(value);
+			else if (name == "--modify-ratio")
+				options.flow_.modifyRatio_ = std::stod(value);
+			else if (name == "--market-ratio")
+				options.flow_.marketRatio_ = std::stod(value);
+			else if (name == "--fak-ratio")
+				options.flow_.fillAndKillRatio_ = std::stod(value);
+			else if (name == "--fok-ratio")
+				options.flow_.fillOrKillRatio_ = std::stod(value);
+			else if (name == "--aggressive-ratio")
+				options.flow_.aggressiveRatio_ = std::stod(value);
+			else
+				throw std::runtime_error(std::format("unknown option {}", std::string{ name }));
+		}
+		return options;
+	}
+
+	std::uint64_t Nanoseconds(Clock::time_point start, Clock::time_point end)
+	{
+		return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+	}
+
+	void RunDepth(const BenchOptions& options, std::size_t depth)
+	{
+		ob::OrderBookOptions bookOptions{};
+		bookOptions.levelStorage_ = options.levelStorage_;
+		bookOptions.basePrice_ = options.flow_.midPrice_;
+		bookOptions.tickSize_ = options.flow_.tickSize_;
+		bookOptions.ladderLevels_ = 2 * static_cast<std::size_t>(options.flow_.maxTicksFromMid_) + 2;
+		bookOptions.orderCapacity_ = depth + options.operations_ / 2;
+		bookOptions.arena_ = options.arena_;
+		bookOptions.selfTradePrevention_ = options.selfTradePrevention_;
+		ob::OrderBook book{ bookOptions };
+
+		// Every command is generated up front, so the generator's own cost stays out of the measurements.
+		ob::OrderFlowGenerator generator{ options.flow_ };
+		std::vector<ob::Command> prefill(depth);
+		for (auto& command : prefill)
+			command = generator.NextPassive();
+
+		std::vector<ob::Command> flow(options.operations_);
+		for (auto& command : flow)
+			command = generator.Next();
+
+		ob::Trades trades{};
+		const auto prefillStart = Clock::now();
+		book.Apply(prefill, trades);
+		const auto prefillTime = Nanoseconds(prefillStart, Clock::now());
+
+		std::array<ob::LatencyHistogram, OperationCount> histograms{};
+		std::size_t tradeCount = 0;
+
+		const auto flowStart = Clock::now();
+		for (const auto& command : flow)
+		{
+			const auto start = Clock::now();
+			switch (command.type_)
+			{
+			case ob::CommandType::Add:
+				book.AddOrder(command.ToOrder(), trades);
+				break;
+			case ob::CommandType::Cancel:
+				book.CancelOrder(command.orderId_);
+				break;
+			case ob::CommandType::Modify:
+				book.MatchOrder(command.ToOrderModify(), trades);
+				break;
+			default:
+				book.Apply(command, trades);
+				break;
+			}
+			histograms[GetOperation(command)].Record(Nanoseconds(start, Clock::now()));
+
+			if (command.type_ != ob::CommandType::Cancel)
+				tradeCount += trades.size();
+		}
+		const auto flowTime = Nanoseconds(flowStart, Clock::now());
+		const auto memory = book.GetMemoryStats();
+
+		for (std::size_t i = 0; i < options.depthQueries_; ++i)
+		{
+			const auto start = Clock::now();
+			const auto infos = book.GetOrderInfos();
+			histograms[GetOrderInfos].Record(Nanoseconds(start, Clock::now()));
+		}
+
+		const auto perSecond = [](std::size_t count, std::uint64_t nanoseconds) { return nanoseconds ? static_cast<double>(count) * 1e9 / static_cast<double>(nanoseconds) : 0.0; };
+
+		std::cout << std::format("\ndepth {} ({} storage): prefill {:.0f} orders/s, flow {:.0f} msgs/s over {} msgs, {} trades, {} orders left\n",
+			depth, options.levelStorage_ == ob::LevelStorage::Ladder ? "ladder" : "map",
+			perSecond(depth, prefillTime), perSecond(flow.size(), flowTime), flow.size(), tradeCount, book.Size());
+		if (memory.chunks_ != 0)
+			std::cout << std::format("arena: {} MB mapped in {} chunk(s), {} MB on huge pages, {} MB used, {}\n", memory.reserved_ >> 20, memory.chunks_,
+				memory.hugePageBytes_ >> 20, memory.used_ >> 20, memory.numaBound_ ? "NUMA bound" : "not NUMA bound");
+		std::cout << std::format("{:<24}{:>10}{:>10}{:>10}{:>10}{:>10}{:>12}\n", "operation (ns)", "count", "mean", "p50", "p99", "p99.9", "max");
+
+		for (std::size_t i = 0; i < OperationCount; ++i)
+		{
+			const auto& histogram = histograms[i];
+			if (histogram.GetCount() == 0)
+				continue;
+
+			std::cout << std::format("{:<24}{:>10}{:>10.0f}{:>10}{:>10}{:>10}{:>12}\n", OperationNames[i], histogram.GetCount(), histogram.GetMean(),
+				histogram.GetPercentile(50.0), histogram.GetPercentile(99.0), histogram.GetPercentile(99.9), histogram.GetMax());
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		const BenchOptions options = ParseOptions(argc, argv);
+
+		for (const auto depth : options.depths_)
+			RunDepth(options, depth);
+
+		return 0;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 2;
+	}
+}
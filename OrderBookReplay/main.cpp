@@ -0,0 +1,262 @@
+#include "api/obOrderBook.hpp"
+#include "api/obOrderFlow.hpp"
+#include "api/obOrderFlowFile.hpp"
+#include "api/obLatencyHistogram.hpp"
+
+// lib
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <format>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/* Replays order-flow files (see obOrderFlowFile.hpp) through an OrderBook, or generates them.
+*
+*  OrderBookReplay generate <flow.csv|flow.bin> [--messages 1000000] [--prefill 10000] [--rate 1000000] [--seed 1]
+*                           [--cancel-ratio 0.45] [--modify-ratio 0.05] [--market-ratio 0.01] [--fak-ratio 0.02] [--fok-ratio 0.02] [--aggressive-ratio 0.1]
+*      Writes a seeded flow, the same arguments always write the same file. Prefill messages are passive adds, the rest follow the given mix,
+*      and timestamps are Poisson arrivals at --rate messages per second.
+*
+*  OrderBookReplay replay <flow.csv|flow.bin> [--paced] [--storage map|ladder] [--report-every 100000] [--expect book.snap] [--save book.snap]
+*      Feeds the flow to a book, as fast as possible or, with --paced, at the flow's own timestamps.
+*      Prints book size and trade rate every --report-every messages, then per-message latency percentiles (ns).
+*      When pacing, latency is measured from when the message was due, so time spent behind schedule counts too.
+*      --save writes the final book as a snapshot, --expect compares the final GetOrderInfos() against one and fails if they differ.
+*/
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	struct ToolOptions
+	{
+		std::string mode_{};
+		std::string flowPath_{};
+
+		std::size_t messages_{ 1'000'000 };
+		std::size_t prefill_{ 10'000 };
+		double rate_{ 1'000'000.0 };
+		ob::OrderFlowOptions flow_{};
+
+		bool paced_{ false };
+		ob::LevelStorage levelStorage_{ ob::LevelStorage::Map };
+		std::size_t reportEvery_{ 100'000 };
+		std::string expectPath_{};
+		std::string savePath_{};
+	};
+
+	ToolOptions ParseOptions(int argc, char** argv)
+	{
+		ToolOptions options{};
+		if (argc < 3)
+			throw std::runtime_error("usage: OrderBookReplay generate|replay <flow file> [options]");
+
+		options.mode_ = argv[1];
+		options.flowPath_ = argv[2];
+
+		for (int i = 3; i < argc; ++i)
+		{
+			const std::string_view name{ argv[i] };
+			if (name == "--paced")
+			{
+				options.paced_ = true;
+				continue;
+			}
+
+			if (i + 1 >= argc)
+				throw std::runtime_error(std::format("{} needs a value", std::string{ name }));
+			const std::string value{ argv[++i] };
+
+			if (name == "--messages")
+				options.messages_ = std::stoull(value);
+			else if (name == "--prefill")
+				options.prefill_ = std::stoull(value);
+			else if (name == "--rate")
+				options.rate_ = std::stod(value);
+			else if (name == "--seed")
+				options.flow_.seed_ = std::stoull(value);
+			else if (name == "--cancel-ratio")
+				options.flow_.cancelRatio_ = std::stod(value);
+			else if (name == "--modify-ratio")
+				options.flow_.modifyRatio_ = std::stod(value);
+			else if (name == "--market-ratio")
+				options.flow_.marketRatio_ = std::stod(value);
+			else if (name == "--fak-ratio")
+				options.flow_.fillAndKillRatio_ = std::stod(value);
+			else if (name == "--fok-ratio")
+				options.flow_.fillOrKillRatio_ = std::stod(value);
+			else if (name == "--aggressive-ratio")
+				options.flow_.aggressiveRatio_ = std::stod(value);
+			else if (name == "--storage")
+				options.levelStorage_ = value == "ladder" ? ob::LevelStorage::Ladder : ob::LevelStorage::Map;
+			else if (name == "--report-every")
+				options.reportEvery_ = std::stoull(value);
+			else if (name == "--expect")
+				options.expectPath_ = value;
+			else if (name == "--save")
+				options.savePath_ = value;
+			else
+				throw std::runtime_error(std::format("unknown option {}", std::string{ name }));
+		}
+
+		return options;
+	}
+
+	int Generate(const ToolOptions& options)
+	{
+		ob::OrderFlowGenerator generator{ options.flow_ };
+		/* Its own stream, so the arrival times don't shift the commands when the rate changes, and seeded apart from the generator's:
+		*  the same seed would draw the gaps from the very numbers that pick the commands. */
+		std::mt19937_64 random{ options.flow_.seed_ ^ 0x9E3779B97F4A7C15ull };
+		std::exponential_distribution<double> gap{ options.rate_ > 0.0 ? options.rate_ / 1e9 : 1e-3 };
+
+		std::vector<ob::FlowMessage> messages(options.prefill_ + options.messages_);
+		double timestamp = 0.0;
+		for (std::size_t i = 0; i < messages.size(); ++i)
+		{
+			timestamp += gap(random);
+			messages[i].timestamp_ = static_cast<std::uint64_t>(timestamp);
+			messages[i].command_ = i < options.prefill_ ? generator.NextPassive() : generator.Next();
+		}
+
+		ob::WriteOrderFlow(options.flowPath_, messages);
+		std::cout << std::format("wrote {} messages to {}\n", messages.size(), options.flowPath_);
+		return 0;
+	}
+
+	bool SameLevels(std::string_view side, const ob::LevelInfos& actual, const ob::LevelInfos& expected)
+	{
+		if (actual.size() != expected.size())
+		{
+			std::cout << std::format("{}: {} levels, expected {}\n", side, actual.size(), expected.size());
+			return false;
+		}
+
+		for (std::size_t i = 0; i < actual.size(); ++i)
+		{
+			if (actual[i].price_ != expected[i].price_ or actual[i].quantity_ != expected[i].quantity_ or actual[i].count_ != expected[i].count_)
+			{
+				std::cout << std::format("{} level {}: {} x {} ({} orders), expected {} x {} ({} orders)\n", side, i,
+					actual[i].price_, actual[i].quantity_, actual[i].count_, expected[i].price_, expected[i].quantity_, expected[i].count_);
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	int Replay(const ToolOptions& options)
+	{
+		const auto loadStart = Clock::now();
+		const std::vector<ob::FlowMessage> messages = ob::ReadOrderFlow(options.flowPath_);
+		const auto loadTime = std::chrono::duration<double>(Clock::now() - loadStart).count();
+		std::cout << std::format("read {} messages in {:.3f}s\n", messages.size(), loadTime);
+
+		ob::OrderBookOptions bookOptions{};
+		bookOptions.levelStorage_ = options.levelStorage_;
+		/* Only this thread touches the book, and without a prune thread orders only expire through the Expire commands recorded in the flow,
+		*  not whenever the wall clock during the replay happens to pass their expiry. */
+		bookOptions.threading_ = ob::Threading::SingleWriter;
+		for (const auto& [timestamp, command] : messages)
+		{
+			// the ladder starts around the first priced order, it re-centers on its own if the flow moves away
+			if (command.type_ == ob::CommandType::Add and command.orderType_ != ob::OrderType::Market)
+			{
+				bookOptions.basePrice_ = command.price_;
+				break;
+			}
+		}
+
+		ob::OrderBook book{ bookOptions };
+		ob::Trades trades{};
+		ob::LatencyHistogram latency{};
+		std::size_t tradeCount = 0;
+		std::size_t intervalTrades = 0;
+
+		const auto start = Clock::now();
+		auto intervalStart = start;
+		const std::uint64_t firstTimestamp = messages.empty() ? 0 : messages.front().timestamp_;
+
+		for (std::size_t i = 0; i < messages.size(); ++i)
+		{
+			const auto& [timestamp, command] = messages[i];
+
+			auto due = Clock::now();
+			if (options.paced_)
+			{
+				due = start + std::chrono::nanoseconds(timestamp - firstTimestamp);
+				// sleep through long gaps, spin through the last stretch, the scheduler is far too coarse for that part
+				if (due - Clock::now() > std::chrono::milliseconds(2))
+					std::this_thread::sleep_until(due - std::chrono::milliseconds(1));
+				while (Clock::now() < due)
+					;
+			}
+
+			book.Apply(command, trades);
+			latency.Record(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - due).count()));
+			tradeCount += trades.size();
+			intervalTrades += trades.size();
+
+			if (options.reportEvery_ != 0 and (i + 1) % options.reportEvery_ == 0)
+			{
+				const auto now = Clock::now();
+				const double seconds = std::chrono::duration<double>(now - intervalStart).count();
+				std::cout << std::format("{:>12} msgs  book size {:>10}  trades {:>10}  {:>12.0f} trades/s\n",
+					i + 1, book.Size(), tradeCount, seconds > 0.0 ? intervalTrades / seconds : 0.0);
+				intervalStart = now;
+				intervalTrades = 0;
+			}
+		}
+
+		const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		std::cout << std::format("replayed {} messages in {:.3f}s: {:.0f} msgs/s, {} trades ({:.0f} trades/s), {} orders left\n",
+			messages.size(), seconds, seconds > 0.0 ? messages.size() / seconds : 0.0, tradeCount, seconds > 0.0 ? tradeCount / seconds : 0.0, book.Size());
+		std::cout << std::format("latency (ns): mean {:.0f}  p50 {}  p99 {}  p99.9 {}  p99.99 {}  max {}\n", latency.GetMean(),
+			latency.GetPercentile(50.0), latency.GetPercentile(99.0), latency.GetPercentile(99.9), latency.GetPercentile(99.99), latency.GetMax());
+
+		if (!options.savePath_.empty())
+		{
+			book.SaveSnapshot(options.savePath_);
+			std::cout << std::format("saved final book to {}\n", options.savePath_);
+		}
+
+		if (!options.expectPath_.empty())
+		{
+			ob::OrderBook expected{ bookOptions };
+			expected.LoadSnapshot(options.expectPath_);
+
+			const auto actualInfos = book.GetOrderInfos();
+			const auto expectedInfos = expected.GetOrderInfos();
+			const bool same = SameLevels("bids", actualInfos.GetBids(), expectedInfos.GetBids()) and SameLevels("asks", actualInfos.GetAsks(), expectedInfos.GetAsks());
+
+			std::cout << (same ? "final book matches the expected snapshot\n" : "final book DIFFERS from the expected snapshot\n");
+			return same ? 0 : 1;
+		}
+
+		return 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		const ToolOptions options = ParseOptions(argc, argv);
+
+		if (options.mode_ == "generate")
+			return Generate(options);
+		if (options.mode_ == "replay")
+			return Replay(options);
+
+		throw std::runtime_error(std::format("unknown mode {}", options.mode_));
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 2;
+	}
+}
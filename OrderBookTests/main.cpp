@@ -0,0 +1,64 @@
+#include "obTests.hpp"
+
+// lib
+#include <exception>
+#include <format>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+/* Tests of the order book and what is built around it, one suite per ob...Tests.cpp.
+*
+*  OrderBookTests [--ops 20000] [--seed 1]
+*      Runs every suite and prints one line per case. --ops and --seed set the length and the seed of the randomized flows,
+*      the directed cases don't depend on them.
+*      Exits with 1 if any case failed.
+*/
+namespace
+{
+	ob::tests::TestOptions ParseOptions(int argc, char** argv)
+	{
+		ob::tests::TestOptions options{};
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string_view name{ argv[i] };
+			if (i + 1 >= argc)
+				throw std::runtime_error(std::format("{} needs a value", std::string{ name }));
+
+			const std::string value{ argv[++i] };
+			if (name == "--ops")
+				options.ops_ = std::stoull(value);
+			else if (name == "--seed")
+				options.seed_ = std::stoull(value);
+			else
+				throw std::runtime_error(std::format("unknown option {}", std::string{ name }));
+		}
+		return options;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		const ob::tests::TestOptions options = ParseOptions(argc, argv);
+		ob::tests::TestReport report{};
+
+		ob::tests::RunMatchingTests(options, report);
+		ob::tests::RunJournalTests(options, report);
+		ob::tests::RunSnapshotTests(options, report);
+		ob::tests::RunPipelineTests(options, report);
+		ob::tests::RunEngineTests(options, report);
+		ob::tests::RunDepthTests(options, report);
+		ob::tests::RunStatsTests(options, report);
+
+		std::cout << (report.GetFailed() == 0 ? "all passed\n" : std::format("{} FAILED\n", report.GetFailed()));
+		return report.GetFailed() == 0 ? 0 : 1;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 2;
+	}
+}
@@ -0,0 +1,193 @@
+#include "obTests.hpp"
+#include "api/obDepthAnalytics.hpp"
+#include "api/obDepthView.hpp"
+
+// lib
+#include <atomic>
+#include <cstdint>
+#include <format>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* Depth: the aggregates of obDepthAnalytics.hpp, the AVX2 kernels against the scalar ones on the same levels.
+*  On a machine without AVX2 both runs are scalar, and the case only checks that they agree with themselves.
+*  And the DepthView seqlock, read by several threads while one publishes as fast as it can.
+*/
+namespace ob::tests
+{
+	namespace
+	{
+		// What one run of the aggregates gave for 'levels'.
+		struct Aggregates
+		{
+			std::vector<std::uint64_t> totals_{};
+			std::vector<std::uint64_t> within_{};
+			std::vector<Vwap> vwaps_{};
+		};
+
+		std::int64_t Notional(const LevelArrays& levels)
+		{
+			std::int64_t notional = 0;
+			for (std::size_t level = 0; level < levels.Size(); ++level)
+				notional += static_cast<std::int64_t>(levels.prices_[level]) * levels.quantities_[level];
+			return notional;
+		}
+
+		Aggregates Aggregate(const LevelArrays& levels, const std::vector<std::size_t>& depths, const std::vector<Price>& distances, const std::vector<std::uint64_t>& targets)
+		{
+			Aggregates aggregates;
+			for (const std::size_t depth : depths)
+				aggregates.totals_.push_back(GetTotalQuantity(levels, depth));
+			for (const Price distance : distances)
+				aggregates.within_.push_back(GetQuantityWithin(levels, distance));
+			for (const std::uint64_t target : targets)
+				aggregates.vwaps_.push_back(GetVwap(levels, target));
+			return aggregates;
+		}
+
+		/* Sides of every size up to a few blocks of 8 past a multiple of 8, bids and asks, prices either side of zero (the AVX2 notional biases them)
+		*  and quantities up to the top of their 32 bits (their sums are 64). The sweeps stop at every kind of place: nowhere, on a block's edge,
+		*  inside the last block or the tail after it, and past the end. */
+		std::string VectorMatchesScalar(const TestOptions& options)
+		{
+			std::mt19937_64 random{ options.seed_ };
+			const auto pick = [&random](std::uint64_t count) { return random() % count; };
+
+			for (std::size_t count = 0; count <= 67; ++count)
+			{
+				for (const Side side : { Side::Buy, Side::Sell })
+				{
+					LevelArrays levels;
+					Price price = static_cast<Price>(pick(2000)) - 1000;
+					for (std::size_t level = 0; level < count; ++level)
+					{
+						const Quantity quantity = pick(4) == 0 ? static_cast<Quantity>(UINT32_MAX - pick(1000)) : static_cast<Quantity>(1 + pick(1000));
+						levels.Append(price, quantity, static_cast<Quantity>(1 + pick(10)));
+						price += (side == Side::Buy ? -1 : 1) * static_cast<Price>(1 + pick(5));
+					}
+
+					std::vector<std::uint64_t> prefix{ 0 };
+					for (const Quantity quantity : levels.quantities_)
+						prefix.push_back(prefix.back() + quantity);
+
+					const std::vector<std::size_t> depths{ 0, 1, 7, 8, 9, count / 2, count, SIZE_MAX };
+					const std::vector<Price> distances{ -1, 0, 3, 17, static_cast<Price>(pick(400)), INT32_MAX / 2 };
+					std::vector<std::uint64_t> targets{ 0, 1, prefix.back() / 2, prefix.back(), prefix.back() + 1 };
+					for (std::size_t block = 8; block <= count; block += 8)
+					{
+						targets.push_back(prefix[block]);
+						targets.push_back(prefix[block] + 1);
+					}
+					if (count != 0)
+						targets.push_back(prefix[count - 1] + 1);
+
+					SetDepthAnalyticsVectorized(true);
+					const Aggregates vector = Aggregate(levels, depths, distances, targets);
+					SetDepthAnalyticsVectorized(false);
+					const Aggregates scalar = Aggregate(levels, depths, distances, targets);
+					SetDepthAnalyticsVectorized(true);
+
+					const std::string where = std::format("{} levels of {}", count, side == Side::Buy ? "bids" : "asks");
+					for (std::size_t i = 0; i < depths.size(); ++i)
+						if (vector.totals_[i] != scalar.totals_[i])
+							return std::format("{}: total of {} levels {}, scalar {}", where, depths[i], vector.totals_[i], scalar.totals_[i]);
+					for (std::size_t i = 0; i < distances.size(); ++i)
+						if (vector.within_[i] != scalar.within_[i])
+							return std::format("{}: quantity within {} {}, scalar {}", where, distances[i], vector.within_[i], scalar.within_[i]);
+					for (std::size_t i = 0; i < targets.size(); ++i)
+						if (vector.vwaps_[i].quantity_ != scalar.vwaps_[i].quantity_ or vector.vwaps_[i].notional_ != scalar.vwaps_[i].notional_)
+							return std::format("{}: sweep for {} took {} for {}, scalar {} for {}", where, targets[i],
+								vector.vwaps_[i].quantity_, vector.vwaps_[i].notional_, scalar.vwaps_[i].quantity_, scalar.vwaps_[i].notional_);
+
+					// And the whole side (the last depth, the fourth target) against a plain sum, so that agreeing can't mean both wrong the same way.
+					if (scalar.totals_.back() != prefix.back() or scalar.vwaps_[3].notional_ != Notional(levels))
+						return std::format("{}: whole side {} for {}, expected {} for {}", where, scalar.totals_.back(), scalar.vwaps_[3].notional_, prefix.back(), Notional(levels));
+				}
+			}
+
+			return {};
+		}
+
+		/* Every publication is all one number, its version: the order count, the market-data sequence, and every level's quantity and count,
+		*  with as many levels as the version says (up to the view's). A read that mixed two publications can't hold the same number everywhere.
+		*  Readers spin on Read while the writer publishes, and also check that the version they see never goes back. */
+		std::string ViewReadsAreConsistent(const TestOptions& options)
+		{
+			static constexpr std::size_t Levels = 16;
+			constexpr std::size_t Readers = 3;
+			const std::uint64_t publications = options.ops_ * 10;
+
+			DepthView view{ Levels };
+			std::atomic<bool> publishing{ true };
+			std::vector<std::string> differences(Readers);
+			std::vector<std::size_t> reads(Readers);
+
+			std::vector<std::thread> readers;
+			for (std::size_t reader = 0; reader < Readers; ++reader)
+				readers.emplace_back([&view, &publishing, &difference = differences[reader], &count = reads[reader]]()
+					{
+						std::vector<LevelInfo> bids(Levels);
+						std::vector<LevelInfo> asks(Levels);
+						std::uint64_t last = 0;
+
+						// one more read after the writer is done, so every reader sees at least one publication
+						for (bool more = true; more; ++count)
+						{
+							more = publishing.load(std::memory_order_acquire);
+							const DepthViewState state = view.Read(bids, asks);
+
+							const std::uint64_t version = state.version_;
+							if (version < last)
+								difference = std::format("read version {} after {}", version, last);
+							last = version;
+
+							const auto quantity = static_cast<Quantity>(version);
+							bool consistent = state.orders_ == version and state.marketDataSequence_ == version
+								and state.bidLevels_ == std::min<std::uint64_t>(version % (Levels + 1), Levels) and state.askLevels_ == state.bidLevels_;
+							for (std::size_t level = 0; consistent and level < state.bidLevels_; ++level)
+								consistent = bids[level].price_ == static_cast<Price>(level) and bids[level].quantity_ == quantity and bids[level].count_ == quantity
+									and asks[level].price_ == -static_cast<Price>(level) and asks[level].quantity_ == quantity and asks[level].count_ == quantity;
+
+							if (!consistent)
+								difference = std::format("version {} read {} orders, sequence {}, {}/{} levels, first bid {}x{}", version, state.orders_,
+									state.marketDataSequence_, state.bidLevels_, state.askLevels_, bids[0].quantity_, bids[0].count_);
+							if (!difference.empty())
+								return;
+						}
+					});
+
+			std::vector<LevelInfo> bids(Levels);
+			std::vector<LevelInfo> asks(Levels);
+			for (std::uint64_t version = 1; version <= publications; ++version)
+			{
+				const auto quantity = static_cast<Quantity>(version);
+				const std::size_t levels = version % (Levels + 1);
+				for (std::size_t level = 0; level < levels; ++level)
+				{
+					bids[level] = LevelInfo{ static_cast<Price>(level), quantity, quantity };
+					asks[level] = LevelInfo{ -static_cast<Price>(level), quantity, quantity };
+				}
+				view.Publish(std::span<const LevelInfo>{ bids.data(), levels }, std::span<const LevelInfo>{ asks.data(), levels }, version, version);
+			}
+			publishing.store(false, std::memory_order_release);
+
+			for (auto& reader : readers)
+				reader.join();
+
+			for (std::size_t reader = 0; reader < Readers; ++reader)
+				if (!differences[reader].empty())
+					return std::format("reader {} after {} reads: {}", reader, reads[reader], differences[reader]);
+			if (view.GetVersion() != publications)
+				return std::format("version {} after {} publications", view.GetVersion(), publications);
+			return {};
+		}
+	}
+
+	void RunDepthTests(const TestOptions& options, TestReport& report)
+	{
+		report.Record(std::format("depth {} matches scalar", IsDepthAnalyticsVectorized() ? "avx2" : "scalar"), VectorMatchesScalar(options));
+		report.Record("depth view reads are consistent", ViewReadsAreConsistent(options));
+	}
+}
@@ -0,0 +1,145 @@
+#include "obTests.hpp"
+#include "api/obMatchingEngine.hpp"
+
+// lib
+#include <atomic>
+#include <chrono>
+#include <format>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* Engine: what the consumer of a MatchingEngine gets back for each instrument, one ack per command submitted, after that command's trades.
+*/
+namespace ob::tests
+{
+	namespace
+	{
+		/* One Expire per instrument with more orders due than one chunk removes: each shard requeues it until they are all gone, but acks it only once.
+		*  The engine's scheduler is off, so the only Expires are the ones submitted, naming a fixed time long past. */
+		std::string ExpireAckedOnce()
+		{
+			constexpr std::size_t Expiring = 10;
+			constexpr std::size_t Instruments = 3;
+			const Timestamp expiry{ std::chrono::hours(24) };
+
+			EngineOptions options{};
+			options.shards_ = 2;
+			options.expireOrders_ = false;
+			options.bookOptions_.expiryChunk_ = 4;
+			options.bookOptions_.depthViewLevels_ = 4;
+			MatchingEngine engine{ options };
+
+			for (std::size_t instrument = 0; instrument < Instruments; ++instrument)
+				engine.AddInstrument(std::format("I{}", instrument));
+
+			// Queued before Start(), they wait in the shards' rings.
+			for (InstrumentId instrument = 0; instrument < Instruments; ++instrument)
+			{
+				for (OrderId orderId = 1; orderId <= Expiring; ++orderId)
+					engine.Submit(instrument, Command::Add(Order{ OrderType::GoodTillTime, orderId, Side::Buy, 100 - static_cast<Price>(orderId), 10, expiry }));
+				engine.Submit(instrument, Command::Add(Order{ OrderType::GoodTillCancel, Expiring + 1, Side::Sell, 200, 10 }));
+				engine.Submit(instrument, Command::Expire(expiry));
+			}
+			engine.Start();
+			engine.Stop();
+
+			std::vector<EngineEvent> events(256);
+			std::vector<std::size_t> acks(Instruments);
+			std::vector<std::size_t> expireAcks(Instruments);
+			for (std::size_t count = engine.Drain(events); count != 0; count = engine.Drain(events))
+				for (std::size_t i = 0; i < count; ++i)
+				{
+					if (events[i].event_.type_ != ExecutionEventType::Ack)
+						continue;
+					++acks[events[i].instrument_];
+					expireAcks[events[i].instrument_] += events[i].event_.ack_.command_ == CommandType::Expire;
+				}
+
+			std::vector<LevelInfo> bids(4);
+			std::vector<LevelInfo> asks(4);
+			for (InstrumentId instrument = 0; instrument < Instruments; ++instrument)
+			{
+				if (acks[instrument] != Expiring + 2 or expireAcks[instrument] != 1)
+					return std::format("instrument {}: {} acks for {} commands, {} of them for the one Expire", instrument, acks[instrument], Expiring + 2, expireAcks[instrument]);
+
+				if (const DepthViewState state = engine.GetDepthView(instrument)->Read(bids, asks); state.orders_ != 1)
+					return std::format("instrument {}: {} orders left after the Expire, expected 1", instrument, state.orders_);
+			}
+			return {};
+		}
+
+		/* Producers keep submitting while Stop() runs: every command Submit accepted must be acked, whichever side of Stop() it landed on,
+		*  and once Stop() has returned no more are accepted. Cancels of orders that aren't there, so every one is acked and nothing trades.
+		*  Several rounds, since how a Submit and the shards' last look at their rings interleave differs from round to round. */
+		std::string SubmitDuringStop()
+		{
+			constexpr std::size_t Rounds = 20;
+			constexpr std::size_t Producers = 3;
+			constexpr InstrumentId Instruments = 4;
+
+			for (std::size_t round = 0; round < Rounds; ++round)
+			{
+				EngineOptions options{};
+				options.shards_ = 2;
+				options.expireOrders_ = false;
+				options.ingressCapacity_ = 1024;
+				MatchingEngine engine{ options };
+				for (InstrumentId instrument = 0; instrument < Instruments; ++instrument)
+					engine.AddInstrument(std::format("I{}", instrument));
+				engine.Start();
+
+				std::atomic<bool> stopped{ false };
+				std::atomic<std::size_t> acceptedAfterStop{ 0 };
+				std::vector<std::vector<std::size_t>> accepted(Producers, std::vector<std::size_t>(Instruments));
+				std::vector<std::thread> producers;
+				for (std::size_t producer = 0; producer < Producers; ++producer)
+					producers.emplace_back([&engine, &stopped, &acceptedAfterStop, &counts = accepted[producer]]()
+						{
+							for (OrderId orderId = 1;; ++orderId)
+							{
+								const bool after = stopped.load(std::memory_order_acquire);
+								const auto instrument = static_cast<InstrumentId>(orderId % Instruments);
+								if (engine.Submit(instrument, Command::Cancel(orderId)))
+								{
+									++counts[instrument];
+									acceptedAfterStop += after;
+								}
+								if (after)
+									return;
+							}
+						});
+
+				std::this_thread::sleep_for(std::chrono::milliseconds(2));
+				engine.Stop();
+				stopped.store(true, std::memory_order_release);
+				for (auto& producer : producers)
+					producer.join();
+
+				std::vector<EngineEvent> events(1024);
+				std::vector<std::size_t> acks(Instruments);
+				for (std::size_t count = engine.Drain(events); count != 0; count = engine.Drain(events))
+					for (std::size_t i = 0; i < count; ++i)
+						acks[events[i].instrument_] += events[i].event_.type_ == ExecutionEventType::Ack;
+
+				if (acceptedAfterStop != 0)
+					return std::format("round {}: {} commands accepted after Stop() returned", round, acceptedAfterStop.load());
+				for (InstrumentId instrument = 0; instrument < Instruments; ++instrument)
+				{
+					std::size_t submitted = 0;
+					for (const auto& counts : accepted)
+						submitted += counts[instrument];
+					if (acks[instrument] != submitted)
+						return std::format("round {}, instrument {}: {} acks for {} accepted commands", round, instrument, acks[instrument], submitted);
+				}
+			}
+			return {};
+		}
+	}
+
+	void RunEngineTests(const TestOptions&, TestReport& report)
+	{
+		report.Record("engine expire acked once", ExpireAckedOnce());
+		report.Record("engine submit during stop", SubmitDuringStop());
+	}
+}
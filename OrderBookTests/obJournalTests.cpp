@@ -0,0 +1,202 @@
+#include "obTests.hpp"
+#include "api/obOrderBook.hpp"
+#include "api/obJournal.hpp"
+
+// lib
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/* Journal: a book journals a seeded flow into small segments, then a fresh book replays the journal and must end up the same,
+*  with the same trades on the way, for every level storage and order id indexing.
+*  Also the on-disk format (headers, sequence numbers across segments, every command field decoded as it was written),
+*  reopening a journal to append to it, reading from a sequence, and refusing a segment of another version.
+*/
+namespace ob::tests
+{
+	namespace
+	{
+		// 1023 records per segment, so a 20000 command flow writes about 20 of them.
+		constexpr std::size_t SegmentSize = 64 << 10;
+		constexpr std::uint64_t RecordsPerSegment = (SegmentSize - sizeof(JournalHeader)) / sizeof(JournalRecord);
+
+		JournalHeader ReadHeader(const std::filesystem::path& path)
+		{
+			JournalHeader header{};
+			std::ifstream file{ path, std::ios::binary };
+			file.read(reinterpret_cast<char*>(&header), sizeof(header));
+			return header;
+		}
+
+		bool SameCommand(const Command& lhs, const Command& rhs)
+		{
+			return lhs.type_ == rhs.type_ and lhs.orderType_ == rhs.orderType_ and lhs.side_ == rhs.side_ and lhs.orderId_ == rhs.orderId_
+				and lhs.price_ == rhs.price_ and lhs.quantity_ == rhs.quantity_ and lhs.time_ == rhs.time_ and lhs.owner_ == rhs.owner_
+				and lhs.highPrice_ == rhs.highPrice_;
+		}
+
+		// Every segment is full but the last, starts with a current header and carries on the sequence where the one before stopped.
+		std::string CheckSegments(const std::filesystem::path& path, std::uint64_t nextSequence)
+		{
+			std::size_t segments = 0;
+			for (; std::filesystem::exists(GetJournalSegmentPath(path, segments)); ++segments)
+			{
+				const JournalHeader header = ReadHeader(GetJournalSegmentPath(path, segments));
+				if (header.magic_ != JournalHeader::Magic or header.version_ != JournalHeader::CurrentVersion or header.recordSize_ != sizeof(JournalRecord))
+					return std::format("segment {} has version {} and record size {}", segments, header.version_, header.recordSize_);
+				if (header.firstSequence_ != 1 + segments * RecordsPerSegment)
+					return std::format("segment {} starts at sequence {}, expected {}", segments, header.firstSequence_, 1 + segments * RecordsPerSegment);
+			}
+
+			const std::size_t expected = static_cast<std::size_t>((nextSequence - 2) / RecordsPerSegment + 1);
+			if (segments != expected)
+				return std::format("{} segments for {} records, expected {}", segments, nextSequence - 1, expected);
+			return {};
+		}
+
+		std::string ReplayJournal(OrderBookOptions bookOptions, const TestOptions& options)
+		{
+			TemporaryDirectory directory{ "journal" };
+			const std::filesystem::path path = directory.GetPath() / "book";
+			const Timestamp start{ std::chrono::hours(24 * 365 * 50) };
+			const std::vector<Command> commands = MakeCommands(options.ops_, options.seed_, start);
+
+			Trades liveTrades;
+			std::string liveDepth;
+			std::size_t liveSize = 0;
+			std::uint64_t nextSequence = 0;
+			{
+				JournalWriter journal{ path, JournalOptions{ .segmentSize_ = SegmentSize, .syncEvery_ = 256 } };
+				bookOptions.journal_ = &journal;
+				OrderBook book{ bookOptions };
+				for (const Command& command : commands)
+					book.Apply(std::span<const Command>{ &command, 1 }, liveTrades);
+
+				liveDepth = ToString(book.GetOrderInfos());
+				liveSize = book.Size();
+				nextSequence = journal.GetNextSequence();
+			}
+
+			// Every command is journaled, rejected or not: whether it is rejected is for the replay to find out again.
+			if (nextSequence != commands.size() + 1)
+				return std::format("journaled {} of {} commands", nextSequence - 1, commands.size());
+
+			if (const std::string difference = CheckSegments(path, nextSequence); !difference.empty())
+				return difference;
+
+			bookOptions.journal_ = nullptr;
+			OrderBook replayed{ bookOptions };
+			JournalReader reader{ path };
+			std::vector<Command> batch(100);
+			Trades replayedTrades;
+			std::size_t replayedCount = 0;
+
+			for (std::size_t count = reader.Read(batch); count != 0; count = reader.Read(batch))
+			{
+				for (std::size_t i = 0; i < count; ++i)
+					if (!SameCommand(batch[i], commands[replayedCount + i]))
+						return std::format("command {} decoded differently from how it was written", replayedCount + i);
+
+				replayed.Replay(std::span<const Command>{ batch.data(), count }, replayedTrades);
+				replayedCount += count;
+			}
+
+			if (replayedCount != commands.size() or reader.GetNextSequence() != nextSequence)
+				return std::format("read {} commands up to sequence {}, expected {} up to {}", replayedCount, reader.GetNextSequence(), commands.size(), nextSequence);
+			if (!SameTrades(replayedTrades, liveTrades))
+				return std::format("the replay traded {} times, the book {}", replayedTrades.size(), liveTrades.size());
+			if (replayed.Size() != liveSize or ToString(replayed.GetOrderInfos()) != liveDepth)
+				return std::format("the replay holds {} orders, the book {}", replayed.Size(), liveSize);
+			return {};
+		}
+
+		// A reopened journal carries on after its last record, and a reader can start right there.
+		std::string ReopenJournal()
+		{
+			TemporaryDirectory directory{ "journal-reopen" };
+			const std::filesystem::path path = directory.GetPath() / "book";
+			const JournalOptions journalOptions{ .segmentSize_ = SegmentSize, .syncEvery_ = 0 };
+
+			std::uint64_t nextSequence = 0;
+			{
+				JournalWriter journal{ path, journalOptions };
+				for (OrderId orderId = 1; orderId <= RecordsPerSegment + 10; ++orderId)
+					journal.Append(Command::Cancel(orderId));
+				nextSequence = journal.GetNextSequence();
+			}
+
+			{
+				JournalWriter journal{ path, journalOptions };
+				if (journal.GetNextSequence() != nextSequence)
+					return std::format("reopened at sequence {}, expected {}", journal.GetNextSequence(), nextSequence);
+				journal.Append(Command::CancelRange(Side::Sell, 101, 105));
+			}
+
+			JournalReader reader{ path, nextSequence };
+			std::vector<Command> batch(10);
+			const std::size_t count = reader.Read(batch);
+			if (count != 1 or !SameCommand(batch[0], Command::CancelRange(Side::Sell, 101, 105)))
+				return std::format("read {} commands from sequence {}, expected the CancelRange appended after reopening", count, nextSequence);
+
+			// The last 6 cancels and the CancelRange.
+			JournalReader fromSecondSegment{ path, RecordsPerSegment + 5 };
+			if (fromSecondSegment.Read(batch) != 7 or batch[0].orderId_ != RecordsPerSegment + 5)
+				return "reading from the second segment started at the wrong record";
+			return {};
+		}
+
+		// A segment written by another version is refused rather than misread.
+		std::string RefuseOtherVersion()
+		{
+			TemporaryDirectory directory{ "journal-version" };
+			const std::filesystem::path path = directory.GetPath() / "book";
+			{
+				JournalWriter journal{ path, JournalOptions{ .segmentSize_ = SegmentSize, .syncEvery_ = 0 } };
+				journal.Append(Command::CancelSide(Side::Buy));
+			}
+
+			{
+				JournalHeader header = ReadHeader(GetJournalSegmentPath(path, 0));
+				header.version_ = 2;
+				std::fstream file{ GetJournalSegmentPath(path, 0), std::ios::binary | std::ios::in | std::ios::out };
+				file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			}
+
+			try
+			{
+				JournalReader reader{ path };
+				return "read a version 2 segment";
+			}
+			catch (const std::runtime_error&)
+			{
+				return {};
+			}
+		}
+	}
+
+	void RunJournalTests(const TestOptions& options, TestReport& report)
+	{
+		for (const LevelStorage levelStorage : { LevelStorage::Map, LevelStorage::Ladder })
+		{
+			for (const OrderIdIndexing orderIdIndexing : { OrderIdIndexing::Hash, OrderIdIndexing::Dense })
+			{
+				OrderBookOptions bookOptions{};
+				bookOptions.levelStorage_ = levelStorage;
+				bookOptions.ladderLevels_ = 64;
+				bookOptions.orderIdIndexing_ = orderIdIndexing;
+				bookOptions.selfTradePrevention_ = SelfTradePrevention::CancelOldest;
+				bookOptions.threading_ = Threading::SingleWriter;
+
+				report.Record(std::format("journal {} {} replay", levelStorage == LevelStorage::Map ? "map" : "ladder",
+					orderIdIndexing == OrderIdIndexing::Hash ? "hash" : "dense"), ReplayJournal(bookOptions, options));
+			}
+		}
+
+		report.Record("journal reopen", ReopenJournal());
+		report.Record("journal other version", RefuseOtherVersion());
+	}
+}
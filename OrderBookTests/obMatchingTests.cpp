@@ -0,0 +1,800 @@
+#include "obTests.hpp"
+#include "api/obOrderBook.hpp"
+
+// lib
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <format>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/* Matching: a randomized differential test of OrderBook against ReferenceBook, a deliberately naive price-time book written from the matching rules alone,
+*  and directed cases pinning down single rules, some of which (market-data reporting) the reference doesn't model.
+*
+*  The flow runs through every combination of level storage, order id indexing and self-trade prevention mode. After every command both books must have produced the same trades,
+*  and every 100 commands they must hold the same levels and order count. It mixes GoodTillCancel, FillAndKill, FillOrKill and Market orders
+*  from a few owners (zero being no owner) with cancels, modifies (in place and not), and side, range and owner mass cancels,
+*  over a drifting price range, which keeps ladders re-centering, with now and then a limit far outside it.
+*
+*  The batch calls (Apply, AddOrders and CancelOrders over a span) are checked against the same commands applied one by one.
+*/
+namespace ob::tests
+{
+	namespace
+	{
+		/* Levels are deques in maps ordered best first, every operation a plain walk over them, nothing cached.
+		*  Slow on purpose: there is nothing in it clever enough to be wrong in the same way as the book. */
+		class ReferenceBook
+		{
+		public:
+			explicit ReferenceBook(SelfTradePrevention selfTradePrevention)
+				: selfTradePrevention_{ selfTradePrevention }
+			{ }
+
+			Trades Add(const Order& order)
+			{
+				Trades trades;
+				if (locations_.contains(order.GetOrderId()))
+					return trades;
+
+				if (order.GetSide() == Side::Buy)
+					AddTo(Side::Buy, bids_, asks_, order, trades);
+				else
+					AddTo(Side::Sell, asks_, bids_, order, trades);
+				return trades;
+			}
+
+			void Cancel(OrderId orderId)
+			{
+				const auto location = locations_.find(orderId);
+				if (location == locations_.end())
+					return;
+
+				if (location->second.side_ == Side::Buy)
+					Erase(bids_, location->second.price_, orderId);
+				else
+					Erase(asks_, location->second.price_, orderId);
+				locations_.erase(location);
+			}
+
+			Trades Modify(const OrderModify& modify)
+			{
+				const auto location = locations_.find(modify.GetOrderId());
+				if (location == locations_.end())
+					return {};
+
+				const Location where = location->second;
+				Resting& resting = where.side_ == Side::Buy ? Find(bids_, where.price_, modify.GetOrderId()) : Find(asks_, where.price_, modify.GetOrderId());
+
+				// Only taking quantity off leaves the order where it is.
+				if (modify.GetSide() == where.side_ and modify.GetPrice() == where.price_ and modify.GetQuantity() != 0 and modify.GetQuantity() <= resting.remaining_)
+				{
+					resting.remaining_ = modify.GetQuantity();
+					return {};
+				}
+
+				const OrderType orderType = resting.orderType_;
+				const OwnerId owner = resting.owner_;
+				Cancel(modify.GetOrderId());
+				return Add(modify.ToOrder(orderType, {}, owner));
+			}
+
+			void CancelSide(Side side)
+			{
+				if (side == Side::Buy)
+					CancelLevels(bids_, [](Price) { return true; });
+				else
+					CancelLevels(asks_, [](Price) { return true; });
+			}
+
+			void CancelRange(Side side, Price lowPrice, Price highPrice)
+			{
+				const auto inRange = [lowPrice, highPrice](Price price) { return price >= lowPrice and price <= highPrice; };
+				if (side == Side::Buy)
+					CancelLevels(bids_, inRange);
+				else
+					CancelLevels(asks_, inRange);
+			}
+
+			void CancelOwner(OwnerId owner)
+			{
+				if (owner == OwnerId{})
+					return;
+
+				CancelOwnerFrom(bids_, owner);
+				CancelOwnerFrom(asks_, owner);
+			}
+
+			std::size_t Size() const { return locations_.size(); }
+
+			LevelInfos GetBids() const { return GetLevels(bids_); }
+			LevelInfos GetAsks() const { return GetLevels(asks_); }
+
+		private:
+			struct Resting
+			{
+				OrderId orderId_;
+				Price price_;
+				Quantity remaining_;
+				OwnerId owner_;
+				OrderType orderType_;
+			};
+
+			struct Location
+			{
+				Side side_;
+				Price price_;
+			};
+
+			using Bids = std::map<Price, std::deque<Resting>, std::greater<Price>>;
+			using Asks = std::map<Price, std::deque<Resting>, std::less<Price>>;
+
+			const SelfTradePrevention selfTradePrevention_;
+			Bids bids_{};
+			Asks asks_{};
+			std::unordered_map<OrderId, Location> locations_{};
+
+			// Does an order priced at 'price' reach a level at 'levelPrice' of 'levels', the other side?
+			template <typename Levels>
+			static bool Crosses(const Levels& levels, Price price, Price levelPrice)
+			{
+				return !levels.key_comp()(price, levelPrice);
+			}
+
+			template <typename Same, typename Opposite>
+			void AddTo(Side side, Same& same, Opposite& opposite, const Order& order, Trades& trades)
+			{
+				const OrderType orderType = order.GetOrderType();
+				const OwnerId owner = order.GetOwner();
+				Price price = order.GetPrice();
+				Quantity remaining = order.GetRemainingQuantity();
+
+				// A market order can reach every level of the other side, as if it was priced at the worst of them.
+				if (orderType == OrderType::Market)
+				{
+					if (opposite.empty())
+						return;
+					price = opposite.rbegin()->first;
+				}
+
+				if (orderType == OrderType::FillAndKill and (opposite.empty() or !Crosses(opposite, price, opposite.begin()->first)))
+					return;
+
+				if (orderType == OrderType::FillOrKill and !CanFullyFill(opposite, price, remaining, owner))
+					return;
+
+				const bool preventSelfTrades = selfTradePrevention_ != SelfTradePrevention::None and owner != OwnerId{};
+				bool live = true;
+
+				while (live and remaining != 0 and !opposite.empty() and Crosses(opposite, price, opposite.begin()->first))
+				{
+					auto level = opposite.begin();
+					auto& queue = level->second;
+
+					while (live and remaining != 0 and !queue.empty())
+					{
+						Resting& match = queue.front();
+
+						if (preventSelfTrades and match.owner_ == owner)
+						{
+							switch (selfTradePrevention_)
+							{
+							case SelfTradePrevention::CancelOldest:
+								PopFront(queue);
+								break;
+							case SelfTradePrevention::CancelBoth:
+								PopFront(queue);
+								live = false;
+								break;
+							case SelfTradePrevention::DecrementAndCancel:
+							{
+								const Quantity quantity = std::min(remaining, match.remaining_);
+								remaining -= quantity;
+								match.remaining_ -= quantity;
+								if (match.remaining_ == 0)
+									PopFront(queue);
+								live = remaining != 0;
+								break;
+							}
+							default:
+								live = false;
+								break;
+							}
+							continue;
+						}
+
+						const Quantity quantity = std::min(remaining, match.remaining_);
+						remaining -= quantity;
+						match.remaining_ -= quantity;
+
+						const TradeInfo incoming{ order.GetOrderId(), price, quantity };
+						const TradeInfo resting{ match.orderId_, match.price_, quantity };
+						if (side == Side::Buy)
+							trades.emplace_back(incoming, resting);
+						else
+							trades.emplace_back(resting, incoming);
+
+						if (match.remaining_ == 0)
+							PopFront(queue);
+					}
+
+					if (queue.empty())
+						opposite.erase(level);
+				}
+
+				const bool rests = orderType != OrderType::FillAndKill and orderType != OrderType::FillOrKill and orderType != OrderType::Market;
+				if (!live or remaining == 0 or !rests)
+					return;
+
+				same[price].push_back(Resting{ order.GetOrderId(), price, remaining, owner, orderType });
+				locations_.emplace(order.GetOrderId(), Location{ side, price });
+			}
+
+			// What a FillOrKill order could trade, walking the other side as the sweep would, stopping where self-trade prevention would stop it.
+			template <typename Opposite>
+			bool CanFullyFill(const Opposite& opposite, Price price, Quantity quantity, OwnerId owner) const
+			{
+				const bool aroundOwner = owner != OwnerId{} and selfTradePrevention_ != SelfTradePrevention::None
+					and selfTradePrevention_ != SelfTradePrevention::DecrementAndCancel;
+
+				std::uint64_t reachable = 0;
+				for (const auto& [levelPrice, queue] : opposite)
+				{
+					if (!Crosses(opposite, price, levelPrice))
+						break;
+
+					for (const Resting& resting : queue)
+					{
+						if (aroundOwner and resting.owner_ == owner)
+						{
+							if (selfTradePrevention_ == SelfTradePrevention::CancelOldest)
+								continue;
+							return reachable >= quantity;
+						}
+
+						reachable += resting.remaining_;
+					}
+				}
+
+				return reachable >= quantity;
+			}
+
+			void PopFront(std::deque<Resting>& queue)
+			{
+				locations_.erase(queue.front().orderId_);
+				queue.pop_front();
+			}
+
+			template <typename Levels>
+			static Resting& Find(Levels& levels, Price price, OrderId orderId)
+			{
+				auto& queue = levels.at(price);
+				return *std::find_if(queue.begin(), queue.end(), [orderId](const Resting& resting) { return resting.orderId_ == orderId; });
+			}
+
+			template <typename Levels>
+			static void Erase(Levels& levels, Price price, OrderId orderId)
+			{
+				auto& queue = levels.at(price);
+				queue.erase(std::find_if(queue.begin(), queue.end(), [orderId](const Resting& resting) { return resting.orderId_ == orderId; }));
+				if (queue.empty())
+					levels.erase(price);
+			}
+
+			template <typename Levels, typename Predicate>
+			void CancelLevels(Levels& levels, Predicate predicate)
+			{
+				for (auto level = levels.begin(); level != levels.end();)
+				{
+					if (!predicate(level->first))
+					{
+						++level;
+						continue;
+					}
+
+					for (const Resting& resting : level->second)
+						locations_.erase(resting.orderId_);
+					level = levels.erase(level);
+				}
+			}
+
+			template <typename Levels>
+			void CancelOwnerFrom(Levels& levels, OwnerId owner)
+			{
+				for (auto level = levels.begin(); level != levels.end();)
+				{
+					auto& queue = level->second;
+					for (auto resting = queue.begin(); resting != queue.end();)
+					{
+						if (resting->owner_ != owner)
+						{
+							++resting;
+							continue;
+						}
+
+						locations_.erase(resting->orderId_);
+						resting = queue.erase(resting);
+					}
+
+					level = queue.empty() ? levels.erase(level) : std::next(level);
+				}
+			}
+
+			template <typename Levels>
+			static LevelInfos GetLevels(const Levels& levels)
+			{
+				LevelInfos infos;
+				for (const auto& [price, queue] : levels)
+				{
+					Quantity quantity = 0;
+					for (const Resting& resting : queue)
+						quantity += resting.remaining_;
+					infos.push_back(LevelInfo{ price, quantity, static_cast<Quantity>(queue.size()) });
+				}
+				return infos;
+			}
+		};
+
+		// Runs the flow through both books, returns an empty string if they agreed all the way, otherwise what differed first.
+		std::string RunFlow(const OrderBookOptions& bookOptions, const TestOptions& options)
+		{
+			OrderBook book{ bookOptions };
+			ReferenceBook reference{ bookOptions.selfTradePrevention_ };
+
+			std::mt19937_64 random{ options.seed_ };
+			const auto pick = [&random](std::uint64_t count) { return random() % count; };
+			OrderId nextOrderId = 1;
+
+			for (std::size_t op = 0; op < options.ops_; ++op)
+			{
+				// The range drifts up and back every few thousand commands, far enough that a 64 tick ladder has to re-center.
+				const Price mid = 1000 + static_cast<Price>((op / 2000) % 8) * 40;
+				const Side side = pick(2) == 0 ? Side::Buy : Side::Sell;
+				// Now and then a limit far outside the range, further from it than a ladder's window reaches.
+				const Price price = pick(50) != 0 ? mid + static_cast<Price>(pick(31)) - 15
+					: pick(2) == 0 ? mid - static_cast<Price>(100 + pick(800)) : mid + static_cast<Price>(100 + pick(100'000));
+				const Quantity quantity = static_cast<Quantity>(1 + pick(40));
+				const OwnerId owner = static_cast<OwnerId>(pick(4));
+				const OrderId existing = 1 + pick(nextOrderId);
+
+				Trades actual;
+				Trades expected;
+				std::string command;
+
+				const std::uint64_t roll = pick(100);
+				if (roll < 50)
+				{
+					const std::uint64_t type = pick(10);
+					const OrderType orderType = type < 6 ? OrderType::GoodTillCancel : type < 7 ? OrderType::FillAndKill
+						: type < 9 ? OrderType::FillOrKill : OrderType::Market;
+					const Order order = orderType == OrderType::Market ? Order{ nextOrderId, side, quantity, owner }
+						: Order{ orderType, nextOrderId, side, price, quantity, {}, owner };
+					++nextOrderId;
+
+					command = std::format("add {} type {} price {} quantity {} owner {}", order.GetOrderId(), static_cast<int>(orderType), order.GetPrice(), quantity, owner);
+					actual = book.AddOrder(order);
+					expected = reference.Add(order);
+				}
+				else if (roll < 80)
+				{
+					command = std::format("cancel {}", existing);
+					book.CancelOrder(existing);
+					reference.Cancel(existing);
+				}
+				else if (roll < 96)
+				{
+					// Half of them only take quantity off an order where it rests, the other half move it.
+					OrderModify modify{ existing, side, price, quantity };
+					if (pick(2) == 0)
+					{
+						const auto infos = book.GetOrderInfos();
+						for (const auto* levels : { &infos.GetBids(), &infos.GetAsks() })
+							if (!levels->empty())
+								modify = OrderModify{ existing, levels == &infos.GetBids() ? Side::Buy : Side::Sell, levels->front().price_, static_cast<Quantity>(1 + pick(5)) };
+					}
+
+					command = std::format("modify {} price {} quantity {}", existing, modify.GetPrice(), modify.GetQuantity());
+					actual = book.MatchOrder(modify);
+					expected = reference.Modify(modify);
+				}
+				else if (roll < 98)
+				{
+					command = std::format("cancel owner {}", owner);
+					book.CancelOwnerOrders(owner);
+					reference.CancelOwner(owner);
+				}
+				else if (roll < 99)
+				{
+					command = std::format("cancel range {} to {}", price - 3, price + 3);
+					book.CancelRange(side, price - 3, price + 3);
+					reference.CancelRange(side, price - 3, price + 3);
+				}
+				else
+				{
+					command = "cancel side";
+					book.CancelSide(side);
+					reference.CancelSide(side);
+				}
+
+				if (!SameTrades(actual, expected))
+					return std::format("command {} ({}) traded {}, expected {}", op, command, ToString(actual), ToString(expected));
+
+				if (op % 100 == 0 or op + 1 == options.ops_)
+				{
+					const auto infos = book.GetOrderInfos();
+					if (book.Size() != reference.Size() or !SameLevels(infos.GetBids(), reference.GetBids()) or !SameLevels(infos.GetAsks(), reference.GetAsks()))
+						return std::format("after command {} ({}) the book holds {} orders on {}/{} levels, expected {} on {}/{}", op, command,
+							book.Size(), infos.GetBids().size(), infos.GetAsks().size(), reference.Size(), reference.GetBids().size(), reference.GetAsks().size());
+				}
+			}
+
+			return {};
+		}
+
+		// A market order larger than the other side trades it all, level by level, and nothing of it rests.
+		std::string MarketSweepDoesNotRest(const OrderBookOptions& bookOptions)
+		{
+			OrderBook book{ bookOptions };
+			for (OrderId orderId = 1; orderId <= 6; ++orderId)
+				book.AddOrder(Order{ OrderType::GoodTillCancel, orderId, Side::Sell, 100 + static_cast<Price>((orderId - 1) / 2), 10 });
+
+			const Trades trades = book.AddOrder(Order{ 7, Side::Buy, 100 });
+			if (trades.size() != 6)
+				return std::format("traded {}", ToString(trades));
+
+			for (std::size_t i = 0; i < trades.size(); ++i)
+				if (trades[i].GetAskTrade().orderId_ != i + 1 or trades[i].GetAskTrade().price_ != 100 + static_cast<Price>(i / 2))
+					return std::format("traded out of price-time order: {}", ToString(trades));
+
+			if (book.Size() != 0 or !book.GetOrderInfos().GetBids().empty())
+				return std::format("left {} in the book", ToString(book.GetOrderInfos()));
+			return {};
+		}
+
+		// Taking quantity off keeps an order's place in its queue, anything else sends it to the back (or through the book).
+		std::string ModifyPriority(const OrderBookOptions& bookOptions)
+		{
+			OrderBook book{ bookOptions };
+			book.AddOrder(Order{ OrderType::GoodTillCancel, 1, Side::Sell, 100, 10 });
+			book.AddOrder(Order{ OrderType::GoodTillCancel, 2, Side::Sell, 100, 10 });
+			book.AddOrder(Order{ OrderType::GoodTillCancel, 3, Side::Sell, 100, 10 });
+
+			// 1 shrinks in place, 2 grows and goes behind 3.
+			book.MatchOrder(OrderModify{ 1, Side::Sell, 100, 4 });
+			book.MatchOrder(OrderModify{ 2, Side::Sell, 100, 12 });
+
+			const auto infos = book.GetOrderInfos();
+			if (infos.GetAsks().size() != 1 or infos.GetAsks().front().quantity_ != 26 or infos.GetAsks().front().count_ != 3)
+				return std::format("after the modifies {}", ToString(infos));
+
+			const Trades trades = book.AddOrder(Order{ OrderType::FillAndKill, 4, Side::Buy, 100, 26 });
+			if (trades.size() != 3 or trades[0].GetAskTrade().orderId_ != 1 or trades[0].GetAskTrade().quantity_ != 4
+				or trades[1].GetAskTrade().orderId_ != 3 or trades[2].GetAskTrade().orderId_ != 2)
+				return std::format("traded {}, expected 1 (4) then 3 then 2", ToString(trades));
+
+			// A modify that crosses trades like a new order.
+			book.AddOrder(Order{ OrderType::GoodTillCancel, 5, Side::Sell, 101, 10 });
+			book.AddOrder(Order{ OrderType::GoodTillCancel, 6, Side::Buy, 99, 10 });
+			const Trades crossed = book.MatchOrder(OrderModify{ 6, Side::Buy, 101, 10 });
+			if (crossed.size() != 1 or crossed[0].GetAskTrade().orderId_ != 5 or book.Size() != 0)
+				return std::format("the crossing modify traded {}, {} left", ToString(crossed), ToString(book.GetOrderInfos()));
+			return {};
+		}
+
+		// Mass cancels take exactly what they name: an owner's orders on both sides, a side's levels within the range, bounds included.
+		std::string MassCancels(const OrderBookOptions& bookOptions)
+		{
+			OrderBook book{ bookOptions };
+			OrderId orderId = 1;
+			for (Price price = 95; price <= 99; ++price)
+				for (const OwnerId owner : { 1, 2 })
+				{
+					book.AddOrder(Order{ OrderType::GoodTillCancel, orderId++, Side::Buy, price, 10, {}, owner });
+					book.AddOrder(Order{ OrderType::GoodTillCancel, orderId++, Side::Sell, price + 10, 10, {}, owner });
+				}
+
+			book.CancelOwnerOrders(1);
+			if (book.Size() != 10)
+				return std::format("cancelling owner 1 left {}", ToString(book.GetOrderInfos()));
+
+			book.CancelRange(Side::Buy, 96, 98);
+			book.CancelRange(Side::Sell, 109, 200);
+			const std::string expected{ "bids 99x10/1 95x10/1 asks 105x10/1 106x10/1 107x10/1 108x10/1" };
+			if (ToString(book.GetOrderInfos()) != expected)
+				return std::format("after the range cancels {}, expected {}", ToString(book.GetOrderInfos()), expected);
+
+			// An owner whose orders are all gone can come back.
+			book.CancelOwnerOrders(2);
+			book.AddOrder(Order{ OrderType::GoodTillCancel, orderId++, Side::Buy, 100, 5, {}, 2 });
+			book.CancelSide(Side::Sell);
+			if (ToString(book.GetOrderInfos()) != "bids 100x5/1 asks")
+				return std::format("after owner 2 came back {}", ToString(book.GetOrderInfos()));
+
+			book.CancelOwnerOrders(2);
+			if (book.Size() != 0)
+				return std::format("cancelling owner 2 again left {}", ToString(book.GetOrderInfos()));
+			return {};
+		}
+
+		/* The MakeCommands flow through one book in batches and through another one command at a time: the trades and the levels must match after every batch.
+		*  Batches are of random sizes, either whole spans through Apply, or runs of adds through AddOrders and runs of cancels through CancelOrders,
+		*  with whatever comes between them through Apply. Time starts a year from now, so the prune threads have nothing to expire, only the flow's Expire commands. */
+		std::string BatchesMatchSingleCalls(const OrderBookOptions& bookOptions, const TestOptions& options, bool typed)
+		{
+			const std::vector<Command> commands = MakeCommands(options.ops_, options.seed_, std::chrono::system_clock::now() + std::chrono::hours(24 * 365));
+			std::mt19937_64 random{ options.seed_ + 2 };
+
+			OrderBook batched{ bookOptions };
+			OrderBook single{ bookOptions };
+			Trades batchedTrades;
+			Trades singleTrades;
+			Trades trades;
+			std::vector<Order> orders;
+			std::vector<OrderId> orderIds;
+
+			for (std::size_t begin = 0; begin < commands.size();)
+			{
+				std::size_t end = std::min(commands.size(), begin + 1 + static_cast<std::size_t>(random() % 64));
+				const CommandType type = commands[begin].type_;
+				if (typed and (type == CommandType::Add or type == CommandType::Cancel))
+					end = static_cast<std::size_t>(std::find_if(commands.begin() + begin, commands.begin() + end,
+						[type](const Command& command) { return command.type_ != type; }) - commands.begin());
+				const std::span<const Command> batch{ commands.data() + begin, end - begin };
+
+				batchedTrades.clear();
+				if (typed and type == CommandType::Add)
+				{
+					orders.clear();
+					for (const Command& command : batch)
+						orders.push_back(command.ToOrder());
+					batched.AddOrders(orders, batchedTrades);
+				}
+				else if (typed and type == CommandType::Cancel)
+				{
+					orderIds.clear();
+					for (const Command& command : batch)
+						orderIds.push_back(command.orderId_);
+					batched.CancelOrders(orderIds);
+				}
+				else
+					batched.Apply(batch, batchedTrades);
+
+				singleTrades.clear();
+				for (const Command& command : batch)
+				{
+					single.Apply(command, trades);
+					singleTrades.insert(singleTrades.end(), trades.begin(), trades.end());
+				}
+
+				if (!SameTrades(batchedTrades, singleTrades))
+					return std::format("commands {} to {} traded {} in a batch, {} one by one", begin, end, ToString(batchedTrades), ToString(singleTrades));
+				if (batched.Size() != single.Size() or ToString(batched.GetOrderInfos()) != ToString(single.GetOrderInfos()))
+					return std::format("after commands {} to {} the batched book holds {}, one by one {}", begin, end,
+						ToString(batched.GetOrderInfos()), ToString(single.GetOrderInfos()));
+				begin = end;
+			}
+
+			return {};
+		}
+
+		/* Limits far further from the resting levels than a ladder's window reaches: a FillAndKill that sweeps the side, one that rests nothing,
+		*  a FillOrKill, and resting orders that take the window. A ladder book and a map book must trade and rest the same. */
+		std::string LadderMatchesMap(const OrderBookOptions& bookOptions)
+		{
+			OrderBookOptions mapOptions = bookOptions;
+			mapOptions.levelStorage_ = LevelStorage::Map;
+			OrderBook ladder{ bookOptions };
+			OrderBook map{ mapOptions };
+
+			const std::vector<Order> orders{
+				Order{ OrderType::GoodTillCancel, 1, Side::Buy, 9'999, 10 },
+				Order{ OrderType::GoodTillCancel, 2, Side::Buy, 9'998, 10 },
+				Order{ OrderType::GoodTillCancel, 3, Side::Sell, 10'001, 10 },
+				Order{ OrderType::GoodTillCancel, 4, Side::Sell, 10'002, 10 },
+				Order{ OrderType::FillAndKill, 5, Side::Buy, 310'001, 15 },
+				Order{ OrderType::FillAndKill, 6, Side::Sell, 1, 5 },
+				Order{ OrderType::FillOrKill, 7, Side::Sell, 100, 15 },
+				Order{ OrderType::GoodTillCancel, 8, Side::Buy, 400'000, 20 },
+				Order{ OrderType::GoodTillCancel, 9, Side::Buy, 9'997, 10 },
+				Order{ OrderType::FillAndKill, 10, Side::Sell, 9'000, 30 },
+				Order{ OrderType::GoodTillCancel, 11, Side::Sell, 50, 40 },
+			};
+
+			for (const Order& order : orders)
+			{
+				const Trades expected = map.AddOrder(order);
+				const Trades actual = ladder.AddOrder(order);
+				if (!SameTrades(actual, expected))
+					return std::format("order {} at {} traded {} on the ladder, {} on the map", order.GetOrderId(), order.GetPrice(), ToString(actual), ToString(expected));
+				if (ToString(ladder.GetOrderInfos()) != ToString(map.GetOrderInfos()))
+					return std::format("after order {} the ladder holds {}, the map {}", order.GetOrderId(), ToString(ladder.GetOrderInfos()), ToString(map.GetOrderInfos()));
+			}
+			return {};
+		}
+
+		std::string_view GetName(SelfTradePrevention selfTradePrevention)
+		{
+			switch (selfTradePrevention)
+			{
+			case SelfTradePrevention::CancelNewest: return "cancel-newest";
+			case SelfTradePrevention::CancelOldest: return "cancel-oldest";
+			case SelfTradePrevention::CancelBoth: return "cancel-both";
+			case SelfTradePrevention::DecrementAndCancel: return "decrement";
+			default: return "none";
+			}
+		}
+
+		Quantity Traded(const Trades& trades)
+		{
+			Quantity quantity = 0;
+			for (const auto& trade : trades)
+				quantity += trade.GetBidTrade().quantity_;
+			return quantity;
+		}
+
+		/* Prices much further apart than the 64 ticks a ladder's window may cover here (see OrderBookOptions::ladderMaxLevels_), which a map holds like any other.
+		*  A far-off ask on an empty side doesn't keep the asks near the touch out, a far better bid takes the window and the bids behind it wait outside,
+		*  and orders trade across all of them in price order. */
+		std::string FarPrices(const OrderBookOptions& bookOptions)
+		{
+			OrderBook book{ bookOptions };
+			book.AddOrder(Order{ OrderType::GoodTillCancel, 1, Side::Sell, 1'000'000, 10 });
+			book.AddOrder(Order{ OrderType::GoodTillCancel, 2, Side::Sell, 105, 10 });
+			book.AddOrder(Order{ OrderType::GoodTillCancel, 3, Side::Sell, 110, 10 });
+			if (ToString(book.GetOrderInfos()) != "bids asks 105x10/1 110x10/1 1000000x10/1")
+				return std::format("after the asks {}", ToString(book.GetOrderInfos()));
+
+			Trades trades = book.AddOrder(Order{ OrderType::FillAndKill, 4, Side::Buy, 2'000'000, 25 });
+			if (trades.size() != 3 or trades[0].GetAskTrade().orderId_ != 2 or trades[1].GetAskTrade().orderId_ != 3
+				or trades[2].GetAskTrade().orderId_ != 1 or trades[2].GetAskTrade().quantity_ != 5)
+				return std::format("the far FillAndKill traded {}", ToString(trades));
+
+			book.CancelOrder(1);
+			book.AddOrder(Order{ OrderType::GoodTillCancel, 5, Side::Buy, 99, 10 });
+			book.AddOrder(Order{ OrderType::GoodTillCancel, 6, Side::Buy, 98, 10 });
+			book.AddOrder(Order{ OrderType::GoodTillCancel, 7, Side::Buy, 500, 10 });
+			book.AddOrder(Order{ OrderType::GoodTillCancel, 8, Side::Buy, 97, 10 });
+			book.AddOrder(Order{ OrderType::GoodTillCancel, 9, Side::Buy, 480, 10 });
+			if (ToString(book.GetOrderInfos()) != "bids 500x10/1 480x10/1 99x10/1 98x10/1 97x10/1 asks")
+				return std::format("after the bids {}", ToString(book.GetOrderInfos()));
+
+			// Once the far bids are gone, the ones behind them are the best again.
+			book.CancelOrder(7);
+			book.CancelOrder(9);
+			trades = book.AddOrder(Order{ OrderType::FillOrKill, 10, Side::Sell, 97, 30 });
+			if (Traded(trades) != 30 or trades.front().GetBidTrade().orderId_ != 5 or trades.back().GetBidTrade().orderId_ != 8)
+				return std::format("the FillOrKill traded {}", ToString(trades));
+			if (book.Size() != 0)
+				return std::format("left {}", ToString(book.GetOrderInfos()));
+			return {};
+		}
+
+		/* What each mode does when an owner's order meets its own resting orders, in front of and behind someone else's.
+		*  Then FillOrKill: whether it can fill counts only what the sweep would reach, it stops at (or, cancelling oldest, skips) the owner's own orders. */
+		std::string SelfTradePreventionModes(const OrderBookOptions& bookOptions)
+		{
+			const SelfTradePrevention mode = bookOptions.selfTradePrevention_;
+			{
+				OrderBook book{ bookOptions };
+				book.AddOrder(Order{ OrderType::GoodTillCancel, 1, Side::Sell, 100, 10, {}, 7 });
+				book.AddOrder(Order{ OrderType::GoodTillCancel, 2, Side::Sell, 100, 10, {}, 8 });
+				book.AddOrder(Order{ OrderType::GoodTillCancel, 3, Side::Sell, 101, 5, {}, 7 });
+				const Trades trades = book.AddOrder(Order{ OrderType::GoodTillCancel, 10, Side::Buy, 101, 30, {}, 7 });
+
+				const std::string expected = mode == SelfTradePrevention::None ? "bids 101x5/1 asks"
+					: mode == SelfTradePrevention::CancelNewest ? "bids asks 100x20/2 101x5/1"
+					: mode == SelfTradePrevention::CancelOldest ? "bids 101x20/1 asks"
+					: mode == SelfTradePrevention::CancelBoth ? "bids asks 100x10/1 101x5/1"
+					: "bids 101x5/1 asks";
+				const Quantity expectedTraded = mode == SelfTradePrevention::None ? 25 : mode == SelfTradePrevention::CancelNewest or mode == SelfTradePrevention::CancelBoth ? 0 : 10;
+
+				if (ToString(book.GetOrderInfos()) != expected or Traded(trades) != expectedTraded)
+					return std::format("traded {} leaving {}, expected {} leaving {}", ToString(trades), ToString(book.GetOrderInfos()), expectedTraded, expected);
+				if (mode != SelfTradePrevention::None)
+					for (const auto& trade : trades)
+						if (trade.GetAskTrade().orderId_ != 2)
+							return std::format("traded with its own order: {}", ToString(trades));
+			}
+			{
+				// Only 5 of someone else's behind the owner's own 5.
+				OrderBook book{ bookOptions };
+				book.AddOrder(Order{ OrderType::GoodTillCancel, 1, Side::Sell, 100, 5, {}, 2 });
+				book.AddOrder(Order{ OrderType::GoodTillCancel, 2, Side::Sell, 101, 5, {}, 7 });
+				const Trades trades = book.AddOrder(Order{ OrderType::FillOrKill, 3, Side::Buy, 101, 10, {}, 7 });
+
+				const Quantity expected = mode == SelfTradePrevention::None ? 10 : mode == SelfTradePrevention::DecrementAndCancel ? 5 : 0;
+				if (Traded(trades) != expected)
+					return std::format("FillOrKill behind its own order traded {}, expected {}", ToString(trades), expected);
+			}
+			{
+				// The owner's own 5 in front of 12 of others'.
+				OrderBook book{ bookOptions };
+				book.AddOrder(Order{ OrderType::GoodTillCancel, 1, Side::Sell, 100, 5, {}, 7 });
+				book.AddOrder(Order{ OrderType::GoodTillCancel, 2, Side::Sell, 100, 6, {}, 2 });
+				book.AddOrder(Order{ OrderType::GoodTillCancel, 4, Side::Sell, 101, 6, {}, 3 });
+				const Trades trades = book.AddOrder(Order{ OrderType::FillOrKill, 3, Side::Buy, 101, 10, {}, 7 });
+
+				const Quantity expected = mode == SelfTradePrevention::None or mode == SelfTradePrevention::CancelOldest ? 10
+					: mode == SelfTradePrevention::DecrementAndCancel ? 5 : 0;
+				if (Traded(trades) != expected)
+					return std::format("FillOrKill in front of its own order traded {}, expected {}", ToString(trades), expected);
+			}
+			return {};
+		}
+
+		// With TradeReporting::PerLevel the feed has one LevelTrade per level swept, however many orders it filled there.
+		std::string PerLevelReporting(OrderBookOptions bookOptions)
+		{
+			bookOptions.marketDataCapacity_ = 256;
+			bookOptions.tradeReporting_ = TradeReporting::PerLevel;
+			OrderBook book{ bookOptions };
+
+			for (OrderId orderId = 1; orderId <= 6; ++orderId)
+				book.AddOrder(Order{ OrderType::GoodTillCancel, orderId, Side::Sell, 100 + static_cast<Price>((orderId - 1) / 2), 10 });
+
+			std::vector<MarketDataEvent> events(256);
+			book.DrainMarketData(events);
+
+			// Takes both orders at 100 and 101 and one of the two at 102.
+			book.AddOrder(Order{ OrderType::FillAndKill, 7, Side::Buy, 102, 45 });
+			const std::size_t count = book.DrainMarketData(events);
+
+			std::string summary;
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				if (events[i].type_ == MarketDataEventType::Trade)
+					return "reported a per-fill Trade";
+				if (events[i].type_ == MarketDataEventType::LevelTrade)
+					summary += std::format("{}x{}/{} ", events[i].levelTrade_.price_, events[i].levelTrade_.quantity_, events[i].levelTrade_.fills_);
+			}
+
+			if (summary != "100x20/2 101x20/2 102x5/1 ")
+				return std::format("level trades {}", summary);
+			return {};
+		}
+	}
+
+	void RunMatchingTests(const TestOptions& options, TestReport& report)
+	{
+		for (const LevelStorage levelStorage : { LevelStorage::Map, LevelStorage::Ladder })
+		{
+			for (const OrderIdIndexing orderIdIndexing : { OrderIdIndexing::Hash, OrderIdIndexing::Dense })
+			{
+				OrderBookOptions bookOptions{};
+				bookOptions.levelStorage_ = levelStorage;
+				bookOptions.ladderLevels_ = 64;
+				bookOptions.ladderMaxLevels_ = 64;
+				bookOptions.orderIdIndexing_ = orderIdIndexing;
+				bookOptions.orderCapacity_ = 256;
+
+				const std::string name = std::format("matching {} {}", levelStorage == LevelStorage::Map ? "map" : "ladder",
+					orderIdIndexing == OrderIdIndexing::Hash ? "hash" : "dense");
+
+				report.Record(std::format("{} market sweep", name), MarketSweepDoesNotRest(bookOptions));
+				report.Record(std::format("{} per-level trades", name), PerLevelReporting(bookOptions));
+				report.Record(std::format("{} modify priority", name), ModifyPriority(bookOptions));
+				report.Record(std::format("{} mass cancels", name), MassCancels(bookOptions));
+				report.Record(std::format("{} far prices", name), FarPrices(bookOptions));
+				if (levelStorage == LevelStorage::Ladder)
+					report.Record(std::format("{} matches map past the window", name), LadderMatchesMap(bookOptions));
+				report.Record(std::format("{} batch apply", name), BatchesMatchSingleCalls(bookOptions, options, false));
+				report.Record(std::format("{} batch add and cancel", name), BatchesMatchSingleCalls(bookOptions, options, true));
+
+				for (const SelfTradePrevention selfTradePrevention : { SelfTradePrevention::None, SelfTradePrevention::CancelNewest,
+					SelfTradePrevention::CancelOldest, SelfTradePrevention::CancelBoth, SelfTradePrevention::DecrementAndCancel })
+				{
+					bookOptions.selfTradePrevention_ = selfTradePrevention;
+					report.Record(std::format("{} {} flow", name, GetName(selfTradePrevention)), RunFlow(bookOptions, options));
+					report.Record(std::format("{} {} self-trades", name, GetName(selfTradePrevention)), SelfTradePreventionModes(bookOptions));
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,117 @@
+#include "obTests.hpp"
+#include "api/obOrderBookPipeline.hpp"
+
+// lib
+#include <atomic>
+#include <chrono>
+#include <format>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* Pipeline: what the consumer of an OrderBookPipeline gets back, one ack per command submitted, after that command's trades.
+*/
+namespace ob::tests
+{
+	namespace
+	{
+		/* One Expire with more orders due than one chunk removes: the pipeline requeues it until they are all gone, but acks it only once.
+		*  The orders expire at a fixed time, long past, that the Expire names; there is no prune thread to beat it to them. */
+		std::string ExpireAckedOnce()
+		{
+			constexpr std::size_t Expiring = 10;
+			const Timestamp expiry{ std::chrono::hours(24) };
+
+			OrderBookOptions bookOptions{};
+			bookOptions.expiryChunk_ = 4;
+			bookOptions.depthViewLevels_ = 4;
+			OrderBookPipeline pipeline{ bookOptions };
+
+			for (OrderId orderId = 1; orderId <= Expiring; ++orderId)
+				pipeline.Submit(Command::Add(Order{ OrderType::GoodTillTime, orderId, Side::Buy, 100 - static_cast<Price>(orderId), 10, expiry }));
+			pipeline.Submit(Command::Add(Order{ OrderType::GoodTillCancel, Expiring + 1, Side::Sell, 200, 10 }));
+			pipeline.Submit(Command::Expire(expiry));
+			pipeline.Stop();
+
+			std::vector<ExecutionEvent> events(256);
+			std::size_t acks = 0;
+			std::size_t expireAcks = 0;
+			for (std::size_t count = pipeline.Drain(events); count != 0; count = pipeline.Drain(events))
+				for (std::size_t i = 0; i < count; ++i)
+				{
+					if (events[i].type_ != ExecutionEventType::Ack)
+						continue;
+					++acks;
+					expireAcks += events[i].ack_.command_ == CommandType::Expire;
+				}
+
+			if (acks != Expiring + 2 or expireAcks != 1)
+				return std::format("{} acks for {} commands, {} of them for the one Expire", acks, Expiring + 2, expireAcks);
+
+			std::vector<LevelInfo> bids(4);
+			std::vector<LevelInfo> asks(4);
+			if (const DepthViewState state = pipeline.GetDepthView()->Read(bids, asks); state.orders_ != 1)
+				return std::format("{} orders left after the Expire, expected 1", state.orders_);
+			return {};
+		}
+
+		/* Producers keep submitting while Stop() runs: every command Submit accepted must be acked, whichever side of Stop() it landed on,
+		*  and once Stop() has returned no more are accepted. Cancels of orders that aren't there, so every one is acked and nothing trades. */
+		std::string SubmitDuringStop()
+		{
+			constexpr std::size_t Rounds = 20;
+			constexpr std::size_t Producers = 3;
+
+			for (std::size_t round = 0; round < Rounds; ++round)
+			{
+				PipelineOptions options{};
+				options.ingressCapacity_ = 1024;
+				OrderBookPipeline pipeline{ OrderBookOptions{}, options };
+
+				std::atomic<bool> stopped{ false };
+				std::atomic<std::size_t> accepted{ 0 };
+				std::atomic<std::size_t> acceptedAfterStop{ 0 };
+				std::vector<std::thread> producers;
+				for (std::size_t producer = 0; producer < Producers; ++producer)
+					producers.emplace_back([&pipeline, &stopped, &accepted, &acceptedAfterStop]()
+						{
+							for (OrderId orderId = 1;; ++orderId)
+							{
+								const bool after = stopped.load(std::memory_order_acquire);
+								if (pipeline.Submit(Command::Cancel(orderId)))
+								{
+									accepted.fetch_add(1, std::memory_order_relaxed);
+									acceptedAfterStop += after;
+								}
+								if (after)
+									return;
+							}
+						});
+
+				std::this_thread::sleep_for(std::chrono::milliseconds(2));
+				pipeline.Stop();
+				stopped.store(true, std::memory_order_release);
+				for (auto& producer : producers)
+					producer.join();
+
+				std::vector<ExecutionEvent> events(1024);
+				std::size_t acks = 0;
+				for (std::size_t count = pipeline.Drain(events); count != 0; count = pipeline.Drain(events))
+					for (std::size_t i = 0; i < count; ++i)
+						acks += events[i].type_ == ExecutionEventType::Ack;
+
+				if (acceptedAfterStop != 0)
+					return std::format("round {}: {} commands accepted after Stop() returned", round, acceptedAfterStop.load());
+				if (acks != accepted)
+					return std::format("round {}: {} acks for {} accepted commands", round, acks, accepted.load());
+			}
+			return {};
+		}
+	}
+
+	void RunPipelineTests(const TestOptions&, TestReport& report)
+	{
+		report.Record("pipeline expire acked once", ExpireAckedOnce());
+		report.Record("pipeline submit during stop", SubmitDuringStop());
+	}
+}
@@ -0,0 +1,202 @@
+#include "obTests.hpp"
+#include "api/obOrderBook.hpp"
+#include "api/obJournal.hpp"
+
+// lib
+#include <atomic>
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/* Snapshot: a book saved halfway through a seeded flow and loaded into a fresh book must hold the same orders, and since priority, owners and expiries
+*  come back with them, both books must then trade the same for the rest of the flow. For every level storage and order id indexing.
+*  Also snapshots taken from another thread while the book keeps matching: each one, plus the journal from the sequence it records, rebuilds the live book.
+*  And files that aren't a snapshot this version can load are refused.
+*/
+namespace ob::tests
+{
+	namespace
+	{
+		void ApplyAll(OrderBook& book, std::span<const Command> commands, Trades& trades)
+		{
+			for (const Command& command : commands)
+				book.Apply(std::span<const Command>{ &command, 1 }, trades);
+		}
+
+		std::string RoundTrip(const OrderBookOptions& bookOptions, const TestOptions& options)
+		{
+			TemporaryDirectory directory{ "snapshot" };
+			const std::filesystem::path path = directory.GetPath() / "book.snap";
+			const std::vector<Command> commands = MakeCommands(options.ops_, options.seed_, Timestamp{ std::chrono::hours(24 * 365 * 50) });
+			const std::span<const Command> firstHalf{ commands.data(), commands.size() / 2 };
+			const std::span<const Command> secondHalf{ commands.data() + firstHalf.size(), commands.size() - firstHalf.size() };
+
+			OrderBook book{ bookOptions };
+			Trades trades;
+			ApplyAll(book, firstHalf, trades);
+			book.SaveSnapshot(path);
+
+			OrderBook loaded{ bookOptions };
+			if (const std::uint64_t sequence = loaded.LoadSnapshot(path); sequence != 0)
+				return std::format("a snapshot taken without a journal resumes at sequence {}", sequence);
+			if (loaded.Size() != book.Size() or ToString(loaded.GetOrderInfos()) != ToString(book.GetOrderInfos()))
+				return std::format("loaded {} orders, saved {}", loaded.Size(), book.Size());
+
+			Trades bookTrades;
+			Trades loadedTrades;
+			ApplyAll(book, secondHalf, bookTrades);
+			ApplyAll(loaded, secondHalf, loadedTrades);
+			if (!SameTrades(loadedTrades, bookTrades))
+				return std::format("after loading, the rest of the flow traded {} times, {} without saving", loadedTrades.size(), bookTrades.size());
+			if (loaded.Size() != book.Size() or ToString(loaded.GetOrderInfos()) != ToString(book.GetOrderInfos()))
+				return std::format("after loading, the flow leaves {} orders, {} without saving", loaded.Size(), book.Size());
+			return {};
+		}
+
+		/* One thread matches the whole flow, the other saves a snapshot every so often meanwhile. Small snapshot chunks,
+		*  so that the matching thread gets in between them and changes levels that are still to be copied.
+		*  The flow's time starts a year from now: the prune threads have nothing to expire, only the flow's Expire commands do. */
+		std::string SaveWhileMatching(OrderBookOptions bookOptions, const TestOptions& options)
+		{
+			TemporaryDirectory directory{ "snapshot-matching" };
+			const std::filesystem::path journalPath = directory.GetPath() / "book";
+			const std::vector<Command> commands = MakeCommands(options.ops_, options.seed_ + 1,
+				std::chrono::system_clock::now() + std::chrono::hours(24 * 365));
+			constexpr std::size_t Snapshots = 8;
+
+			JournalWriter journal{ journalPath, JournalOptions{ .syncEvery_ = 0 } };
+			bookOptions.journal_ = &journal;
+			bookOptions.snapshotChunk_ = 4;
+			OrderBook book{ bookOptions };
+
+			std::atomic<std::size_t> applied{ 0 };
+			std::thread matching{ [&book, &commands, &applied]()
+				{
+					Trades trades;
+					for (const Command& command : commands)
+					{
+						trades.clear();
+						book.Apply(std::span<const Command>{ &command, 1 }, trades);
+						applied.fetch_add(1, std::memory_order_release);
+					}
+				} };
+
+			// Spread over the first half of the flow, the matching thread carries on all the while.
+			for (std::size_t snapshot = 0; snapshot < Snapshots; ++snapshot)
+			{
+				while (applied.load(std::memory_order_acquire) < (snapshot + 1) * commands.size() / (2 * Snapshots))
+					std::this_thread::yield();
+				book.SaveSnapshot(directory.GetPath() / std::format("book.{}.snap", snapshot));
+			}
+
+			matching.join();
+			journal.Sync();
+			const std::string liveDepth = ToString(book.GetOrderInfos());
+
+			bookOptions.journal_ = nullptr;
+			for (std::size_t snapshot = 0; snapshot < Snapshots; ++snapshot)
+			{
+				OrderBook rebuilt{ bookOptions };
+				const std::uint64_t sequence = rebuilt.LoadSnapshot(directory.GetPath() / std::format("book.{}.snap", snapshot));
+				if (sequence == 0 or sequence > commands.size() + 1)
+					return std::format("snapshot {} resumes at sequence {}", snapshot, sequence);
+
+				JournalReader reader{ journalPath, sequence };
+				std::vector<Command> batch(256);
+				Trades trades;
+				for (std::size_t count = reader.Read(batch); count != 0; count = reader.Read(batch))
+					rebuilt.Replay(std::span<const Command>{ batch.data(), count }, trades);
+
+				if (rebuilt.Size() != book.Size() or ToString(rebuilt.GetOrderInfos()) != liveDepth)
+					return std::format("snapshot {} (sequence {}) and the journal rebuild {} orders, the book holds {}", snapshot, sequence, rebuilt.Size(), book.Size());
+			}
+			return {};
+		}
+
+		template <typename Exception>
+		std::string ExpectRefused(OrderBook& book, const std::filesystem::path& path, std::string_view what)
+		{
+			try
+			{
+				book.LoadSnapshot(path);
+				return std::format("loaded {}", what);
+			}
+			catch (const Exception&)
+			{
+				return {};
+			}
+		}
+
+		std::string RefuseCorrupt()
+		{
+			TemporaryDirectory directory{ "snapshot-corrupt" };
+			const std::filesystem::path path = directory.GetPath() / "book.snap";
+			{
+				OrderBook book{};
+				for (OrderId orderId = 1; orderId <= 100; ++orderId)
+					book.AddOrder(Order{ OrderType::GoodTillCancel, orderId, orderId % 2 == 0 ? Side::Buy : Side::Sell, 1000 + (orderId % 2 == 0 ? -1 : 1) * static_cast<Price>(orderId % 10), 10 });
+				book.SaveSnapshot(path);
+			}
+
+			OrderBook loaded{};
+			loaded.LoadSnapshot(path);
+			if (loaded.Size() != 100)
+				return std::format("loaded {} of 100 orders", loaded.Size());
+			if (std::string difference = ExpectRefused<std::logic_error>(loaded, path, "a snapshot into a book that isn't empty"); !difference.empty())
+				return difference;
+
+			// Cut off in the middle of the orders.
+			const std::filesystem::path truncated = directory.GetPath() / "truncated.snap";
+			std::filesystem::copy_file(path, truncated);
+			std::filesystem::resize_file(truncated, std::filesystem::file_size(path) - 20);
+			OrderBook fromTruncated{};
+			if (std::string difference = ExpectRefused<std::runtime_error>(fromTruncated, truncated, "a truncated snapshot"); !difference.empty())
+				return difference;
+
+			// A version 2 header, from before orders had owners.
+			const std::filesystem::path older = directory.GetPath() / "older.snap";
+			std::filesystem::copy_file(path, older);
+			{
+				SnapshotHeader header{};
+				std::fstream file{ older, std::ios::binary | std::ios::in | std::ios::out };
+				file.read(reinterpret_cast<char*>(&header), sizeof(header));
+				header.version_ = 2;
+				file.seekp(0);
+				file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			}
+			OrderBook fromOlder{};
+			return ExpectRefused<std::runtime_error>(fromOlder, older, "a version 2 snapshot");
+		}
+	}
+
+	void RunSnapshotTests(const TestOptions& options, TestReport& report)
+	{
+		for (const LevelStorage levelStorage : { LevelStorage::Map, LevelStorage::Ladder })
+		{
+			for (const OrderIdIndexing orderIdIndexing : { OrderIdIndexing::Hash, OrderIdIndexing::Dense })
+			{
+				OrderBookOptions bookOptions{};
+				bookOptions.levelStorage_ = levelStorage;
+				bookOptions.ladderLevels_ = 64;
+				bookOptions.orderIdIndexing_ = orderIdIndexing;
+				bookOptions.selfTradePrevention_ = SelfTradePrevention::CancelOldest;
+
+				const std::string name = std::format("snapshot {} {}", levelStorage == LevelStorage::Map ? "map" : "ladder",
+					orderIdIndexing == OrderIdIndexing::Hash ? "hash" : "dense");
+
+				OrderBookOptions singleWriter{ bookOptions };
+				singleWriter.threading_ = Threading::SingleWriter;
+				report.Record(std::format("{} round trip", name), RoundTrip(singleWriter, options));
+				report.Record(std::format("{} save while matching", name), SaveWhileMatching(bookOptions, options));
+			}
+		}
+
+		report.Record("snapshot corrupt", RefuseCorrupt());
+	}
+}
@@ -0,0 +1,100 @@
+#include "obTests.hpp"
+#include "api/obOrderBook.hpp"
+
+// lib
+#include <format>
+#include <string>
+
+/* Stats: the counters behind OrderBook::GetStats after a directed flow, one of each thing a book counts.
+*  The Debug configuration of OrderBookTests defines OB_ENABLE_STATS and checks every counter; Release doesn't, and checks that they are all zero.
+*/
+namespace ob::tests
+{
+	namespace
+	{
+		// The counters the flow below moves, lock and expiry timings left out (they depend on the machine).
+		std::string ToString(const OrderBookStats& stats)
+		{
+			std::string counters;
+			for (const OrderType orderType : { OrderType::GoodTillCancel, OrderType::FillAndKill, OrderType::FillOrKill, OrderType::Market })
+			{
+				const std::size_t type = ToIndex(orderType);
+				counters += std::format("{}: adds {} rejects {} fills {} cancels {}, ", static_cast<int>(orderType),
+					stats.adds_[type], stats.rejects_[type], stats.fills_[type], stats.cancels_[type]);
+			}
+
+			return counters + std::format("modifies {} reductions {} trades {} self-trades {} levels swept {} created {} destroyed {}",
+				stats.modifies_, stats.reductions_, stats.trades_, stats.selfTradesPrevented_, stats.levelsSwept_, stats.levelsCreated_, stats.levelsDestroyed_);
+		}
+
+		std::string DirectedFlow()
+		{
+			OrderBook book{};
+			book.AddOrder(Order{ OrderType::GoodTillCancel, 1, Side::Sell, 100, 10 });
+			book.AddOrder(Order{ OrderType::GoodTillCancel, 2, Side::Sell, 101, 10 });
+			// fills 1 (emptying its level), the rest of it is cancelled
+			book.AddOrder(Order{ OrderType::FillAndKill, 3, Side::Buy, 100, 15 });
+			// only 10 to be had, rejected
+			book.AddOrder(Order{ OrderType::FillOrKill, 4, Side::Buy, 101, 50 });
+			// fills part of 2
+			book.AddOrder(Order{ 5, Side::Buy, 4 });
+			book.AddOrder(Order{ OrderType::GoodTillCancel, 6, Side::Buy, 99, 10 });
+			// a duplicate id, rejected
+			book.AddOrder(Order{ OrderType::GoodTillCancel, 6, Side::Buy, 99, 10 });
+			// in place, then through cancel and add
+			book.MatchOrder(OrderModify{ 6, Side::Buy, 99, 5 });
+			book.MatchOrder(OrderModify{ 6, Side::Buy, 98, 5 });
+			book.CancelOrder(2);
+			// not there, counts nothing
+			book.CancelOrder(42);
+			book.CancelSide(Side::Buy);
+
+			const OrderBookStats stats = book.GetStats();
+			if (!stats.enabled_)
+			{
+				if (ToString(stats) != ToString(OrderBookStats{}) or stats.lockAcquisitions_ != 0)
+					return std::format("built without OB_ENABLE_STATS, but counted {}", ToString(stats));
+				return {};
+			}
+
+			const OrderBookStats expected = []()
+				{
+					OrderBookStats expected{};
+					expected.adds_[ToIndex(OrderType::GoodTillCancel)] = 5;
+					expected.rejects_[ToIndex(OrderType::GoodTillCancel)] = 1;
+					expected.fills_[ToIndex(OrderType::GoodTillCancel)] = 2;
+					expected.cancels_[ToIndex(OrderType::GoodTillCancel)] = 3;
+					expected.adds_[ToIndex(OrderType::FillAndKill)] = 1;
+					expected.fills_[ToIndex(OrderType::FillAndKill)] = 1;
+					expected.cancels_[ToIndex(OrderType::FillAndKill)] = 1;
+					expected.adds_[ToIndex(OrderType::FillOrKill)] = 1;
+					expected.rejects_[ToIndex(OrderType::FillOrKill)] = 1;
+					expected.adds_[ToIndex(OrderType::Market)] = 1;
+					expected.fills_[ToIndex(OrderType::Market)] = 1;
+					expected.modifies_ = 2;
+					expected.reductions_ = 1;
+					expected.trades_ = 2;
+					expected.levelsSwept_ = 2;
+					expected.levelsCreated_ = 4;
+					expected.levelsDestroyed_ = 4;
+					return expected;
+				}();
+
+			if (ToString(stats) != ToString(expected))
+				return std::format("counted {}, expected {}", ToString(stats), ToString(expected));
+			// every call above took the lock once (the prune thread may have taken it too)
+			if (stats.lockAcquisitions_ < 12)
+				return std::format("{} lock acquisitions for 12 calls", stats.lockAcquisitions_);
+			return {};
+		}
+	}
+
+	void RunStatsTests(const TestOptions&, TestReport& report)
+	{
+#ifdef OB_ENABLE_STATS
+		report.Record("stats directed flow", DirectedFlow());
+#else
+		report.Record("stats disabled", DirectedFlow());
+#endif
+	}
+}
@@ -0,0 +1,130 @@
+#include "obTests.hpp"
+
+// lib
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <random>
+
+namespace ob::tests
+{
+	void TestReport::Record(std::string_view name, const std::string& difference)
+	{
+		std::cout << std::format("{:<40} {}\n", name, difference.empty() ? "ok" : difference);
+		failed_ += !difference.empty();
+	}
+
+	TemporaryDirectory::TemporaryDirectory(std::string_view name)
+		: path_{ std::filesystem::temp_directory_path() / std::format("OrderBookTests-{}", name) }
+	{
+		std::filesystem::remove_all(path_);
+		std::filesystem::create_directories(path_);
+	}
+
+	TemporaryDirectory::~TemporaryDirectory()
+	{
+		// Never throws, a directory left behind is removed by the next run anyway.
+		std::error_code error;
+		std::filesystem::remove_all(path_, error);
+	}
+
+	std::vector<Command> MakeCommands(std::size_t count, std::uint64_t seed, Timestamp start)
+	{
+		std::mt19937_64 random{ seed };
+		const auto pick = [&random](std::uint64_t count) { return random() % count; };
+
+		std::vector<Command> commands;
+		commands.reserve(count);
+		OrderId nextOrderId = 1;
+
+		for (std::size_t op = 0; op < count; ++op)
+		{
+			const Side side = pick(2) == 0 ? Side::Buy : Side::Sell;
+			const Price price = 1000 + static_cast<Price>(pick(31)) - 15;
+			const Quantity quantity = static_cast<Quantity>(1 + pick(40));
+			const OwnerId owner = static_cast<OwnerId>(pick(4));
+			const OrderId existing = 1 + pick(nextOrderId);
+			const Timestamp now = start + std::chrono::milliseconds(op);
+
+			if (op % 100 == 99)
+			{
+				commands.push_back(Command::Expire(now));
+				continue;
+			}
+
+			const std::uint64_t roll = pick(100);
+			if (roll < 50)
+			{
+				const std::uint64_t type = pick(10);
+				const OrderType orderType = type < 5 ? OrderType::GoodTillCancel : type < 7 ? OrderType::GoodTillTime : type < 8 ? OrderType::FillAndKill
+					: type < 9 ? OrderType::FillOrKill : OrderType::Market;
+				const Timestamp expiry = orderType == OrderType::GoodTillTime ? now + std::chrono::milliseconds(1 + pick(2000)) : Timestamp{};
+				commands.push_back(Command::Add(orderType == OrderType::Market ? Order{ nextOrderId, side, quantity, owner }
+					: Order{ orderType, nextOrderId, side, price, quantity, expiry, owner }));
+				++nextOrderId;
+			}
+			else if (roll < 80)
+				commands.push_back(Command::Cancel(existing));
+			else if (roll < 96)
+				commands.push_back(Command::Modify(OrderModify{ existing, side, price, quantity }));
+			else if (roll < 98)
+				commands.push_back(Command::CancelOwner(owner));
+			else if (roll < 99)
+				commands.push_back(Command::CancelRange(side, price - 3, price + 3));
+			else
+				commands.push_back(Command::CancelSide(side));
+		}
+
+		return commands;
+	}
+
+	std::string ToString(const Trades& trades)
+	{
+		std::string out;
+		for (const auto& trade : trades)
+		{
+			const auto& bid = trade.GetBidTrade();
+			const auto& ask = trade.GetAskTrade();
+			out += std::format("[{}@{} x {}@{} q{}] ", bid.orderId_, bid.price_, ask.orderId_, ask.price_, bid.quantity_);
+		}
+		return out.empty() ? "none" : out;
+	}
+
+	std::string ToString(const OrderBookLevelInfos& infos)
+	{
+		std::string out{ "bids" };
+		for (const auto& level : infos.GetBids())
+			out += std::format(" {}x{}/{}", level.price_, level.quantity_, level.count_);
+		out += " asks";
+		for (const auto& level : infos.GetAsks())
+			out += std::format(" {}x{}/{}", level.price_, level.quantity_, level.count_);
+		return out;
+	}
+
+	bool SameTrades(const Trades& actual, const Trades& expected)
+	{
+		const auto same = [](const TradeInfo& lhs, const TradeInfo& rhs)
+			{
+				return lhs.orderId_ == rhs.orderId_ and lhs.price_ == rhs.price_ and lhs.quantity_ == rhs.quantity_;
+			};
+
+		return std::equal(actual.begin(), actual.end(), expected.begin(), expected.end(), [&same](const Trade& lhs, const Trade& rhs)
+			{
+				return same(lhs.GetBidTrade(), rhs.GetBidTrade()) and same(lhs.GetAskTrade(), rhs.GetAskTrade());
+			});
+	}
+
+	bool SameLevels(const LevelInfos& actual, const LevelInfos& expected)
+	{
+		return std::equal(actual.begin(), actual.end(), expected.begin(), expected.end(), [](const LevelInfo& lhs, const LevelInfo& rhs)
+			{
+				return lhs.price_ == rhs.price_ and lhs.quantity_ == rhs.quantity_ and lhs.count_ == rhs.count_;
+			});
+	}
+
+	bool SameLevels(const OrderBookLevelInfos& actual, const OrderBookLevelInfos& expected)
+	{
+		return SameLevels(actual.GetBids(), expected.GetBids()) and SameLevels(actual.GetAsks(), expected.GetAsks());
+	}
+}
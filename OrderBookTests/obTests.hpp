@@ -0,0 +1,73 @@
+#pragma once
+
+#include "api/obAliases.hpp"
+#include "api/obTrade.hpp"
+#include "api/obOrderBookLevelInfos.hpp"
+#include "api/obCommand.hpp"
+
+// lib
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/* What the suites of OrderBookTests share (see main.cpp). Every suite is a Run...Tests function in its own ob...Tests.cpp. */
+namespace ob::tests
+{
+	struct TestOptions
+	{
+		std::size_t ops_{ 20'000 };
+		std::uint64_t seed_{ 1 };
+	};
+
+	/* Where the test cases report to. A case passes with an empty string, otherwise it reports what differed first. */
+	class TestReport
+	{
+	public:
+		// Prints one line per case, "ok" or the difference.
+		void Record(std::string_view name, const std::string& difference);
+
+		int GetFailed() const { return failed_; }
+
+	private:
+		int failed_{ 0 };
+	};
+
+	/* A fresh directory under the system's temporary directory, for the files a test writes. Removed, with everything in it, on destruction. */
+	class TemporaryDirectory
+	{
+	public:
+		explicit TemporaryDirectory(std::string_view name);
+		~TemporaryDirectory();
+
+		TemporaryDirectory(const TemporaryDirectory&) = delete;
+		TemporaryDirectory& operator=(const TemporaryDirectory&) = delete;
+
+		const std::filesystem::path& GetPath() const { return path_; }
+
+	private:
+		std::filesystem::path path_;
+	};
+
+	/* A seeded flow of every command type, for the suites that rebuild a book some other way and compare it with the original.
+	*  Time starts at 'start' and moves 1ms per command: GoodTillTime orders expire up to 2s after they arrive and every 100th command is an Expire,
+	*  so with Threading::SingleWriter (no prune thread) nothing depends on the wall clock. Cancels and modifies name ids that may or may not rest. */
+	std::vector<Command> MakeCommands(std::size_t count, std::uint64_t seed, Timestamp start);
+
+	std::string ToString(const Trades& trades);
+	// Both sides as "price x quantity/count" per level, best first.
+	std::string ToString(const OrderBookLevelInfos& infos);
+
+	bool SameTrades(const Trades& actual, const Trades& expected);
+	bool SameLevels(const LevelInfos& actual, const LevelInfos& expected);
+	bool SameLevels(const OrderBookLevelInfos& actual, const OrderBookLevelInfos& expected);
+
+	void RunMatchingTests(const TestOptions& options, TestReport& report);
+	void RunJournalTests(const TestOptions& options, TestReport& report);
+	void RunSnapshotTests(const TestOptions& options, TestReport& report);
+	void RunPipelineTests(const TestOptions& options, TestReport& report);
+	void RunEngineTests(const TestOptions& options, TestReport& report);
+	void RunDepthTests(const TestOptions& options, TestReport& report);
+	void RunStatsTests(const TestOptions& options, TestReport& report);
+}